@@ -15,11 +15,48 @@ TEMPLATE = app
 SOURCES += main.cpp\
         mainwindow.cpp \
     bezierinterpolator.cpp \
-    movingellipseitem.cpp
+    bezierinterpolatorbatch.cpp \
+    compactpolyline.cpp \
+    controlpointintegrator.cpp \
+    controlpointsitem.cpp \
+    controlpointstore.cpp \
+    dirtyregion.cpp \
+    frameprofiler.cpp \
+    nurbsspline.cpp \
+    offlinerenderer.cpp \
+    parallelflattener.cpp \
+    pointgrid.cpp \
+    polylineitem.cpp \
+    qualitygovernor.cpp \
+    splinecache.cpp \
+    splineengine.cpp \
+    splinerasterizer.cpp \
+    splinescene.cpp \
+    splineworker.cpp \
+    workstealingpool.cpp
 
 HEADERS  += mainwindow.h \
     bezierinterpolator.h \
-    movingellipseitem.h
+    compactpolyline.h \
+    controlpointintegrator.h \
+    controlpointsitem.h \
+    controlpointstore.h \
+    dirtyregion.h \
+    frameprofiler.h \
+    nurbsspline.h \
+    offlinerenderer.h \
+    parallelflattener.h \
+    pointgrid.h \
+    polylineitem.h \
+    qualitygovernor.h \
+    splinecache.h \
+    splinecore.h \
+    splineengine.h \
+    splinerasterizer.h \
+    splinescene.h \
+    splineworker.h \
+    triplebuffer.h \
+    workstealingpool.h
 
 FORMS    += mainwindow.ui
 
@@ -1,15 +1,68 @@
 set(BSPLINE_SRC
 ${BSPLINE_SRC}
 bezierinterpolator.cpp
-mainwindow.cpp
-movingellipseitem.cpp
+bezierinterpolatorbatch.cpp
+compactpolyline.cpp
+controlpointintegrator.cpp
+controlpointstore.cpp
+dirtyregion.cpp
+frameprofiler.cpp
+nurbsspline.cpp
+parallelflattener.cpp
+pointgrid.cpp
+qualitygovernor.cpp
+splinecache.cpp
+splineengine.cpp
+splineworker.cpp
+workstealingpool.cpp
 )
 
 set(BSPLINE_HEADERS
 ${BSPLINE_HEADERS}
 bezierinterpolator.h
+compactpolyline.h
+controlpointintegrator.h
+controlpointstore.h
+dirtyregion.h
+frameprofiler.h
+nurbsspline.h
+parallelflattener.h
+pointgrid.h
+qualitygovernor.h
+splinecache.h
+splinecore.h
+splineengine.h
+splineworker.h
+triplebuffer.h
+workstealingpool.h
+)
+
+set(BSPLINE_GUI_SRC
+${BSPLINE_GUI_SRC}
+controlpointsitem.cpp
+mainwindow.cpp
+offlinerenderer.cpp
+polylineitem.cpp
+splinerasterizer.cpp
+splinescene.cpp
+)
+
+set(BSPLINE_GUI_HEADERS
+${BSPLINE_GUI_HEADERS}
+controlpointsitem.h
 mainwindow.h
-movingellipseitem.h
+offlinerenderer.h
+polylineitem.h
+splinerasterizer.h
+splinescene.h
+)
+
+set(BSPLINE_BENCHMARK_SRC
+benchmark.cpp
+)
+
+set(BSPLINE_RENDER_SRC
+render.cpp
 )
 
 set(BSPLINE_FORMS
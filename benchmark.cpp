@@ -0,0 +1,1118 @@
+// Headless benchmark of B-spline pipeline: boor net calculation with de Boor
+// algorithm and interpolation of Bezier curves. Doesn't need GUI, links only
+// with QtCore.
+//
+// Usage: BezierBenchmark [--json] [--seed N] [--min-time MS] [--threads N]
+//                        [--scene] [--compact float|delta] [--verify]
+//
+// For every interpolation engine, number of control points and distance
+// tolerance one record is printed (CSV by default) with:
+//   time of moving of control points in ns per frame,
+//   time of a frame in ns per control point and per interpolated point,
+//   number of heap allocations per frame,
+//   peak resident set size of the process so far.
+// Frame is the same work as in MainWindow::updateView(): control points are
+// moved, boor net is calculated and all Bezier curves are interpolated.
+//
+// With --scene SplineEngine animates thousands of splines of different length
+// instead, and one record is printed for every number of splines and threads
+// with time of a frame and throughput in splines per second. --compact keeps
+// interpolated points of the scene in CompactPolyline of the given format.
+//
+// With --verify nothing is timed: faster paths are compared with the reference
+// ones they replace and one line is printed for every check. Exit code is
+// non-zero if any check fails.
+
+#include "bezierinterpolator.h"
+#include "controlpointintegrator.h"
+#include "nurbsspline.h"
+#include "parallelflattener.h"
+#include "splinecache.h"
+#include "splineengine.h"
+#include "workstealingpool.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include <QVector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+// Number of calls of malloc() family since start of the process.
+unsigned long allocationsNumber = 0;
+
+} // namespace
+
+#ifdef __GLIBC__
+// Allocations are counted by interposing malloc() family. QVector allocates
+// with malloc() and operator new ends up there as well.
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t number, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+
+void *malloc(size_t size) {
+  ++allocationsNumber;
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t number, size_t size) {
+  ++allocationsNumber;
+  return __libc_calloc(number, size);
+}
+
+void *realloc(void *pointer, size_t size) {
+  ++allocationsNumber;
+  return __libc_realloc(pointer, size);
+}
+}
+#endif
+
+namespace {
+
+enum Engine {
+  RecursiveEngine,
+  IterativeEngine,
+  BatchEngine,
+  FloatEngine, // Spline core in single precision without Qt types.
+  ForwardDifferencingEngine,
+  CurvatureEngine,
+  NurbsEngine, // The same cubic spline as NURBS of general degree.
+  EvaluationEngine, // Samples at fixed parameters instead of flattening.
+  ParallelEngine, // Batch interpolation of ranges of curves on threads.
+  CoherentEngine, // Subdivision starts from subdivision of the last frame.
+  EnginesNumber
+};
+
+const char *const engineNames[EnginesNumber] = {
+  "recursive", "iterative", "batch", "float", "forward", "curvature",
+  "nurbs", "evaluate", "parallel", "coherent"
+};
+
+// Number of samples per Bezier curve for EvaluationEngine.
+const int samplesPerCurve = 16;
+
+const int controlPointsNumbers[] = { 4, 8, 16, 64, 256, 1024, 4096, 16384 };
+
+// Distance tolerances of "Interp Quality" slider at positions 100, 98, 90, 50.
+const double distanceTolerances[] = { 0.5, 2.5, 10.5, 50.5 };
+
+// Control points move within area of this size like in default window.
+const int areaWidth = 800;
+const int areaHeight = 600;
+
+const int minFramesNumber = 5;
+
+// Numbers of splines in scenes of SplineEngine.
+const int sceneSplinesNumbers[] = { 1000, 4000 };
+
+// Splines of scenes have from 4 to 1024 control points, the same number of
+// splines in every octave.
+const int minSceneSplineLength = 4;
+const int sceneSplineOctaves = 9;
+
+struct Options {
+  Options() : json(false), seed(1), minTime(200), threadsNumber(0),
+              scene(false), compact(false),
+              compactFormat(CompactPolyline::DeltaFormat), verify(false) {}
+
+  bool json;
+  unsigned seed;
+  qint64 minTime; // Milliseconds per record.
+  // Of ParallelEngine and SplineEngine, one per core if not positive.
+  int threadsNumber;
+  bool scene; // Benchmark SplineEngine instead of engines.
+  bool compact; // Scene keeps interpolated points in CompactPolyline.
+  CompactPolyline::Format compactFormat;
+  bool verify; // Check faster paths against reference ones.
+};
+
+struct Result {
+  Engine engine;
+  int controlPointsNumber;
+  double distanceTolerance;
+  int framesNumber;
+  int interpolatedPointsNumber; // Of the last frame.
+  double moveTime; // Nanoseconds per frame.
+  double boorNetTime; // Nanoseconds per frame.
+  double interpolationTime; // Nanoseconds per frame.
+  double allocationsPerFrame;
+  long peakMemory; // Kilobytes, -1 if unknown.
+};
+
+struct SceneResult {
+  int splinesNumber;
+  int threadsNumber;
+  int framesNumber;
+  qint64 controlPointsNumber;
+  qint64 interpolatedPointsNumber; // Of the last frame.
+  double moveTime; // Nanoseconds per frame.
+  double frameTime; // Nanoseconds per frame.
+  double splinesPerSecond;
+  double allocationsPerFrame;
+  long peakMemory; // Kilobytes, -1 if unknown.
+  long pointsMemory; // Kilobytes of interpolated points.
+};
+
+// Spline - synthetic animated spline.
+struct Spline {
+  ControlPointStore controlPoints;
+  ControlPointIntegrator integrator;
+  QVector<qreal> knotVector;
+
+  QPolygonF boorNetPoints;
+  QVector<double> boorNetX;
+  QVector<double> boorNetY;
+  QPolygonF interpolatedPoints;
+
+  // Single precision copy of the spline for FloatEngine.
+  typedef bspline::Point2<float> FloatPoint;
+  std::vector<FloatPoint> floatControlPoints;
+  std::vector<float> floatKnotVector;
+  std::vector<FloatPoint> floatBoorNetPoints;
+  std::vector<FloatPoint> floatInterpolatedPoints;
+
+  NurbsSpline nurbsSpline;
+
+  bspline::SplineEvaluator<qreal> evaluator;
+  std::vector<qreal> sampleParameters;
+  std::vector<qreal> sampleX;
+  std::vector<qreal> sampleY;
+
+  ParallelFlattener parallelFlattener;
+
+  // Subdivision of the current and the last frame for CoherentEngine.
+  QVector<unsigned char> depths;
+  QVector<int> depthEnds;
+  QVector<unsigned char> previousDepths;
+  QVector<int> previousDepthEnds;
+};
+
+// FillSpline - generates control points of \p spline with speeds from seed and
+// fills knot vector of uniform cubic B-spline that passes through endpoints.
+void FillSpline(int controlPointsNumber, unsigned seed, Spline &spline) {
+  qsrand(seed);
+  const int speedLimit = 5;
+  for (int counter = 0; counter < controlPointsNumber; ++counter) {
+    const QPointF point(qrand() % areaWidth, qrand() % areaHeight);
+    const QPointF speed(qrand() % speedLimit, qrand() % speedLimit);
+    spline.controlPoints.Add(point, speed);
+  }
+  spline.integrator.SetBounds(areaWidth, areaHeight);
+
+  bspline::FillUniformKnotVector(3, controlPointsNumber, spline.knotVector);
+  spline.floatKnotVector.assign(spline.knotVector.constBegin(),
+                                spline.knotVector.constEnd());
+
+  QPolygonF points;
+  spline.controlPoints.CopyPoints(points);
+  spline.nurbsSpline.SetControlPoints(points);
+  spline.nurbsSpline.SetKnotVector(spline.knotVector);
+
+  const int samplesNumber = samplesPerCurve *
+      BezierInterpolator::BezierCurvesNumber(controlPointsNumber);
+  spline.sampleParameters.resize(samplesNumber);
+  for (int counter = 0; counter < samplesNumber; ++counter)
+    spline.sampleParameters[counter] = (qreal) counter / (samplesNumber - 1);
+  spline.sampleX.resize(samplesNumber);
+  spline.sampleY.resize(samplesNumber);
+}
+
+// Interpolators - interpolators of all engines with the same tolerance.
+struct Interpolators {
+  Interpolators(Engine engine, double distanceTolerance) {
+    interpolator.SetDistanceTolerance(distanceTolerance);
+    floatFlattener.SetDistanceTolerance((float) distanceTolerance);
+    if (engine == ForwardDifferencingEngine)
+      interpolator.SetEngine(BezierInterpolator::ForwardDifferencingEngine);
+    else if (engine == CurvatureEngine)
+      interpolator.SetEngine(BezierInterpolator::CurvatureEngine);
+  }
+
+  BezierInterpolator interpolator;
+  bspline::BezierFlattener<float> floatFlattener;
+};
+
+// MoveSpline - moves control points according to their speed and bounces them
+// from borders of the area.
+void MoveSpline(Spline &spline) {
+  spline.integrator.Advance(spline.controlPoints);
+}
+
+// CalculateBoorNet - first stage of a frame.
+void CalculateBoorNet(const Interpolators &interpolators, Engine engine,
+                      Spline &spline) {
+  const int controlPointsNumber = spline.controlPoints.Size();
+  if (engine == FloatEngine) {
+    spline.floatControlPoints.resize(controlPointsNumber);
+    for (int counter = 0; counter < controlPointsNumber; ++counter) {
+      spline.floatControlPoints[counter].x = spline.controlPoints.X()[counter];
+      spline.floatControlPoints[counter].y = spline.controlPoints.Y()[counter];
+    }
+    spline.floatBoorNetPoints.resize(bspline::BoorNetSize(controlPointsNumber));
+    bspline::CalculateBoorNet(&spline.floatControlPoints[0],
+                              controlPointsNumber, &spline.floatKnotVector[0],
+                              &spline.floatBoorNetPoints[0]);
+    return;
+  }
+  if (engine == EvaluationEngine) {
+    spline.evaluator.Prepare(3, spline.knotVector.constData(),
+                             spline.controlPoints, controlPointsNumber);
+    return;
+  }
+  if (engine == NurbsEngine) {
+    for (int counter = 0; counter < controlPointsNumber; ++counter)
+      spline.nurbsSpline.SetControlPoint(counter,
+                                         spline.controlPoints[counter]);
+    spline.nurbsSpline.Decompose();
+    return;
+  }
+  spline.boorNetPoints.resize(
+        BezierInterpolator::BoorNetSize(controlPointsNumber));
+  interpolators.interpolator.CalculateBoorNet(spline.controlPoints,
+                                              spline.knotVector,
+                                              spline.boorNetPoints.data());
+}
+
+// InterpolateFloat - second stage of a frame for FloatEngine.
+void InterpolateFloat(const bspline::BezierFlattener<float> &flattener,
+                      Spline &spline) {
+  const std::vector<Spline::FloatPoint> &boorNetPoints =
+      spline.floatBoorNetPoints;
+  std::vector<Spline::FloatPoint> &interpolatedPoints =
+      spline.floatInterpolatedPoints;
+  const int curvesNumber = ((int) boorNetPoints.size() - 1) / 3;
+
+  interpolatedPoints.resize(0);
+  interpolatedPoints.push_back(boorNetPoints.front());
+  for (int counter = 0; counter < curvesNumber; ++counter)
+    flattener.FlattenIterative(boorNetPoints[3 * counter],
+                               boorNetPoints[3 * counter + 1],
+                               boorNetPoints[3 * counter + 2],
+                               boorNetPoints[3 * counter + 3],
+                               interpolatedPoints);
+  interpolatedPoints.push_back(boorNetPoints.back());
+}
+
+// InterpolateCoherent - second stage of a frame for CoherentEngine, the same as
+// SplineCache does in animation.
+void InterpolateCoherent(const BezierInterpolator &interpolator,
+                         Spline &spline) {
+  const QPolygonF &boorNetPoints = spline.boorNetPoints;
+  const int curvesNumber = (boorNetPoints.size() - 1) / 3;
+  const bool warm = spline.depthEnds.size() == curvesNumber;
+  spline.depths.swap(spline.previousDepths);
+  spline.depthEnds.swap(spline.previousDepthEnds);
+  spline.depths.resize(0);
+  spline.depthEnds.resize(curvesNumber);
+
+  int previousBegin = 0;
+  for (int counter = 0; counter < curvesNumber; ++counter) {
+    const int first = 3 * counter;
+    const int previousEnd = warm ? spline.previousDepthEnds[counter] : 0;
+    interpolator.InterpolateCurve(boorNetPoints[first],
+                                  boorNetPoints[first + 1],
+                                  boorNetPoints[first + 2],
+                                  boorNetPoints[first + 3],
+                                  spline.previousDepths.constData() +
+                                  previousBegin,
+                                  previousEnd - previousBegin,
+                                  spline.interpolatedPoints, spline.depths);
+    previousBegin = previousEnd;
+    spline.depthEnds[counter] = spline.depths.size();
+  }
+}
+
+// Interpolate - second stage of a frame, interpolates boor net with \p engine.
+void Interpolate(const Interpolators &interpolators, Engine engine,
+                 Spline &spline) {
+  if (engine == FloatEngine) {
+    InterpolateFloat(interpolators.floatFlattener, spline);
+    return;
+  }
+  if (engine == EvaluationEngine) {
+    spline.evaluator.Evaluate(&spline.sampleParameters[0],
+                              (int) spline.sampleParameters.size(),
+                              &spline.sampleX[0], &spline.sampleY[0]);
+    return;
+  }
+  if (engine == NurbsEngine) {
+    spline.interpolatedPoints.resize(0);
+    spline.nurbsSpline.Interpolate(spline.interpolatedPoints);
+    return;
+  }
+  const BezierInterpolator &interpolator = interpolators.interpolator;
+  const QPolygonF &boorNetPoints = spline.boorNetPoints;
+  QPolygonF &interpolatedPoints = spline.interpolatedPoints;
+  const int curvesNumber = (boorNetPoints.size() - 1) / 3;
+
+  interpolatedPoints.resize(0);
+  interpolatedPoints.push_back(boorNetPoints.first());
+  switch (engine) {
+    case RecursiveEngine:
+      for (int counter = 0; counter < curvesNumber; ++counter)
+        interpolator.InterpolateBezier(boorNetPoints[3 * counter],
+                                       boorNetPoints[3 * counter + 1],
+                                       boorNetPoints[3 * counter + 2],
+                                       boorNetPoints[3 * counter + 3],
+                                       interpolatedPoints);
+      break;
+    case IterativeEngine:
+      for (int counter = 0; counter < curvesNumber; ++counter)
+        interpolator.InterpolateBezierIterative(boorNetPoints[3 * counter],
+                                                boorNetPoints[3 * counter + 1],
+                                                boorNetPoints[3 * counter + 2],
+                                                boorNetPoints[3 * counter + 3],
+                                                interpolatedPoints);
+      break;
+    case BatchEngine:
+    case ForwardDifferencingEngine:
+    case CurvatureEngine:
+    case ParallelEngine:
+      // Engines with predicted number of points fill output at once.
+      spline.boorNetX.resize(boorNetPoints.size());
+      spline.boorNetY.resize(boorNetPoints.size());
+      for (int counter = 0; counter < boorNetPoints.size(); ++counter) {
+        spline.boorNetX[counter] = boorNetPoints[counter].x();
+        spline.boorNetY[counter] = boorNetPoints[counter].y();
+      }
+      if (engine == ParallelEngine)
+        spline.parallelFlattener.InterpolateBezierBatch(
+              interpolator, spline.boorNetX.constData(),
+              spline.boorNetY.constData(), curvesNumber, interpolatedPoints);
+      else
+        interpolator.InterpolateBezierBatch(spline.boorNetX.constData(),
+                                            spline.boorNetY.constData(),
+                                            curvesNumber, interpolatedPoints);
+      break;
+    case CoherentEngine:
+      InterpolateCoherent(interpolator, spline);
+      break;
+    default:
+      Q_ASSERT(false);
+  }
+  interpolatedPoints.push_back(boorNetPoints.last());
+}
+
+long PeakMemory() {
+#ifdef Q_OS_UNIX
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0)
+    return usage.ru_maxrss;
+#endif
+  return -1;
+}
+
+// Run - animates spline until \p options.minTime passes and measures frames.
+// Long splines are moved and interpolated on threads of \p pool.
+Result Run(Engine engine, int controlPointsNumber, double distanceTolerance,
+           WorkStealingPool *pool, const Options &options) {
+  Interpolators interpolators(engine, distanceTolerance);
+  Spline spline;
+  FillSpline(controlPointsNumber, options.seed, spline);
+  spline.integrator.SetPool(pool);
+  spline.parallelFlattener.SetPool(pool);
+  spline.nurbsSpline.SetDistanceTolerance(distanceTolerance);
+
+  // Warm up: buffers of the spline are allocated in the first frame.
+  CalculateBoorNet(interpolators, engine, spline);
+  Interpolate(interpolators, engine, spline);
+
+  Result result;
+  result.engine = engine;
+  result.controlPointsNumber = controlPointsNumber;
+  result.distanceTolerance = distanceTolerance;
+  result.framesNumber = 0;
+
+  qint64 moveTime = 0;
+  qint64 boorNetTime = 0;
+  qint64 interpolationTime = 0;
+  unsigned long allocationsBefore = allocationsNumber;
+  QElapsedTimer totalTimer;
+  totalTimer.start();
+  QElapsedTimer stageTimer;
+  while (result.framesNumber < minFramesNumber ||
+         totalTimer.elapsed() < options.minTime) {
+    stageTimer.start();
+    MoveSpline(spline);
+    moveTime += stageTimer.nsecsElapsed();
+    stageTimer.start();
+    CalculateBoorNet(interpolators, engine, spline);
+    qint64 boorNetEnd = stageTimer.nsecsElapsed();
+    Interpolate(interpolators, engine, spline);
+    qint64 interpolationEnd = stageTimer.nsecsElapsed();
+    boorNetTime += boorNetEnd;
+    interpolationTime += interpolationEnd - boorNetEnd;
+    ++result.framesNumber;
+  }
+  unsigned long allocations = allocationsNumber - allocationsBefore;
+
+  if (engine == FloatEngine)
+    result.interpolatedPointsNumber =
+        (int) spline.floatInterpolatedPoints.size();
+  else if (engine == EvaluationEngine)
+    result.interpolatedPointsNumber = (int) spline.sampleParameters.size();
+  else
+    result.interpolatedPointsNumber = spline.interpolatedPoints.size();
+  result.moveTime = (double) moveTime / result.framesNumber;
+  result.boorNetTime = (double) boorNetTime / result.framesNumber;
+  result.interpolationTime = (double) interpolationTime / result.framesNumber;
+  result.allocationsPerFrame = (double) allocations / result.framesNumber;
+  result.peakMemory = PeakMemory();
+  return result;
+}
+
+void PrintResult(const Result &result, const Options &options, bool first) {
+  double frameTime = result.boorNetTime + result.interpolationTime;
+  double nsPerControlPoint = frameTime / result.controlPointsNumber;
+  double nsPerInterpolatedPoint = frameTime / result.interpolatedPointsNumber;
+  if (options.json) {
+    std::printf("%s  {\"engine\": \"%s\", \"control_points\": %d, "
+                "\"distance_tolerance\": %g, \"frames\": %d, "
+                "\"interpolated_points\": %d, \"move_ns\": %.1f, "
+                "\"boor_net_ns\": %.1f, "
+                "\"interpolation_ns\": %.1f, \"ns_per_control_point\": %.2f, "
+                "\"ns_per_interpolated_point\": %.2f, "
+                "\"allocations_per_frame\": %.2f, \"peak_memory_kb\": %ld}",
+                first ? "" : ",\n", engineNames[result.engine],
+                result.controlPointsNumber, result.distanceTolerance,
+                result.framesNumber, result.interpolatedPointsNumber,
+                result.moveTime, result.boorNetTime, result.interpolationTime,
+                nsPerControlPoint, nsPerInterpolatedPoint,
+                result.allocationsPerFrame, result.peakMemory);
+  } else {
+    std::printf("%s,%d,%g,%d,%d,%.1f,%.1f,%.1f,%.2f,%.2f,%.2f,%ld\n",
+                engineNames[result.engine], result.controlPointsNumber,
+                result.distanceTolerance, result.framesNumber,
+                result.interpolatedPointsNumber, result.moveTime,
+                result.boorNetTime, result.interpolationTime,
+                nsPerControlPoint, nsPerInterpolatedPoint,
+                result.allocationsPerFrame, result.peakMemory);
+  }
+  std::fflush(stdout);
+}
+
+// FillScene - adds splines of random length with random control points and
+// speeds to \p engine.
+void FillScene(int splinesNumber, unsigned seed, SplineEngine &engine) {
+  qsrand(seed);
+  const int speedLimit = 5;
+  QPolygonF points;
+  QPolygonF speeds;
+  for (int splineCounter = 0; splineCounter < splinesNumber;
+       ++splineCounter) {
+    const int controlPointsNumber =
+        minSceneSplineLength << (qrand() % sceneSplineOctaves);
+    points.resize(controlPointsNumber);
+    speeds.resize(controlPointsNumber);
+    for (int counter = 0; counter < controlPointsNumber; ++counter) {
+      points[counter] = QPointF(qrand() % areaWidth, qrand() % areaHeight);
+      speeds[counter] = QPointF(qrand() % speedLimit, qrand() % speedLimit);
+    }
+    engine.AddSpline(points, speeds);
+  }
+}
+
+// RunScene - animates scene of \p splinesNumber splines on threads of \p pool,
+// or on the calling thread if it is 0, until \p options.minTime passes and
+// measures frames.
+SceneResult RunScene(int splinesNumber, WorkStealingPool *pool,
+                     const Options &options) {
+  const int threadsNumber = pool ? pool->ThreadsNumber() : 1;
+  SplineEngine engine;
+  engine.SetPool(pool);
+  engine.Interpolator().SetDistanceTolerance(distanceTolerances[0]);
+  engine.SetCompactOutput(options.compact, options.compactFormat);
+  FillScene(splinesNumber, options.seed, engine);
+  // Splines are short, one integrator moves them all on the calling thread.
+  ControlPointIntegrator integrator;
+  integrator.SetBounds(areaWidth, areaHeight);
+
+  // Warm up: pool, tasks and buffers are allocated in the first frame.
+  engine.Update();
+
+  SceneResult result;
+  result.splinesNumber = splinesNumber;
+  result.threadsNumber = threadsNumber;
+  result.framesNumber = 0;
+  result.controlPointsNumber = 0;
+  for (int counter = 0; counter < splinesNumber; ++counter)
+    result.controlPointsNumber += engine.ControlPoints(counter).Size();
+
+  qint64 moveTime = 0;
+  qint64 frameTime = 0;
+  unsigned long allocationsBefore = allocationsNumber;
+  QElapsedTimer totalTimer;
+  totalTimer.start();
+  QElapsedTimer stageTimer;
+  while (result.framesNumber < minFramesNumber ||
+         totalTimer.elapsed() < options.minTime) {
+    stageTimer.start();
+    for (int counter = 0; counter < splinesNumber; ++counter)
+      integrator.Advance(engine.ControlPoints(counter));
+    moveTime += stageTimer.nsecsElapsed();
+    stageTimer.start();
+    engine.Update();
+    frameTime += stageTimer.nsecsElapsed();
+    ++result.framesNumber;
+  }
+  unsigned long allocations = allocationsNumber - allocationsBefore;
+
+  result.interpolatedPointsNumber = engine.InterpolatedPointsNumber();
+  result.moveTime = (double) moveTime / result.framesNumber;
+  result.frameTime = (double) frameTime / result.framesNumber;
+  result.splinesPerSecond = splinesNumber * 1e9 / result.frameTime;
+  result.allocationsPerFrame = (double) allocations / result.framesNumber;
+  result.peakMemory = PeakMemory();
+  result.pointsMemory = (long) (engine.InterpolatedPointsBytes() / 1024);
+  return result;
+}
+
+void PrintSceneResult(const SceneResult &result, const Options &options,
+                      bool first) {
+  if (options.json) {
+    std::printf("%s  {\"splines\": %d, \"threads\": %d, \"frames\": %d, "
+                "\"control_points\": %lld, \"interpolated_points\": %lld, "
+                "\"move_ns\": %.1f, \"frame_ns\": %.1f, "
+                "\"splines_per_second\": %.1f, "
+                "\"allocations_per_frame\": %.2f, \"peak_memory_kb\": %ld, "
+                "\"points_memory_kb\": %ld}",
+                first ? "" : ",\n", result.splinesNumber,
+                result.threadsNumber, result.framesNumber,
+                (long long) result.controlPointsNumber,
+                (long long) result.interpolatedPointsNumber, result.moveTime,
+                result.frameTime, result.splinesPerSecond,
+                result.allocationsPerFrame, result.peakMemory,
+                result.pointsMemory);
+  } else {
+    std::printf("%d,%d,%d,%lld,%lld,%.1f,%.1f,%.1f,%.2f,%ld,%ld\n",
+                result.splinesNumber, result.threadsNumber,
+                result.framesNumber, (long long) result.controlPointsNumber,
+                (long long) result.interpolatedPointsNumber, result.moveTime,
+                result.frameTime, result.splinesPerSecond,
+                result.allocationsPerFrame, result.peakMemory,
+                result.pointsMemory);
+  }
+  std::fflush(stdout);
+}
+
+// RunScenes - benchmarks SplineEngine on one thread and on threads of \p pool.
+void RunScenes(WorkStealingPool &pool, const Options &options) {
+  if (options.json)
+    std::printf("[\n");
+  else
+    std::printf("splines,threads,frames,control_points,interpolated_points,"
+                "move_ns,frame_ns,splines_per_second,allocations_per_frame,"
+                "peak_memory_kb,points_memory_kb\n");
+
+  const int sceneSplinesNumbersSize =
+      sizeof(sceneSplinesNumbers) / sizeof(sceneSplinesNumbers[0]);
+  bool first = true;
+  for (int splinesCounter = 0; splinesCounter < sceneSplinesNumbersSize;
+       ++splinesCounter) {
+    PrintSceneResult(RunScene(sceneSplinesNumbers[splinesCounter], 0, options),
+                     options, first);
+    first = false;
+    if (pool.ThreadsNumber() > 1)
+      PrintSceneResult(RunScene(sceneSplinesNumbers[splinesCounter], &pool,
+                                options),
+                       options, first);
+  }
+
+  if (options.json)
+    std::printf("\n]\n");
+}
+
+// Threads of parallel paths in checks, curves are split even on one core.
+const int verifyThreadsNumber = 4;
+
+// ReportCheck - prints outcome of check \p name. Returns 1 if it failed.
+int ReportCheck(const char *name, bool passed) {
+  std::printf("%s: %s\n", name, passed ? "ok" : "FAILED");
+  std::fflush(stdout);
+  return passed ? 0 : 1;
+}
+
+// SamePoints - whether polylines are equal bit by bit.
+bool SamePoints(const QPolygonF &first, const QPolygonF &second) {
+  if (first.size() != second.size())
+    return false;
+  for (int counter = 0; counter < first.size(); ++counter)
+    if (first[counter].x() != second[counter].x() ||
+        first[counter].y() != second[counter].y())
+      return false;
+  return true;
+}
+
+// ReferenceBoorNet - the original knot insertion of de Boor algorithm, which
+// raises multiplicity of every middle knot from 1 to 3 by inserting it twice
+// and rebuilds the whole net for every knot. It is quadratic and is kept only
+// as the reference for CalculateBoorNet().
+void ReferenceBoorNet(const QPolygonF &controlPoints,
+                      const QVector<qreal> &knotVector,
+                      QPolygonF &boorNetPoints) {
+  Q_ASSERT(controlPoints.size() > 2);
+  Q_ASSERT(knotVector.size() > 4);
+  // We draw uniform cubic B-spline that passes through endpoints, so we assume
+  // that multiplicity of first and last knot is 4 and 1 for knots between.
+
+  QVector<qreal> newKnotVector = knotVector;
+  boorNetPoints = controlPoints;
+
+  // Insert every middle knot 2 times to increase its multiplicity from 1 to 3.
+  const int curveDegree = 3;
+  const int increaseMultiplicity = 2;
+
+  for (int knotCounter = 4; knotCounter < newKnotVector.size() - 4;
+       knotCounter += 3) {
+    QHash< int, QHash<int, QPointF> > tempPoints;
+    for (int counter = knotCounter - curveDegree; counter <= knotCounter;
+         ++counter)
+      tempPoints[counter][0] = boorNetPoints[counter];
+
+    for (int insertCounter = 1; insertCounter <= increaseMultiplicity;
+         ++insertCounter)
+      for (int i = knotCounter - curveDegree + insertCounter; i < knotCounter;
+           ++i) {
+        double coeff = (newKnotVector[knotCounter] - newKnotVector[i]) /
+            (newKnotVector[i + curveDegree - insertCounter + 1] -
+             newKnotVector[i]);
+        QPointF newPoint =
+            (1.0 - coeff) * tempPoints[i - 1][insertCounter - 1] +
+            coeff * tempPoints[i][insertCounter - 1];
+        tempPoints[i][insertCounter] = newPoint;
+      }
+
+    for (int counter = 0; counter < increaseMultiplicity; ++counter)
+      newKnotVector.insert(knotCounter, newKnotVector[knotCounter]);
+
+    // Fill new control points.
+    QPolygonF newBoorNetPoints;
+    for (int counter = 0; counter <= knotCounter - curveDegree; ++counter)
+      newBoorNetPoints.push_back(boorNetPoints[counter]);
+
+    for (int counter = 1; counter <= increaseMultiplicity; ++counter) {
+      QPointF &newP = tempPoints[knotCounter - curveDegree + counter][counter];
+      newBoorNetPoints.push_back(newP);
+    }
+
+    for (int counter = -curveDegree + increaseMultiplicity + 1; counter <= -1;
+         ++counter) {
+      QPointF &newP = tempPoints[knotCounter + counter][increaseMultiplicity];
+      newBoorNetPoints.push_back(newP);
+    }
+
+    for (int counter = increaseMultiplicity - 1; counter >= 1; --counter)
+      newBoorNetPoints.push_back(tempPoints[knotCounter - 1][counter]);
+
+    for (int counter = knotCounter - 1; counter < boorNetPoints.size();
+         ++counter)
+      newBoorNetPoints.push_back(boorNetPoints[counter]);
+
+    boorNetPoints = newBoorNetPoints;
+  }
+}
+
+// VerifyBoorNet - both overloads of BezierInterpolator::CalculateBoorNet give
+// the same boor net as ReferenceBoorNet bit for bit. The reference is
+// quadratic, so long splines are skipped.
+bool VerifyBoorNet(const Options &options) {
+  const int maxControlPointsNumber = 1024;
+  const int controlPointsNumbersSize =
+      sizeof(controlPointsNumbers) / sizeof(controlPointsNumbers[0]);
+  BezierInterpolator interpolator;
+  for (int pointsCounter = 0; pointsCounter < controlPointsNumbersSize;
+       ++pointsCounter) {
+    const int controlPointsNumber = controlPointsNumbers[pointsCounter];
+    if (controlPointsNumber > maxControlPointsNumber)
+      continue;
+    Spline spline;
+    FillSpline(controlPointsNumber, options.seed, spline);
+    QPolygonF controlPoints;
+    spline.controlPoints.CopyPoints(controlPoints);
+    QPolygonF referencePoints;
+    ReferenceBoorNet(controlPoints, spline.knotVector, referencePoints);
+    QPolygonF polygonPoints;
+    interpolator.CalculateBoorNet(controlPoints, spline.knotVector,
+                                  polygonPoints);
+    QPolygonF storePoints;
+    storePoints.resize(BezierInterpolator::BoorNetSize(controlPointsNumber));
+    interpolator.CalculateBoorNet(spline.controlPoints, spline.knotVector,
+                                  storePoints.data());
+    if (!SamePoints(referencePoints, polygonPoints) ||
+        !SamePoints(referencePoints, storePoints))
+      return false;
+  }
+  return true;
+}
+
+// FillBoorNetArrays - calculates boor net of \p spline and copies it into
+// structure-of-arrays form taken by InterpolateBezierBatch().
+void FillBoorNetArrays(const BezierInterpolator &interpolator, Spline &spline,
+                       QVector<double> &x, QVector<double> &y) {
+  spline.boorNetPoints.resize(
+        BezierInterpolator::BoorNetSize(spline.controlPoints.Size()));
+  interpolator.CalculateBoorNet(spline.controlPoints, spline.knotVector,
+                                spline.boorNetPoints.data());
+  const int boorNetSize = spline.boorNetPoints.size();
+  x.resize(boorNetSize);
+  y.resize(boorNetSize);
+  for (int counter = 0; counter < boorNetSize; ++counter) {
+    x[counter] = spline.boorNetPoints[counter].x();
+    y[counter] = spline.boorNetPoints[counter].y();
+  }
+}
+
+// VerifyBatch - BezierInterpolator::InterpolateBezierBatch gives the same
+// points as InterpolateCurve called for every curve with every engine, with
+// and without clipping, and the ends of curves where InterpolateCurve leaves
+// them. CountBezierBatch predicts number of appended points exactly.
+bool VerifyBatch(const Options &options) {
+  Spline spline;
+  FillSpline(controlPointsNumbers[7], options.seed, spline);
+  BezierInterpolator interpolator;
+  QVector<double> x;
+  QVector<double> y;
+  FillBoorNetArrays(interpolator, spline, x, y);
+  const QPolygonF &boorNetPoints = spline.boorNetPoints;
+  const int curvesNumber = (boorNetPoints.size() - 1) / 3;
+
+  const BezierInterpolator::InterpolationEngine engines[] = {
+    BezierInterpolator::SubdivisionEngine,
+    BezierInterpolator::ForwardDifferencingEngine,
+    BezierInterpolator::CurvatureEngine
+  };
+  for (int engine = 0; engine < 3; ++engine)
+    for (int clipped = 0; clipped < 2; ++clipped) {
+      interpolator.SetEngine(engines[engine]);
+      interpolator.SetClipRect(clipped ?
+            QRectF(areaWidth / 4, areaHeight / 4, areaWidth / 2,
+                   areaHeight / 2) : QRectF());
+      QPolygonF curvePoints;
+      curvePoints.push_back(boorNetPoints[0]);
+      QPolygonF batchPoints = curvePoints;
+      QVector<int> curveEnds(curvesNumber);
+      QVector<int> batchEnds(curvesNumber);
+      for (int counter = 0; counter < curvesNumber; ++counter) {
+        interpolator.InterpolateCurve(boorNetPoints[3 * counter],
+                                      boorNetPoints[3 * counter + 1],
+                                      boorNetPoints[3 * counter + 2],
+                                      boorNetPoints[3 * counter + 3],
+                                      curvePoints);
+        curveEnds[counter] = curvePoints.size();
+      }
+      interpolator.InterpolateBezierBatch(x.constData(), y.constData(),
+                                          curvesNumber, batchPoints,
+                                          batchEnds.data());
+      const int count = interpolator.CountBezierBatch(x.constData(),
+                                                      y.constData(),
+                                                      curvesNumber);
+      if (!SamePoints(curvePoints, batchPoints) || curveEnds != batchEnds ||
+          count != batchPoints.size() - 1)
+        return false;
+    }
+  return true;
+}
+
+// VerifySplineCache - after random moves of single control points and of the
+// clip rectangle, boor net and interpolated points spliced by SplineCache are
+// the same bit for bit as rebuilt from scratch. Subdivision starts from the
+// previous frame and differs from a cold start by design, so it is skipped.
+bool VerifySplineCache(const Options &options) {
+  const int stepsNumber = 200;
+  const BezierInterpolator::InterpolationEngine engines[] = {
+    BezierInterpolator::ForwardDifferencingEngine,
+    BezierInterpolator::CurvatureEngine
+  };
+  for (int engine = 0; engine < 2; ++engine) {
+    Spline spline;
+    FillSpline(controlPointsNumbers[4], options.seed, spline);
+    const int controlPointsNumber = spline.controlPoints.Size();
+    BezierInterpolator interpolator;
+    interpolator.SetEngine(engines[engine]);
+    SplineCache cache;
+    QPolygonF boorNetPoints;
+    QPolygonF interpolatedPoints;
+    cache.Update(interpolator, spline.controlPoints, spline.knotVector,
+                 boorNetPoints, interpolatedPoints);
+    for (int step = 0; step < stepsNumber; ++step) {
+      if (qrand() % 4 == 0) {
+        const QRectF rect = qrand() % 4 == 0 ? QRectF() :
+            QRectF(qrand() % areaWidth - areaWidth / 2,
+                   qrand() % areaHeight - areaHeight / 2, areaWidth / 2,
+                   areaHeight / 2);
+        cache.SetClipRect(interpolator, rect, boorNetPoints);
+      } else {
+        const int index = qrand() % controlPointsNumber;
+        spline.controlPoints.SetPoint(
+              index, QPointF(qrand() % areaWidth, qrand() % areaHeight));
+        cache.ControlPointMoved(index);
+      }
+      cache.Update(interpolator, spline.controlPoints, spline.knotVector,
+                   boorNetPoints, interpolatedPoints);
+
+      SplineCache freshCache;
+      QPolygonF freshBoorNetPoints;
+      QPolygonF freshInterpolatedPoints;
+      freshCache.Update(interpolator, spline.controlPoints, spline.knotVector,
+                        freshBoorNetPoints, freshInterpolatedPoints);
+      if (!SamePoints(boorNetPoints, freshBoorNetPoints) ||
+          !SamePoints(interpolatedPoints, freshInterpolatedPoints))
+        return false;
+    }
+  }
+  return true;
+}
+
+// VerifyParallelFlattener - ParallelFlattener gives the same points and ends
+// of curves as BezierInterpolator::InterpolateBezierBatch with every engine,
+// with and without clipping.
+bool VerifyParallelFlattener(WorkStealingPool &pool, const Options &options) {
+  Spline spline;
+  FillSpline(controlPointsNumbers[7], options.seed, spline);
+  BezierInterpolator interpolator;
+  QVector<double> x;
+  QVector<double> y;
+  FillBoorNetArrays(interpolator, spline, x, y);
+  const int curvesNumber = (spline.boorNetPoints.size() - 1) / 3;
+
+  ParallelFlattener parallelFlattener;
+  parallelFlattener.SetPool(&pool);
+  const BezierInterpolator::InterpolationEngine engines[] = {
+    BezierInterpolator::SubdivisionEngine,
+    BezierInterpolator::ForwardDifferencingEngine,
+    BezierInterpolator::CurvatureEngine
+  };
+  bool passed = true;
+  for (int engine = 0; engine < 3; ++engine)
+    for (int clipped = 0; clipped < 2; ++clipped) {
+      interpolator.SetEngine(engines[engine]);
+      interpolator.SetClipRect(clipped ?
+            QRectF(areaWidth / 4, areaHeight / 4, areaWidth / 2,
+                   areaHeight / 2) : QRectF());
+      QPolygonF serialPoints;
+      serialPoints.push_back(spline.boorNetPoints[0]);
+      QPolygonF parallelPoints = serialPoints;
+      QVector<int> serialEnds(curvesNumber);
+      QVector<int> parallelEnds(curvesNumber);
+      interpolator.InterpolateBezierBatch(x.constData(), y.constData(),
+                                          curvesNumber, serialPoints,
+                                          serialEnds.data());
+      parallelFlattener.InterpolateBezierBatch(interpolator, x.constData(),
+                                               y.constData(), curvesNumber,
+                                               parallelPoints,
+                                               parallelEnds.data());
+      passed = passed && SamePoints(serialPoints, parallelPoints) &&
+               serialEnds == parallelEnds;
+    }
+  return passed;
+}
+
+// VerifyIntegrator - SIMD kernels of ControlPointIntegrator move points the
+// same as scalar code bit for bit, including reflection from borders and
+// relocation of points left out of bounds when bounds shrink.
+bool VerifyIntegrator(const Options &options) {
+  const int pointsNumber = 1001;
+  const int stepsNumber = 200;
+  qsrand(options.seed);
+  ControlPointStore simdStore;
+  for (int counter = 0; counter < pointsNumber; ++counter)
+    simdStore.Add(QPointF(qrand() % areaWidth, qrand() % areaHeight),
+                  QPointF(qrand() % 41 - 20, qrand() % 41 - 20));
+  ControlPointStore scalarStore = simdStore;
+  ControlPointIntegrator simdIntegrator;
+  ControlPointIntegrator scalarIntegrator;
+  scalarIntegrator.SetSimd(false);
+  for (int step = 0; step < stepsNumber; ++step) {
+    const int width = step < stepsNumber / 2 ? areaWidth : areaWidth / 2;
+    const int height = step < stepsNumber / 2 ? areaHeight : areaHeight / 2;
+    simdIntegrator.SetBounds(width, height);
+    scalarIntegrator.SetBounds(width, height);
+    simdIntegrator.Advance(simdStore);
+    scalarIntegrator.Advance(scalarStore);
+  }
+  for (int counter = 0; counter < pointsNumber; ++counter)
+    if (simdStore.X()[counter] != scalarStore.X()[counter] ||
+        simdStore.Y()[counter] != scalarStore.Y()[counter] ||
+        simdStore.SpeedX()[counter] != scalarStore.SpeedX()[counter] ||
+        simdStore.SpeedY()[counter] != scalarStore.SpeedY()[counter])
+      return false;
+  return true;
+}
+
+// VerifySplineEngine - SplineEngine gives the same boor nets and interpolated
+// points of every spline on threads of \p pool as on the calling thread, frame
+// after frame.
+bool VerifySplineEngine(WorkStealingPool &pool, const Options &options) {
+  const int splinesNumber = 300;
+  const int framesNumber = 3;
+  SplineEngine serialEngine;
+  SplineEngine parallelEngine;
+  parallelEngine.SetPool(&pool);
+  FillScene(splinesNumber, options.seed, serialEngine);
+  FillScene(splinesNumber, options.seed, parallelEngine);
+  ControlPointIntegrator integrator;
+  integrator.SetBounds(areaWidth, areaHeight);
+  for (int frame = 0; frame < framesNumber; ++frame) {
+    for (int counter = 0; counter < splinesNumber; ++counter) {
+      integrator.Advance(serialEngine.ControlPoints(counter));
+      integrator.Advance(parallelEngine.ControlPoints(counter));
+    }
+    serialEngine.Update();
+    parallelEngine.Update();
+    for (int counter = 0; counter < splinesNumber; ++counter)
+      if (!SamePoints(serialEngine.BoorNetPoints(counter),
+                      parallelEngine.BoorNetPoints(counter)) ||
+          !SamePoints(serialEngine.InterpolatedPoints(counter),
+                      parallelEngine.InterpolatedPoints(counter)))
+        return false;
+  }
+  return true;
+}
+
+// VerifyCompactPolyline - points of the scene read back from CompactPolyline in
+// delta format are at most 1/32 of pixel off points kept in QPolygonF, and
+// runs read from the middle of polylines are the same as the whole polylines.
+bool VerifyCompactPolyline(const Options &options) {
+  const int splinesNumber = 300;
+  const qreal maxError = 1.0 / 32 + 1e-9;
+  SplineEngine engine;
+  SplineEngine compactEngine;
+  compactEngine.SetCompactOutput(true, CompactPolyline::DeltaFormat);
+  FillScene(splinesNumber, options.seed, engine);
+  FillScene(splinesNumber, options.seed, compactEngine);
+  engine.Update();
+  compactEngine.Update();
+  QPolygonF points;
+  QPolygonF run;
+  qsrand(options.seed);
+  for (int counter = 0; counter < splinesNumber; ++counter) {
+    const QPolygonF &expected = engine.InterpolatedPoints(counter);
+    const CompactPolyline &polyline = compactEngine.CompactPoints(counter);
+    const int size = polyline.size();
+    if (size != expected.size())
+      return false;
+    points.resize(size);
+    polyline.Read(0, size, points.data());
+    for (int index = 0; index < size; ++index)
+      if (qAbs(points[index].x() - expected[index].x()) > maxError ||
+          qAbs(points[index].y() - expected[index].y()) > maxError)
+        return false;
+    const int first = size > 0 ? qrand() % size : 0;
+    const int number = size > first ? qrand() % (size - first) + 1 : 0;
+    run.resize(number);
+    polyline.Read(first, number, run.data());
+    for (int index = 0; index < number; ++index)
+      if (run[index] != points[first + index])
+        return false;
+  }
+  return true;
+}
+
+// RunVerify - runs all checks. Returns number of failed ones.
+int RunVerify(const Options &options) {
+  WorkStealingPool pool(verifyThreadsNumber);
+  int failures = 0;
+  failures += ReportCheck("boor_net_equals_knot_insertion",
+                          VerifyBoorNet(options));
+  failures += ReportCheck("batch_equals_curve_by_curve",
+                          VerifyBatch(options));
+  failures += ReportCheck("spline_cache_splice_equals_rebuild",
+                          VerifySplineCache(options));
+  failures += ReportCheck("parallel_flattener_equals_serial",
+                          VerifyParallelFlattener(pool, options));
+  failures += ReportCheck("simd_integrator_equals_scalar",
+                          VerifyIntegrator(options));
+  failures += ReportCheck("spline_engine_threads_equal_one_thread",
+                          VerifySplineEngine(pool, options));
+  failures += ReportCheck("compact_polyline_within_1_32_pixel",
+                          VerifyCompactPolyline(options));
+  return failures;
+}
+
+bool ParseOptions(int argc, char *argv[], Options &options) {
+  for (int counter = 1; counter < argc; ++counter) {
+    const char *argument = argv[counter];
+    if (std::strcmp(argument, "--json") == 0) {
+      options.json = true;
+    } else if (std::strcmp(argument, "--seed") == 0 && counter + 1 < argc) {
+      options.seed = std::strtoul(argv[++counter], 0, 10);
+    } else if (std::strcmp(argument, "--min-time") == 0 &&
+               counter + 1 < argc) {
+      options.minTime = std::strtol(argv[++counter], 0, 10);
+    } else if (std::strcmp(argument, "--threads") == 0 &&
+               counter + 1 < argc) {
+      options.threadsNumber = std::strtol(argv[++counter], 0, 10);
+    } else if (std::strcmp(argument, "--scene") == 0) {
+      options.scene = true;
+    } else if (std::strcmp(argument, "--compact") == 0 &&
+               counter + 1 < argc &&
+               (std::strcmp(argv[counter + 1], "float") == 0 ||
+                std::strcmp(argv[counter + 1], "delta") == 0)) {
+      options.compact = true;
+      options.compactFormat =
+          std::strcmp(argv[++counter], "float") == 0 ?
+            CompactPolyline::FloatFormat : CompactPolyline::DeltaFormat;
+    } else if (std::strcmp(argument, "--verify") == 0) {
+      options.verify = true;
+    } else {
+      std::fprintf(stderr, "Usage: %s [--json] [--seed N] [--min-time MS] "
+                   "[--threads N] [--scene] [--compact float|delta] "
+                   "[--verify]\n",
+                   argv[0]);
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  if (!ParseOptions(argc, argv, options))
+    return 1;
+  if (options.verify)
+    return RunVerify(options) > 0 ? 1 : 0;
+  // All threads of the benchmark are threads of this pool.
+  WorkStealingPool pool(options.threadsNumber);
+  if (options.scene) {
+    RunScenes(pool, options);
+    return 0;
+  }
+
+  if (options.json)
+    std::printf("[\n");
+  else
+    std::printf("engine,control_points,distance_tolerance,frames,"
+                "interpolated_points,move_ns,boor_net_ns,interpolation_ns,"
+                "ns_per_control_point,ns_per_interpolated_point,"
+                "allocations_per_frame,peak_memory_kb\n");
+
+  const int controlPointsNumbersSize =
+      sizeof(controlPointsNumbers) / sizeof(controlPointsNumbers[0]);
+  const int distanceTolerancesSize =
+      sizeof(distanceTolerances) / sizeof(distanceTolerances[0]);
+  bool first = true;
+  for (int engine = 0; engine < EnginesNumber; ++engine)
+    for (int pointsCounter = 0; pointsCounter < controlPointsNumbersSize;
+         ++pointsCounter)
+      for (int toleranceCounter = 0; toleranceCounter < distanceTolerancesSize;
+           ++toleranceCounter) {
+        PrintResult(Run(static_cast<Engine>(engine),
+                        controlPointsNumbers[pointsCounter],
+                        distanceTolerances[toleranceCounter], &pool,
+                        options),
+                    options, first);
+        first = false;
+      }
+
+  if (options.json)
+    std::printf("\n]\n");
+  return 0;
+}
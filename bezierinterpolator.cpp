@@ -1,235 +1,411 @@
 #include "bezierinterpolator.h"
-#include <QtCore/qmath.h>
-#include <QHash>
+#include <QAtomicInt>
+#include <QVarLengthArray>
+#include <limits>
+
+namespace {
+
+// InterpolatePredicted - interpolates curves with \p flattener which knows
+// number of points of every curve in advance. Points of all curves are counted
+// first, then \p interpolatedPoints is resized once and filled.
+template <typename Flattener>
+void InterpolatePredicted(const Flattener &flattener, const double *x,
+                          const double *y, int curvesNumber,
+                          QPolygonF &interpolatedPoints, int *curveEnds) {
+  const int begin = interpolatedPoints.size();
+  int end = begin;
+  for (int counter = 0; counter < curvesNumber; ++counter) {
+    const int first = 3 * counter;
+    end += flattener.PointsNumber(QPointF(x[first], y[first]),
+                                  QPointF(x[first + 1], y[first + 1]),
+                                  QPointF(x[first + 2], y[first + 2]),
+                                  QPointF(x[first + 3], y[first + 3]));
+    if (curveEnds)
+      curveEnds[counter] = end;
+  }
+  interpolatedPoints.resize(end);
+
+  QPointF *points = interpolatedPoints.data();
+  int curveBegin = begin;
+  for (int counter = 0; counter < curvesNumber; ++counter) {
+    const int first = 3 * counter;
+    const QPointF p1(x[first], y[first]);
+    const QPointF p2(x[first + 1], y[first + 1]);
+    const QPointF p3(x[first + 2], y[first + 2]);
+    const QPointF p4(x[first + 3], y[first + 3]);
+    // Counts are not kept if caller doesn't need them.
+    const int pointsNumber = curveEnds ?
+          curveEnds[counter] - curveBegin :
+          flattener.PointsNumber(p1, p2, p3, p4);
+    flattener.Evaluate(p1, p2, p3, p4, pointsNumber, points + curveBegin);
+    curveBegin += pointsNumber;
+  }
+}
+
+// AppendPredicted - evaluates curve with \p flattener which knows number of
+// its points in advance and appends them to \p interpolatedPoints.
+template <typename Flattener>
+void AppendPredicted(const Flattener &flattener, const QPointF &p1,
+                     const QPointF &p2, const QPointF &p3, const QPointF &p4,
+                     CompactPolyline &interpolatedPoints) {
+  const int pointsNumber = flattener.PointsNumber(p1, p2, p3, p4);
+  QVarLengthArray<QPointF, 256> points(pointsNumber);
+  flattener.Evaluate(p1, p2, p3, p4, pointsNumber, points.data());
+  interpolatedPoints.Append(points.constData(), pointsNumber);
+}
+
+// PointsCounter - output of flatteners which only counts points.
+struct PointsCounter {
+  PointsCounter() : number(0) {}
 
-const unsigned BezierInterpolator::curveRecursionLimit = 32;
-const double BezierInterpolator::curveCollinearityEpsilon = 1e-30;
-const double BezierInterpolator::curveAngleToleranceEpsilon = 0.01;
-const double BezierInterpolator::AngleTolerance = 0.0;
-const double BezierInterpolator::CuspLimit = 0.0;
+  void push_back(const QPointF &) { ++number; }
+  int size() const { return number; }
+  // Flatteners never reserve storage of unlimited capacity.
+  int capacity() const { return std::numeric_limits<int>::max(); }
+  void reserve(int) {}
 
-BezierInterpolator::BezierInterpolator() : DistanceTolerance(0.5) {}
+  int number;
+};
+
+// PointsWriter - output of flatteners into buffer allocated by caller.
+struct PointsWriter {
+  explicit PointsWriter(QPointF *points) : points(points), number(0) {}
+
+  void push_back(const QPointF &point) { points[number++] = point; }
+  int size() const { return number; }
+  int capacity() const { return std::numeric_limits<int>::max(); }
+  void reserve(int) {}
+
+  QPointF *points;
+  int number;
+};
+
+// Revision of the last change of settings of any interpolator.
+QAtomicInt lastRevision(0);
+
+inline int NextRevision() {
+  return lastRevision.fetchAndAddOrdered(1) + 1;
+}
+
+} // namespace
+
+BezierInterpolator::BezierInterpolator() :
+  engine(SubdivisionEngine), revision(NextRevision()) {}
 
 // InterpolateBezier - interpolates points with bezier curve.
-// Algorithm is based on article "Adaptive Subdivision of Bezier Curves" by
-// Maxim Shemanarev.
-// http://www.antigrain.com/research/adaptive_bezier/index.html
 void BezierInterpolator::InterpolateBezier(double x1, double y1,
                                            double x2, double y2,
                                            double x3, double y3,
                                            double x4, double y4,
                                            QPolygonF &interpolatedPoints,
                                            unsigned level) const {
-  if(level > curveRecursionLimit) {
+  if (angleFlattener.ChecksAngles())
+    angleFlattener.Flatten(x1, y1, x2, y2, x3, y3, x4, y4, interpolatedPoints,
+                           level);
+  else
+    flattener.Flatten(x1, y1, x2, y2, x3, y3, x4, y4, interpolatedPoints,
+                      level);
+}
+
+void BezierInterpolator::InterpolateBezier(const QPointF &p1, const QPointF &p2,
+                                           const QPointF &p3, const QPointF &p4,
+                                           QPolygonF &interpolatedPoints,
+                                           unsigned level) const {
+  InterpolateBezier(p1.x(), p1.y(), p2.x(), p2.y(), p3.x(), p3.y(), p4.x(),
+                    p4.y(), interpolatedPoints, level);
+}
+
+// InterpolateBezierIterative - the same as InterpolateBezier but uses explicit
+// stack instead of recursion and reserves storage before appending points.
+void BezierInterpolator::InterpolateBezierIterative(
+    const QPointF &p1, const QPointF &p2, const QPointF &p3, const QPointF &p4,
+    QPolygonF &interpolatedPoints) const {
+  if (angleFlattener.ChecksAngles())
+    angleFlattener.FlattenIterative(p1, p2, p3, p4, interpolatedPoints);
+  else
+    flattener.FlattenIterative(p1, p2, p3, p4, interpolatedPoints);
+}
+
+// InterpolateCurve - interpolates Bezier curve with selected engine.
+void BezierInterpolator::InterpolateCurve(const QPointF &p1, const QPointF &p2,
+                                          const QPointF &p3, const QPointF &p4,
+                                          QPolygonF &interpolatedPoints) const {
+  if (CurveOutside(p1, p2, p3, p4)) {
+    interpolatedPoints.push_back(p4);
     return;
   }
+  switch (engine) {
+    case SubdivisionEngine:
+      InterpolateBezierIterative(p1, p2, p3, p4, interpolatedPoints);
+      break;
+    case ForwardDifferencingEngine:
+      forwardFlattener.Flatten(p1, p2, p3, p4, interpolatedPoints);
+      break;
+    case CurvatureEngine:
+      curvatureFlattener.Flatten(p1, p2, p3, p4, interpolatedPoints);
+      break;
+  }
+}
 
-  // Calculate all the mid-points of the line segments
-  double x12   = (x1 + x2) / 2;
-  double y12   = (y1 + y2) / 2;
-  double x23   = (x2 + x3) / 2;
-  double y23   = (y2 + y3) / 2;
-  double x34   = (x3 + x4) / 2;
-  double y34   = (y3 + y4) / 2;
-  double x123  = (x12 + x23) / 2;
-  double y123  = (y12 + y23) / 2;
-  double x234  = (x23 + x34) / 2;
-  double y234  = (y23 + y34) / 2;
-  double x1234 = (x123 + x234) / 2;
-  double y1234 = (y123 + y234) / 2;
-
-  if(level > 0) {
-    // Enforce subdivision first time
-
-    // Try to approximate the full cubic curve by a single straight line
-    double dx = x4-x1;
-    double dy = y4-y1;
-
-    double d2 = qAbs(((x2 - x4) * dy - (y2 - y4) * dx));
-    double d3 = qAbs(((x3 - x4) * dy - (y3 - y4) * dx));
-
-    double da1, da2;
-
-    if(d2 > curveCollinearityEpsilon && d3 > curveCollinearityEpsilon) {
-      // Regular care
-      if((d2 + d3)*(d2 + d3) <= DistanceTolerance * (dx*dx + dy*dy)) {
-        // If the curvature doesn't exceed the distance_tolerance value
-        // we tend to finish subdivisions.
-        if(AngleTolerance < curveAngleToleranceEpsilon) {
-          interpolatedPoints.push_back(QPointF(x1234, y1234));
-          return;
-        }
-
-        // Angle & Cusp Condition
-        double a23 = qAtan2(y3 - y2, x3 - x2);
-        da1 = fabs(a23 - qAtan2(y2 - y1, x2 - x1));
-        da2 = fabs(qAtan2(y4 - y3, x4 - x3) - a23);
-        if(da1 >= M_PI) da1 = 2*M_PI - da1;
-        if(da2 >= M_PI) da2 = 2*M_PI - da2;
-
-        if(da1 + da2 < AngleTolerance) {
-          // Finally we can stop the recursion
-          interpolatedPoints.push_back(QPointF(x1234, y1234));
-          return;
-        }
+// InterpolateCurve - the same, subdivision starts from the previous one.
+void BezierInterpolator::InterpolateCurve(
+    const QPointF &p1, const QPointF &p2, const QPointF &p3, const QPointF &p4,
+    const unsigned char *previousDepths, int previousDepthsNumber,
+    QPolygonF &interpolatedPoints, QVector<unsigned char> &depths) const {
+  if (engine != SubdivisionEngine || CurveOutside(p1, p2, p3, p4)) {
+    InterpolateCurve(p1, p2, p3, p4, interpolatedPoints);
+    return;
+  }
+  if (angleFlattener.ChecksAngles())
+    angleFlattener.FlattenCoherent(p1, p2, p3, p4, previousDepths,
+                                   previousDepthsNumber, interpolatedPoints,
+                                   depths);
+  else
+    flattener.FlattenCoherent(p1, p2, p3, p4, previousDepths,
+                              previousDepthsNumber, interpolatedPoints,
+                              depths);
+}
 
-        if(CuspLimit != 0.0) {
-          if(da1 > CuspLimit) {
-            interpolatedPoints.push_back(QPointF(x2, y2));
-            return;
-          }
+// InterpolateCurve - the same, flatteners of subdivision take compact storage
+// as their output.
+void BezierInterpolator::InterpolateCurve(
+    const QPointF &p1, const QPointF &p2, const QPointF &p3, const QPointF &p4,
+    CompactPolyline &interpolatedPoints) const {
+  if (CurveOutside(p1, p2, p3, p4)) {
+    interpolatedPoints.push_back(p4);
+    return;
+  }
+  switch (engine) {
+    case SubdivisionEngine:
+      if (angleFlattener.ChecksAngles())
+        angleFlattener.FlattenIterative(p1, p2, p3, p4, interpolatedPoints);
+      else
+        flattener.FlattenIterative(p1, p2, p3, p4, interpolatedPoints);
+      break;
+    case ForwardDifferencingEngine:
+      AppendPredicted(forwardFlattener, p1, p2, p3, p4, interpolatedPoints);
+      break;
+    case CurvatureEngine:
+      AppendPredicted(curvatureFlattener, p1, p2, p3, p4, interpolatedPoints);
+      break;
+  }
+}
 
-          if(da2 > CuspLimit) {
-            interpolatedPoints.push_back(QPointF(x3, y3));
-            return;
-          }
-        }
+// CountBezierBatch - counts points of every curve like InterpolateCurve()
+// appends them.
+int BezierInterpolator::CountBezierBatch(const double *x, const double *y,
+                                         int curvesNumber) const {
+  int pointsNumber = 0;
+  for (int counter = 0; counter < curvesNumber; ++counter) {
+    const int first = 3 * counter;
+    const QPointF p1(x[first], y[first]);
+    const QPointF p2(x[first + 1], y[first + 1]);
+    const QPointF p3(x[first + 2], y[first + 2]);
+    const QPointF p4(x[first + 3], y[first + 3]);
+    if (CurveOutside(p1, p2, p3, p4)) {
+      ++pointsNumber;
+      continue;
+    }
+    switch (engine) {
+      case SubdivisionEngine: {
+        PointsCounter output;
+        if (angleFlattener.ChecksAngles())
+          angleFlattener.FlattenIterative(p1, p2, p3, p4, output);
+        else
+          flattener.FlattenIterative(p1, p2, p3, p4, output);
+        pointsNumber += output.number;
+        break;
       }
+      case ForwardDifferencingEngine:
+        pointsNumber += forwardFlattener.PointsNumber(p1, p2, p3, p4);
+        break;
+      case CurvatureEngine:
+        pointsNumber += curvatureFlattener.PointsNumber(p1, p2, p3, p4);
+        break;
+    }
+  }
+  return pointsNumber;
+}
+
+// FillBezierBatch - flatteners write points straight into \p output.
+void BezierInterpolator::FillBezierBatch(const double *x, const double *y,
+                                         int curvesNumber, QPointF *output,
+                                         int offset, int *curveEnds) const {
+  int end = offset;
+  for (int counter = 0; counter < curvesNumber; ++counter) {
+    const int first = 3 * counter;
+    const QPointF p1(x[first], y[first]);
+    const QPointF p2(x[first + 1], y[first + 1]);
+    const QPointF p3(x[first + 2], y[first + 2]);
+    const QPointF p4(x[first + 3], y[first + 3]);
+    if (CurveOutside(p1, p2, p3, p4)) {
+      output[end++] = p4;
     } else {
-      if(d2 > curveCollinearityEpsilon) {
-        // p1,p3,p4 are collinear, p2 is considerable
-        if(d2 * d2 <= DistanceTolerance * (dx*dx + dy*dy)) {
-          if(AngleTolerance < curveAngleToleranceEpsilon) {
-            interpolatedPoints.push_back(QPointF(x1234, y1234));
-            return;
-          }
-
-          // Angle Condition
-          da1 = fabs(qAtan2(y3 - y2, x3 - x2) - qAtan2(y2 - y1, x2 - x1));
-          if(da1 >= M_PI)
-            da1 = 2*M_PI - da1;
-
-          if(da1 < AngleTolerance) {
-            interpolatedPoints.push_back(QPointF(x2, y2));
-            interpolatedPoints.push_back(QPointF(x3, y3));
-            return;
-          }
-
-          if(CuspLimit != 0.0) {
-            if(da1 > CuspLimit) {
-              interpolatedPoints.push_back(QPointF(x2, y2));
-              return;
-            }
-          }
+      switch (engine) {
+        case SubdivisionEngine: {
+          PointsWriter writer(output + end);
+          if (angleFlattener.ChecksAngles())
+            angleFlattener.FlattenIterative(p1, p2, p3, p4, writer);
+          else
+            flattener.FlattenIterative(p1, p2, p3, p4, writer);
+          end += writer.number;
+          break;
         }
-      } else if(d3 > curveCollinearityEpsilon) {
-        // p1,p2,p4 are collinear, p3 is considerable
-        if(d3 * d3 <= DistanceTolerance * (dx*dx + dy*dy)) {
-          if(AngleTolerance < curveAngleToleranceEpsilon) {
-            interpolatedPoints.push_back(QPointF(x1234, y1234));
-            return;
-          }
-
-          // Angle Condition
-          da1 = fabs(qAtan2(y4 - y3, x4 - x3) - qAtan2(y3 - y2, x3 - x2));
-          if(da1 >= M_PI) da1 = 2*M_PI - da1;
-
-          if(da1 < AngleTolerance) {
-            interpolatedPoints.push_back(QPointF(x2, y2));
-            interpolatedPoints.push_back(QPointF(x3, y3));
-            return;
-          }
-
-          if(CuspLimit != 0.0) {
-            if(da1 > CuspLimit) {
-              interpolatedPoints.push_back(QPointF(x3, y3));
-              return;
-            }
-          }
+        case ForwardDifferencingEngine: {
+          const int pointsNumber =
+              forwardFlattener.PointsNumber(p1, p2, p3, p4);
+          forwardFlattener.Evaluate(p1, p2, p3, p4, pointsNumber,
+                                    output + end);
+          end += pointsNumber;
+          break;
         }
-      } else {
-        // Collinear case
-        dx = x1234 - (x1 + x4) / 2;
-        dy = y1234 - (y1 + y4) / 2;
-        if(dx*dx + dy*dy <= DistanceTolerance) {
-          interpolatedPoints.push_back(QPointF(x1234, y1234));
-          return;
+        case CurvatureEngine: {
+          const int pointsNumber =
+              curvatureFlattener.PointsNumber(p1, p2, p3, p4);
+          curvatureFlattener.Evaluate(p1, p2, p3, p4, pointsNumber,
+                                      output + end);
+          end += pointsNumber;
+          break;
         }
       }
     }
+    if (curveEnds)
+      curveEnds[counter] = end;
   }
+}
 
-  // Continue subdivision
-  InterpolateBezier(x1, y1, x12, y12, x123, y123, x1234, y1234,
-                    interpolatedPoints, level + 1);
-  InterpolateBezier(x1234, y1234, x234, y234, x34, y34, x4, y4,
-                    interpolatedPoints, level + 1);
+// CurveOutside - whether curve lies outside of clip rectangle.
+bool BezierInterpolator::CurveOutside(const QPointF &p1, const QPointF &p2,
+                                      const QPointF &p3,
+                                      const QPointF &p4) const {
+  if (clipRect.isNull())
+    return false;
+  return bspline::CurveOutside(p1, p2, p3, p4, clipRect.left(),
+                               clipRect.top(), clipRect.right(),
+                               clipRect.bottom());
 }
 
-void BezierInterpolator::InterpolateBezier(const QPointF &p1, const QPointF &p2,
-                                           const QPointF &p3, const QPointF &p4,
-                                           QPolygonF &interpolatedPoints,
-                                           unsigned level) const {
-  InterpolateBezier(p1.x(), p1.y(), p2.x(), p2.y(), p3.x(), p3.y(), p4.x(),
-                    p4.y(), interpolatedPoints, level);
+// InterpolatePredicted - InterpolateBezierBatch() for engines which know number
+// of points in advance.
+void BezierInterpolator::InterpolatePredicted(const double *x, const double *y,
+                                              int curvesNumber,
+                                              QPolygonF &interpolatedPoints,
+                                              int *curveEnds) const {
+  if (engine == ForwardDifferencingEngine)
+    ::InterpolatePredicted(forwardFlattener, x, y, curvesNumber,
+                           interpolatedPoints, curveEnds);
+  else
+    ::InterpolatePredicted(curvatureFlattener, x, y, curvesNumber,
+                           interpolatedPoints, curveEnds);
+}
+
+// EstimateBezierPoints - approximate number of points appended by
+// InterpolateBezier for given curve.
+int BezierInterpolator::EstimateBezierPoints(const QPointF &p1,
+                                             const QPointF &p2,
+                                             const QPointF &p3,
+                                             const QPointF &p4) const {
+  return flattener.EstimatePoints(p1, p2, p3, p4);
 }
 
 // CalculateBoorNet - inserts new control points with de Boor algorithm for
 // transformation of B-spline into composite Bezier curve.
-void BezierInterpolator::CalculateBoorNet(const QVector<QPointF *> &controlPoints,
+void BezierInterpolator::CalculateBoorNet(const QPolygonF &controlPoints,
     const QVector<qreal> &knotVector,
     QPolygonF &boorNetPoints) const {
-  Q_ASSERT(controlPoints.size() > 2);
   Q_ASSERT(knotVector.size() > 4);
-  // We draw uniform cubic B-spline that passes through endpoints, so we assume
-  // that multiplicity of first and last knot is 4 and 1 for knots between.
-
-  QVector<qreal> newKnotVector = knotVector;
-  boorNetPoints.clear();
-  for (int counter = 0; counter < controlPoints.size(); ++counter)
-    boorNetPoints.push_back(*controlPoints[counter]);
-
-  // Insert every middle knot 2 times to increase its multiplicity from 1 to 3.
-  const int curveDegree = 3;
-  const int increaseMultiplicity = 2;
-
-  for (int knotCounter = 4; knotCounter < newKnotVector.size() - 4;
-       knotCounter += 3) {
-    QHash< int, QHash<int, QPointF> > tempPoints;
-    for (int counter = knotCounter - curveDegree; counter <= knotCounter;
-         ++counter)
-      tempPoints[counter][0] = boorNetPoints[counter];
-
-    for (int insertCounter = 1; insertCounter <= increaseMultiplicity;
-         ++insertCounter)
-      for (int i = knotCounter - curveDegree + insertCounter; i < knotCounter;
-           ++i) {
-        double coeff = (newKnotVector[knotCounter] - newKnotVector[i]) /
-            (newKnotVector[i + curveDegree - insertCounter + 1] - newKnotVector[i]);
-        QPointF newPoint = (1.0 - coeff) * tempPoints[i - 1][insertCounter - 1] +
-                           coeff * tempPoints[i][insertCounter - 1];
-        tempPoints[i][insertCounter] = newPoint;
-      }
+  boorNetPoints.resize(BoorNetSize(controlPoints.size()));
+  bspline::CalculateBoorNet(controlPoints.constData(), controlPoints.size(),
+                            knotVector.constData(), boorNetPoints.data());
+}
 
-    for (int counter = 0; counter < increaseMultiplicity; ++counter)
-      newKnotVector.insert(knotCounter, newKnotVector[knotCounter]);
+// CalculateBoorNet - the same for clamped cubic B-spline with simple middle
+// knots, writes into buffer allocated by caller.
+void BezierInterpolator::CalculateBoorNet(const ControlPointStore &controlPoints,
+    const QVector<qreal> &knotVector,
+    QPointF *boorNetPoints) const {
+  Q_ASSERT(knotVector.size() > 4);
+  bspline::CalculateBoorNet(controlPoints, controlPoints.Size(),
+                            knotVector.constData(), boorNetPoints);
+}
 
-    // Fill new control points.
-    QPolygonF newBoorNetPoints;
-    for (int counter = 0; counter <= knotCounter - curveDegree; ++counter)
-      newBoorNetPoints.push_back(boorNetPoints[counter]);
+// CalculateBoorNet - calculates points of Bezier curves from \p firstCurve to
+// \p lastCurve only.
+void BezierInterpolator::CalculateBoorNet(const ControlPointStore &controlPoints,
+    const QVector<qreal> &knotVector,
+    QPointF *boorNetPoints, int firstCurve, int lastCurve) const {
+  Q_ASSERT(knotVector.size() > 4);
+  bspline::CalculateBoorNet(controlPoints, controlPoints.Size(),
+                            knotVector.constData(), boorNetPoints, firstCurve,
+                            lastCurve);
+}
 
-    for (int counter = 1; counter <= increaseMultiplicity; ++counter) {
-      QPointF &newP = tempPoints[knotCounter - curveDegree + counter][counter];
-      newBoorNetPoints.push_back(newP);
-    }
+// BoorNetSize - number of points in boor net of B-spline with
+// \p controlPointsNumber control points.
+int BezierInterpolator::BoorNetSize(int controlPointsNumber) {
+  return bspline::BoorNetSize(controlPointsNumber);
+}
 
-    for (int counter = -curveDegree + increaseMultiplicity + 1; counter <= -1;
-         ++counter) {
-      QPointF &newP = tempPoints[knotCounter + counter][increaseMultiplicity];
-      newBoorNetPoints.push_back(newP);
-    }
+// BezierCurvesNumber - number of Bezier curves in composite curve of B-spline
+// with \p controlPointsNumber control points.
+int BezierInterpolator::BezierCurvesNumber(int controlPointsNumber) {
+  return bspline::BezierCurvesNumber(controlPointsNumber);
+}
 
-    for (int counter = increaseMultiplicity - 1; counter >= 1; --counter)
-      newBoorNetPoints.push_back(tempPoints[knotCounter - 1][counter]);
+void BezierInterpolator::SetDistanceTolerance(double value) {
+  flattener.SetDistanceTolerance(value);
+  angleFlattener.SetDistanceTolerance(value);
+  forwardFlattener.SetDistanceTolerance(value);
+  curvatureFlattener.SetDistanceTolerance(value);
+  revision = NextRevision();
+}
 
-    for (int counter = knotCounter - 1; counter < boorNetPoints.size(); ++counter)
-      newBoorNetPoints.push_back(boorNetPoints[counter]);
+void BezierInterpolator::SetClipRect(const QRectF &rect) {
+  clipRect = rect;
+  revision = NextRevision();
+}
 
-    boorNetPoints = newBoorNetPoints;
-  }
+const QRectF &BezierInterpolator::ClipRect() const {
+  return clipRect;
 }
 
-void BezierInterpolator::SetDistanceTolerance(double value) {
-  DistanceTolerance = value;
+void BezierInterpolator::SetEngine(InterpolationEngine value) {
+  engine = value;
+  revision = NextRevision();
+}
+
+BezierInterpolator::InterpolationEngine BezierInterpolator::Engine() const {
+  return engine;
+}
+
+void BezierInterpolator::SetAngleTolerance(double value) {
+  angleFlattener.SetAngleTolerance(value);
+  revision = NextRevision();
+}
+
+void BezierInterpolator::SetCuspLimit(double value) {
+  angleFlattener.SetCuspLimit(value);
+  revision = NextRevision();
+}
+
+// MaxSubdivisionLevel - the deepest level of subdivision reached since the last
+// ResetMaxSubdivisionLevel().
+unsigned BezierInterpolator::MaxSubdivisionLevel() const {
+  return qMax(flattener.MaxSubdivisionLevel(),
+              angleFlattener.MaxSubdivisionLevel());
+}
+
+void BezierInterpolator::ResetMaxSubdivisionLevel() {
+  flattener.ResetMaxSubdivisionLevel();
+  angleFlattener.ResetMaxSubdivisionLevel();
+}
+
+// ReachSubdivisionLevel - records \p level reached by a copy of the
+// interpolator.
+void BezierInterpolator::ReachSubdivisionLevel(unsigned level) const {
+  flattener.ReachSubdivisionLevel(level);
+}
+
+int BezierInterpolator::Revision() const {
+  return revision;
 }
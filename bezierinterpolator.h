@@ -3,9 +3,42 @@
 
 #include <QPolygonF>
 #include <QPointF>
+#include <QRectF>
+#include <QVector>
+#include "compactpolyline.h"
+#include "controlpointstore.h"
+#include "splinecore.h"
 
+namespace bspline {
+
+// PointTraits - QPointF is used by core directly.
+template <>
+struct PointTraits<QPointF> {
+  typedef qreal Scalar;
+
+  static qreal X(const QPointF &point) { return point.x(); }
+  static qreal Y(const QPointF &point) { return point.y(); }
+  static QPointF Make(qreal x, qreal y) { return QPointF(x, y); }
+};
+
+} // namespace bspline
+
+// BezierInterpolator - interface of spline core for Qt types.
 class BezierInterpolator {
 public:
+  // InterpolationEngine - method of interpolation used by InterpolateCurve()
+  // and InterpolateBezierBatch().
+  enum InterpolationEngine {
+    // Adaptive subdivision, see InterpolateBezier().
+    SubdivisionEngine,
+    // Equal parameter steps evaluated with forward differences, number of steps
+    // is taken from bound on control polygon (Wang's formula).
+    ForwardDifferencingEngine,
+    // Steps are shorter where curve bends more, number of steps is calculated
+    // from curvature of the curve.
+    CurvatureEngine
+  };
+
   BezierInterpolator();
 
   // InterpolateBezier - interpolates points with bezier curve.
@@ -22,24 +55,170 @@ public:
                          QPolygonF &interpolatedPoints,
                          unsigned level = 0) const;
 
+  // InterpolateBezierIterative - the same as InterpolateBezier but uses
+  // explicit stack instead of recursion and reserves storage for the points of
+  // the curve before appending them. Produces exactly the same points.
+  void InterpolateBezierIterative(const QPointF &p1, const QPointF &p2,
+                                  const QPointF &p3, const QPointF &p4,
+                                  QPolygonF &interpolatedPoints) const;
+
+  // InterpolateCurve - interpolates Bezier curve with selected engine. Appends
+  // points of the curve except the first one. Curve outside of clip rectangle
+  // is replaced with its chord, i.e. only \p p4 is appended.
+  void InterpolateCurve(const QPointF &p1, const QPointF &p2,
+                        const QPointF &p3, const QPointF &p4,
+                        QPolygonF &interpolatedPoints) const;
+
+  // InterpolateCurve - the same, but with SubdivisionEngine subdivision starts
+  // from the subdivision of the curve in the previous frame, see
+  // bspline::BezierFlattener::FlattenCoherent(). Levels of flat pieces of the
+  // curve are appended to \p depths to be \p previousDepths of the next frame.
+  // Nothing is appended to \p depths by other engines and for clipped curves.
+  void InterpolateCurve(const QPointF &p1, const QPointF &p2,
+                        const QPointF &p3, const QPointF &p4,
+                        const unsigned char *previousDepths,
+                        int previousDepthsNumber,
+                        QPolygonF &interpolatedPoints,
+                        QVector<unsigned char> &depths) const;
+
+  // InterpolateCurve - the same, but points are written into compact storage.
+  // Subdivision writes them directly, other engines evaluate every curve into
+  // a buffer on stack first.
+  void InterpolateCurve(const QPointF &p1, const QPointF &p2,
+                        const QPointF &p3, const QPointF &p4,
+                        CompactPolyline &interpolatedPoints) const;
+
+  // InterpolateBezierBatch - interpolates all Bezier curves of composite curve
+  // given in structure-of-arrays form: curve i has control points
+  // (x[3i], y[3i]), ..., (x[3i + 3], y[3i + 3]). Appends the same points as
+  // InterpolateCurve called for every curve in order, so curves outside of clip
+  // rectangle are replaced with chords. With SubdivisionEngine
+  // several curves are subdivided at once with SSE2 or AVX if processor
+  // supports it. Other engines know number of points in advance, so points of
+  // all curves are counted first and \p interpolatedPoints grows only once. If
+  // \p curveEnds is given, curveEnds[i] receives size of \p interpolatedPoints
+  // after points of curve i.
+  void InterpolateBezierBatch(const double *x, const double *y,
+                              int curvesNumber, QPolygonF &interpolatedPoints,
+                              int *curveEnds = 0) const;
+
+  // CountBezierBatch - number of points which InterpolateBezierBatch() appends
+  // for the same curves. Subdivision runs without writing points, other
+  // engines only predict number of points.
+  int CountBezierBatch(const double *x, const double *y,
+                       int curvesNumber) const;
+
+  // FillBezierBatch - writes the points which InterpolateBezierBatch() appends
+  // into \p output from index \p offset, there must be room for
+  // CountBezierBatch() points. If \p curveEnds is given, curveEnds[i] receives
+  // index after points of curve i.
+  void FillBezierBatch(const double *x, const double *y, int curvesNumber,
+                       QPointF *output, int offset, int *curveEnds = 0) const;
+
+  // EstimateBezierPoints - approximate number of points appended by
+  // InterpolateBezier for given curve. Based on Wang's formula for number of
+  // uniform subdivisions.
+  int EstimateBezierPoints(const QPointF &p1, const QPointF &p2,
+                           const QPointF &p3, const QPointF &p4) const;
 
   // CalculateBoorNet - inserts new control points with de Boor algorithm for
   // transformation of B-spline into composite Bezier curve.
-  void CalculateBoorNet(const QVector<QPointF*> &controlPoints,
+  void CalculateBoorNet(const QPolygonF &controlPoints,
                         const QVector<qreal> &knotVector,
                         QPolygonF &boorNetPoints) const;
 
+  // CalculateBoorNet - the same for clamped cubic B-spline with simple middle
+  // knots. Writes BoorNetSize() points into \p boorNetPoints which must be
+  // allocated by caller. Every middle knot is raised to multiplicity 3 in one
+  // pass, so nothing is allocated.
+  void CalculateBoorNet(const ControlPointStore &controlPoints,
+                        const QVector<qreal> &knotVector,
+                        QPointF *boorNetPoints) const;
+
+  // CalculateBoorNet - calculates only points of Bezier curves from
+  // \p firstCurve to \p lastCurve inclusive, i.e. boorNetPoints[3 * firstCurve]
+  // ... boorNetPoints[3 * lastCurve + 3], other points are not touched. Curve i
+  // depends on control points i..i+3 only.
+  void CalculateBoorNet(const ControlPointStore &controlPoints,
+                        const QVector<qreal> &knotVector,
+                        QPointF *boorNetPoints, int firstCurve,
+                        int lastCurve) const;
+
+  // BoorNetSize - number of points in boor net of B-spline with
+  // \p controlPointsNumber control points.
+  static int BoorNetSize(int controlPointsNumber);
+
+  // BezierCurvesNumber - number of Bezier curves in composite curve of
+  // B-spline with \p controlPointsNumber control points.
+  static int BezierCurvesNumber(int controlPointsNumber);
+
   void SetDistanceTolerance(double value);
 
+  // SetClipRect - InterpolateCurve() and InterpolateBezierBatch() don't
+  // interpolate curves outside of \p rect. Null rectangle (the default) turns
+  // clipping off.
+  void SetClipRect(const QRectF &rect);
+  const QRectF &ClipRect() const;
+
+  // CurveOutside - whether curve lies outside of clip rectangle, such curves
+  // are replaced with chords.
+  bool CurveOutside(const QPointF &p1, const QPointF &p2, const QPointF &p3,
+                    const QPointF &p4) const;
+
+  // SetEngine - SubdivisionEngine is used by default.
+  void SetEngine(InterpolationEngine value);
+  InterpolationEngine Engine() const;
+
+  // SetAngleTolerance - angle in radians between segments of control polygon
+  // below which curve is flat. Values below 0.01 turn angle condition off, it
+  // is off by default. Angle condition needs trigonometry on every step of
+  // subdivision and can't be done by SIMD kernels.
+  void SetAngleTolerance(double value);
+
+  // SetCuspLimit - angle in radians above which sharp corner is cut at
+  // control point, 0 turns it off. Works only together with angle condition.
+  void SetCuspLimit(double value);
+
+  // MaxSubdivisionLevel - the deepest level of subdivision reached by
+  // interpolation functions since the last ResetMaxSubdivisionLevel().
+  unsigned MaxSubdivisionLevel() const;
+
+  void ResetMaxSubdivisionLevel();
+
+  // ReachSubdivisionLevel - records \p level reached by a copy of the
+  // interpolator, e.g. on another thread.
+  void ReachSubdivisionLevel(unsigned level) const;
+
+  // Revision - changes whenever settings are changed. Interpolators with equal
+  // revisions have equal settings, so copies kept on threads are refreshed only
+  // when revision of the original differs.
+  int Revision() const;
+
 private:
-  // Casteljau algorithm (interpolating Bezier curve) parameters.
-  static const unsigned curveRecursionLimit;
-  static const double curveCollinearityEpsilon;
-  static const double curveAngleToleranceEpsilon;
-  static const double AngleTolerance;  
-  static const double CuspLimit;
-
-  double DistanceTolerance;
+  // InterpolateRun - InterpolateBezierBatch() for curves which are not
+  // clipped.
+  void InterpolateRun(const double *x, const double *y, int curvesNumber,
+                      QPolygonF &interpolatedPoints, int *curveEnds) const;
+
+  // InterpolatePredicted - InterpolateBezierBatch() for engines which know
+  // number of points in advance.
+  void InterpolatePredicted(const double *x, const double *y,
+                            int curvesNumber, QPolygonF &interpolatedPoints,
+                            int *curveEnds) const;
+
+  typedef bspline::BezierFlattener<qreal, QPointF> Flattener;
+  typedef bspline::BezierFlattener<qreal, QPointF, bspline::CuspFlattening>
+      AngleFlattener;
+
+  // Curves are interpolated by flattener unless angle condition is turned on.
+  // Then all conditions are checked by angleFlattener.
+  Flattener flattener;
+  AngleFlattener angleFlattener;
+  bspline::ForwardDifferencingFlattener<qreal, QPointF> forwardFlattener;
+  bspline::CurvatureFlattener<qreal, QPointF> curvatureFlattener;
+  InterpolationEngine engine;
+  QRectF clipRect;
+  int revision;
 };
 
 #endif // BEZIERINTERPOLATOR_H
@@ -0,0 +1,460 @@
+#include "bezierinterpolator.h"
+#include <QVector>
+
+// Batch interpolation subdivides one curve per SIMD lane. Every lane walks its
+// own subdivision tree like InterpolateBezierIterative and takes next curve
+// when the current one is finished, only mid-points and flatness test are
+// computed for all lanes at once. Curve on the top of the lane stack is the
+// current one: kernel replaces it with its right half and puts the left half
+// above, so subdivision only moves the top and nothing is copied. Points of
+// every curve are collected in the buffer of its lane and copied to the output
+// in curve order.
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BEZIER_BATCH_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(BEZIER_BATCH_SSE2) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define BEZIER_BATCH_AVX
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Curve is stored as x1, y1, x2, y2, x3, y3, x4, y4.
+enum {
+  CurveComponents = 8,
+  MaxLanes = 4
+};
+
+// Kernel takes pointer to the current curve of every lane, tests flatness of
+// the curves and subdivides them: right half is written in place of the curve
+// and left half right after it. Returns bit mask of lanes with flat curves.
+typedef int (*SubdivideKernel)(double *const *curves,
+                               double distanceTolerance,
+                               double collinearityEpsilon);
+
+#ifdef BEZIER_BATCH_SSE2
+// SubdivideSse2 - subdivides two curves at once. Flatness test is the same as
+// in BezierFlattener::AppendIfFlat without angle and cusp conditions.
+int SubdivideSse2(double *const *curves, double distanceTolerance,
+                  double collinearityEpsilon) {
+  const __m128d half = _mm_set1_pd(0.5);
+  const __m128d signMask = _mm_set1_pd(-0.0);
+  const __m128d tolerance = _mm_set1_pd(distanceTolerance);
+  const __m128d epsilon = _mm_set1_pd(collinearityEpsilon);
+  double *curve0 = curves[0];
+  double *curve1 = curves[1];
+
+  // Transpose points of two curves into coordinates of two lanes.
+  __m128d p1a = _mm_loadu_pd(curve0), p1b = _mm_loadu_pd(curve1);
+  __m128d p2a = _mm_loadu_pd(curve0 + 2), p2b = _mm_loadu_pd(curve1 + 2);
+  __m128d p3a = _mm_loadu_pd(curve0 + 4), p3b = _mm_loadu_pd(curve1 + 4);
+  __m128d p4a = _mm_loadu_pd(curve0 + 6), p4b = _mm_loadu_pd(curve1 + 6);
+  __m128d x1 = _mm_unpacklo_pd(p1a, p1b), y1 = _mm_unpackhi_pd(p1a, p1b);
+  __m128d x2 = _mm_unpacklo_pd(p2a, p2b), y2 = _mm_unpackhi_pd(p2a, p2b);
+  __m128d x3 = _mm_unpacklo_pd(p3a, p3b), y3 = _mm_unpackhi_pd(p3a, p3b);
+  __m128d x4 = _mm_unpacklo_pd(p4a, p4b), y4 = _mm_unpackhi_pd(p4a, p4b);
+
+  // Calculate all the mid-points of the line segments
+  __m128d x12 = _mm_mul_pd(_mm_add_pd(x1, x2), half);
+  __m128d y12 = _mm_mul_pd(_mm_add_pd(y1, y2), half);
+  __m128d x23 = _mm_mul_pd(_mm_add_pd(x2, x3), half);
+  __m128d y23 = _mm_mul_pd(_mm_add_pd(y2, y3), half);
+  __m128d x34 = _mm_mul_pd(_mm_add_pd(x3, x4), half);
+  __m128d y34 = _mm_mul_pd(_mm_add_pd(y3, y4), half);
+  __m128d x123 = _mm_mul_pd(_mm_add_pd(x12, x23), half);
+  __m128d y123 = _mm_mul_pd(_mm_add_pd(y12, y23), half);
+  __m128d x234 = _mm_mul_pd(_mm_add_pd(x23, x34), half);
+  __m128d y234 = _mm_mul_pd(_mm_add_pd(y23, y34), half);
+  __m128d x1234 = _mm_mul_pd(_mm_add_pd(x123, x234), half);
+  __m128d y1234 = _mm_mul_pd(_mm_add_pd(y123, y234), half);
+
+  // Try to approximate the full cubic curve by a single straight line
+  __m128d dx = _mm_sub_pd(x4, x1);
+  __m128d dy = _mm_sub_pd(y4, y1);
+  __m128d d2 = _mm_andnot_pd(signMask, _mm_sub_pd(
+      _mm_mul_pd(_mm_sub_pd(x2, x4), dy), _mm_mul_pd(_mm_sub_pd(y2, y4), dx)));
+  __m128d d3 = _mm_andnot_pd(signMask, _mm_sub_pd(
+      _mm_mul_pd(_mm_sub_pd(x3, x4), dy), _mm_mul_pd(_mm_sub_pd(y3, y4), dx)));
+  __m128d limit = _mm_mul_pd(tolerance, _mm_add_pd(_mm_mul_pd(dx, dx),
+                                                   _mm_mul_pd(dy, dy)));
+  __m128d d2Big = _mm_cmpgt_pd(d2, epsilon);
+  __m128d d3Big = _mm_cmpgt_pd(d3, epsilon);
+
+  // Regular case
+  __m128d d23 = _mm_add_pd(d2, d3);
+  __m128d flat = _mm_and_pd(_mm_and_pd(d2Big, d3Big),
+                            _mm_cmple_pd(_mm_mul_pd(d23, d23), limit));
+  // p1,p3,p4 are collinear, p2 is considerable
+  flat = _mm_or_pd(flat, _mm_and_pd(_mm_andnot_pd(d3Big, d2Big),
+      _mm_cmple_pd(_mm_mul_pd(d2, d2), limit)));
+  // p1,p2,p4 are collinear, p3 is considerable
+  flat = _mm_or_pd(flat, _mm_and_pd(_mm_andnot_pd(d2Big, d3Big),
+      _mm_cmple_pd(_mm_mul_pd(d3, d3), limit)));
+  // Collinear case
+  __m128d cx = _mm_sub_pd(x1234, _mm_mul_pd(_mm_add_pd(x1, x4), half));
+  __m128d cy = _mm_sub_pd(y1234, _mm_mul_pd(_mm_add_pd(y1, y4), half));
+  __m128d collinear = _mm_andnot_pd(_mm_or_pd(d2Big, d3Big),
+                                    _mm_cmpeq_pd(d2, d2));
+  flat = _mm_or_pd(flat, _mm_and_pd(collinear, _mm_cmple_pd(
+      _mm_add_pd(_mm_mul_pd(cx, cx), _mm_mul_pd(cy, cy)), tolerance)));
+
+  // Right half in place of the curve, left half after it.
+  _mm_storeu_pd(curve0, _mm_unpacklo_pd(x1234, y1234));
+  _mm_storeu_pd(curve1, _mm_unpackhi_pd(x1234, y1234));
+  _mm_storeu_pd(curve0 + 2, _mm_unpacklo_pd(x234, y234));
+  _mm_storeu_pd(curve1 + 2, _mm_unpackhi_pd(x234, y234));
+  _mm_storeu_pd(curve0 + 4, _mm_unpacklo_pd(x34, y34));
+  _mm_storeu_pd(curve1 + 4, _mm_unpackhi_pd(x34, y34));
+  _mm_storeu_pd(curve0 + 6, p4a);
+  _mm_storeu_pd(curve1 + 6, p4b);
+  _mm_storeu_pd(curve0 + 8, p1a);
+  _mm_storeu_pd(curve1 + 8, p1b);
+  _mm_storeu_pd(curve0 + 10, _mm_unpacklo_pd(x12, y12));
+  _mm_storeu_pd(curve1 + 10, _mm_unpackhi_pd(x12, y12));
+  _mm_storeu_pd(curve0 + 12, _mm_unpacklo_pd(x123, y123));
+  _mm_storeu_pd(curve1 + 12, _mm_unpackhi_pd(x123, y123));
+  _mm_storeu_pd(curve0 + 14, _mm_unpacklo_pd(x1234, y1234));
+  _mm_storeu_pd(curve1 + 14, _mm_unpackhi_pd(x1234, y1234));
+
+  return _mm_movemask_pd(flat);
+}
+#endif // BEZIER_BATCH_SSE2
+
+#ifdef BEZIER_BATCH_AVX
+// Transpose4 - transposes 4x4 matrix of doubles given by rows.
+__attribute__((target("avx")))
+inline void Transpose4(__m256d &row0, __m256d &row1, __m256d &row2,
+                       __m256d &row3) {
+  __m256d t0 = _mm256_unpacklo_pd(row0, row1);
+  __m256d t1 = _mm256_unpackhi_pd(row0, row1);
+  __m256d t2 = _mm256_unpacklo_pd(row2, row3);
+  __m256d t3 = _mm256_unpackhi_pd(row2, row3);
+  row0 = _mm256_permute2f128_pd(t0, t2, 0x20);
+  row1 = _mm256_permute2f128_pd(t1, t3, 0x20);
+  row2 = _mm256_permute2f128_pd(t0, t2, 0x31);
+  row3 = _mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+// SubdivideAvx - subdivides four curves at once. The same as SubdivideSse2.
+__attribute__((target("avx")))
+int SubdivideAvx(double *const *curves, double distanceTolerance,
+                 double collinearityEpsilon) {
+  const __m256d half = _mm256_set1_pd(0.5);
+  const __m256d signMask = _mm256_set1_pd(-0.0);
+  const __m256d tolerance = _mm256_set1_pd(distanceTolerance);
+  const __m256d epsilon = _mm256_set1_pd(collinearityEpsilon);
+
+  // Transpose points of four curves into coordinates of four lanes.
+  __m256d x1 = _mm256_loadu_pd(curves[0]);
+  __m256d y1 = _mm256_loadu_pd(curves[1]);
+  __m256d x2 = _mm256_loadu_pd(curves[2]);
+  __m256d y2 = _mm256_loadu_pd(curves[3]);
+  __m256d x3 = _mm256_loadu_pd(curves[0] + 4);
+  __m256d y3 = _mm256_loadu_pd(curves[1] + 4);
+  __m256d x4 = _mm256_loadu_pd(curves[2] + 4);
+  __m256d y4 = _mm256_loadu_pd(curves[3] + 4);
+  Transpose4(x1, y1, x2, y2);
+  Transpose4(x3, y3, x4, y4);
+
+  // Calculate all the mid-points of the line segments
+  __m256d x12 = _mm256_mul_pd(_mm256_add_pd(x1, x2), half);
+  __m256d y12 = _mm256_mul_pd(_mm256_add_pd(y1, y2), half);
+  __m256d x23 = _mm256_mul_pd(_mm256_add_pd(x2, x3), half);
+  __m256d y23 = _mm256_mul_pd(_mm256_add_pd(y2, y3), half);
+  __m256d x34 = _mm256_mul_pd(_mm256_add_pd(x3, x4), half);
+  __m256d y34 = _mm256_mul_pd(_mm256_add_pd(y3, y4), half);
+  __m256d x123 = _mm256_mul_pd(_mm256_add_pd(x12, x23), half);
+  __m256d y123 = _mm256_mul_pd(_mm256_add_pd(y12, y23), half);
+  __m256d x234 = _mm256_mul_pd(_mm256_add_pd(x23, x34), half);
+  __m256d y234 = _mm256_mul_pd(_mm256_add_pd(y23, y34), half);
+  __m256d x1234 = _mm256_mul_pd(_mm256_add_pd(x123, x234), half);
+  __m256d y1234 = _mm256_mul_pd(_mm256_add_pd(y123, y234), half);
+
+  // Try to approximate the full cubic curve by a single straight line
+  __m256d dx = _mm256_sub_pd(x4, x1);
+  __m256d dy = _mm256_sub_pd(y4, y1);
+  __m256d d2 = _mm256_andnot_pd(signMask, _mm256_sub_pd(
+      _mm256_mul_pd(_mm256_sub_pd(x2, x4), dy),
+      _mm256_mul_pd(_mm256_sub_pd(y2, y4), dx)));
+  __m256d d3 = _mm256_andnot_pd(signMask, _mm256_sub_pd(
+      _mm256_mul_pd(_mm256_sub_pd(x3, x4), dy),
+      _mm256_mul_pd(_mm256_sub_pd(y3, y4), dx)));
+  __m256d limit = _mm256_mul_pd(tolerance, _mm256_add_pd(
+      _mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+  __m256d d2Big = _mm256_cmp_pd(d2, epsilon, _CMP_GT_OQ);
+  __m256d d3Big = _mm256_cmp_pd(d3, epsilon, _CMP_GT_OQ);
+
+  // Regular case
+  __m256d d23 = _mm256_add_pd(d2, d3);
+  __m256d flat = _mm256_and_pd(_mm256_and_pd(d2Big, d3Big), _mm256_cmp_pd(
+      _mm256_mul_pd(d23, d23), limit, _CMP_LE_OQ));
+  // p1,p3,p4 are collinear, p2 is considerable
+  flat = _mm256_or_pd(flat, _mm256_and_pd(_mm256_andnot_pd(d3Big, d2Big),
+      _mm256_cmp_pd(_mm256_mul_pd(d2, d2), limit, _CMP_LE_OQ)));
+  // p1,p2,p4 are collinear, p3 is considerable
+  flat = _mm256_or_pd(flat, _mm256_and_pd(_mm256_andnot_pd(d2Big, d3Big),
+      _mm256_cmp_pd(_mm256_mul_pd(d3, d3), limit, _CMP_LE_OQ)));
+  // Collinear case
+  __m256d cx = _mm256_sub_pd(x1234,
+                             _mm256_mul_pd(_mm256_add_pd(x1, x4), half));
+  __m256d cy = _mm256_sub_pd(y1234,
+                             _mm256_mul_pd(_mm256_add_pd(y1, y4), half));
+  __m256d collinear = _mm256_andnot_pd(_mm256_or_pd(d2Big, d3Big),
+                                       _mm256_cmp_pd(d2, d2, _CMP_EQ_OQ));
+  flat = _mm256_or_pd(flat, _mm256_and_pd(collinear, _mm256_cmp_pd(
+      _mm256_add_pd(_mm256_mul_pd(cx, cx), _mm256_mul_pd(cy, cy)), tolerance,
+      _CMP_LE_OQ)));
+
+  // Right half in place of the curve, left half after it.
+  __m256d right0 = x1234, right1 = y1234, right2 = x234, right3 = y234;
+  Transpose4(right0, right1, right2, right3);
+  Transpose4(x34, y34, x4, y4);
+  _mm256_storeu_pd(curves[0], right0);
+  _mm256_storeu_pd(curves[1], right1);
+  _mm256_storeu_pd(curves[2], right2);
+  _mm256_storeu_pd(curves[3], right3);
+  _mm256_storeu_pd(curves[0] + 4, x34);
+  _mm256_storeu_pd(curves[1] + 4, y34);
+  _mm256_storeu_pd(curves[2] + 4, x4);
+  _mm256_storeu_pd(curves[3] + 4, y4);
+  Transpose4(x1, y1, x12, y12);
+  Transpose4(x123, y123, x1234, y1234);
+  _mm256_storeu_pd(curves[0] + 8, x1);
+  _mm256_storeu_pd(curves[1] + 8, y1);
+  _mm256_storeu_pd(curves[2] + 8, x12);
+  _mm256_storeu_pd(curves[3] + 8, y12);
+  _mm256_storeu_pd(curves[0] + 12, x123);
+  _mm256_storeu_pd(curves[1] + 12, y123);
+  _mm256_storeu_pd(curves[2] + 12, x1234);
+  _mm256_storeu_pd(curves[3] + 12, y1234);
+
+  return _mm256_movemask_pd(flat);
+}
+#endif // BEZIER_BATCH_AVX
+
+// SelectKernel - chooses the widest kernel supported by processor. Returns 0
+// if there is no SIMD kernel.
+SubdivideKernel SelectKernel(int &lanes) {
+#ifdef BEZIER_BATCH_AVX
+  if (__builtin_cpu_supports("avx")) {
+    lanes = 4;
+    return SubdivideAvx;
+  }
+#endif
+#ifdef BEZIER_BATCH_SSE2
+  lanes = 2;
+  return SubdivideSse2;
+#else
+  lanes = 1;
+  return 0;
+#endif
+}
+
+} // namespace
+
+// InterpolateBezierBatch - interpolates all Bezier curves of composite curve
+// given in structure-of-arrays form.
+void BezierInterpolator::InterpolateBezierBatch(
+    const double *x, const double *y, int curvesNumber,
+    QPolygonF &interpolatedPoints, int *curveEnds) const {
+  if (clipRect.isNull()) {
+    InterpolateRun(x, y, curvesNumber, interpolatedPoints, curveEnds);
+    return;
+  }
+
+  // Runs of curves inside of clip rectangle are interpolated together, curves
+  // outside are replaced with chords.
+  int counter = 0;
+  while (counter < curvesNumber) {
+    int runEnd = counter;
+    for (; runEnd < curvesNumber; ++runEnd) {
+      const int first = 3 * runEnd;
+      if (CurveOutside(QPointF(x[first], y[first]),
+                       QPointF(x[first + 1], y[first + 1]),
+                       QPointF(x[first + 2], y[first + 2]),
+                       QPointF(x[first + 3], y[first + 3])))
+        break;
+    }
+    if (runEnd > counter) {
+      InterpolateRun(x + 3 * counter, y + 3 * counter, runEnd - counter,
+                     interpolatedPoints, curveEnds ? curveEnds + counter : 0);
+      counter = runEnd;
+      continue;
+    }
+    const int last = 3 * counter + 3;
+    interpolatedPoints.push_back(QPointF(x[last], y[last]));
+    if (curveEnds)
+      curveEnds[counter] = interpolatedPoints.size();
+    ++counter;
+  }
+}
+
+// InterpolateRun - InterpolateBezierBatch() for curves which are not clipped.
+void BezierInterpolator::InterpolateRun(const double *x, const double *y,
+                                        int curvesNumber,
+                                        QPolygonF &interpolatedPoints,
+                                        int *curveEnds) const {
+  if (engine != SubdivisionEngine) {
+    InterpolatePredicted(x, y, curvesNumber, interpolatedPoints, curveEnds);
+    return;
+  }
+
+  int lanesNumber = 1;
+  SubdivideKernel kernel = SelectKernel(lanesNumber);
+  // SIMD kernels implement only distance condition.
+  if (!kernel || angleFlattener.ChecksAngles() || curvesNumber < lanesNumber) {
+    for (int counter = 0; counter < curvesNumber; ++counter) {
+      const int first = 3 * counter;
+      InterpolateBezierIterative(QPointF(x[first], y[first]),
+                                 QPointF(x[first + 1], y[first + 1]),
+                                 QPointF(x[first + 2], y[first + 2]),
+                                 QPointF(x[first + 3], y[first + 3]),
+                                 interpolatedPoints);
+      if (curveEnds)
+        curveEnds[counter] = interpolatedPoints.size();
+    }
+    return;
+  }
+
+  enum { recursionLimit = Flattener::curveRecursionLimit };
+
+  // There is at most one pending curve for every level of subdivision, the
+  // current curve may be below the recursion limit and kernel always needs
+  // room for its left half.
+  struct Lane {
+    double stack[(recursionLimit + 3) * CurveComponents];
+    unsigned level[recursionLimit + 3];
+    int top;
+    int curveIndex;
+    int lastCurveIndex;
+    // Points of the curves which are not copied to the output yet. Buffer is
+    // emptied when the lane takes next curve, so it stays small unless the
+    // lane is far ahead of the others.
+    QPolygonF buffer;
+    int pointsNumber;
+  };
+
+  // Position of points of every curve in the buffer of its lane, end is -1
+  // until the curve is finished.
+  QVector<int> curveLane(curvesNumber);
+  QVector<int> curveStart(curvesNumber);
+  QVector<int> curveEnd(curvesNumber, -1);
+
+  Lane lanes[MaxLanes];
+  // Finished lanes are subdivided in this curve which is never read.
+  double idleCurve[2 * CurveComponents] = { 0.0 };
+  double *curves[MaxLanes];
+  int nextCurve = 0;
+  int flushedCurve = 0;
+  int activeLanes = 0;
+  unsigned maxLevel = flattener.MaxSubdivisionLevel();
+
+  for (int laneCounter = 0; laneCounter < lanesNumber; ++laneCounter) {
+    Lane &lane = lanes[laneCounter];
+    lane.buffer.resize(4 * recursionLimit);
+    lane.pointsNumber = 0;
+    lane.curveIndex = -1;
+    lane.lastCurveIndex = -1;
+    curves[laneCounter] = idleCurve;
+  }
+
+  for (;;) {
+    // Assign next curves to free lanes.
+    for (int laneCounter = 0; laneCounter < lanesNumber; ++laneCounter) {
+      Lane &lane = lanes[laneCounter];
+      if (lane.curveIndex >= 0 || nextCurve >= curvesNumber)
+        continue;
+      const int first = 3 * nextCurve;
+      for (int counter = 0; counter < 4; ++counter) {
+        lane.stack[2 * counter] = x[first + counter];
+        lane.stack[2 * counter + 1] = y[first + counter];
+      }
+      lane.level[0] = 0;
+      lane.top = 0;
+      lane.curveIndex = nextCurve;
+      curves[laneCounter] = lane.stack;
+      if (lane.lastCurveIndex < flushedCurve)
+        lane.pointsNumber = 0;
+      lane.lastCurveIndex = nextCurve;
+      curveLane[nextCurve] = laneCounter;
+      curveStart[nextCurve] = lane.pointsNumber;
+      ++nextCurve;
+      ++activeLanes;
+    }
+    if (activeLanes == 0) {
+      flattener.ReachSubdivisionLevel(maxLevel);
+      break;
+    }
+
+    const int flatMask = kernel(curves, flattener.DistanceTolerance(),
+                                Flattener::CollinearityEpsilon());
+
+    // Outcome of the flatness test is hard to predict, so lanes are advanced
+    // without branches: middle point is always written and counted only when
+    // the curve is flat, the top of the stack moves up for subdivision and
+    // down otherwise.
+    bool curveFinished = false;
+    for (int laneCounter = 0; laneCounter < lanesNumber; ++laneCounter) {
+      Lane &lane = lanes[laneCounter];
+      if (lane.curveIndex < 0)
+        continue;
+
+      const unsigned level = lane.level[lane.top];
+      maxLevel = qMax(maxLevel, level);
+      const bool flat = flatMask & (1 << laneCounter);
+      // Enforce subdivision first time
+      const bool subdivide = level == 0 ||
+                             (!flat && level <= recursionLimit);
+      // Middle point is the first point of the right half.
+      const double *right = curves[laneCounter];
+      lane.buffer[lane.pointsNumber] = QPointF(right[0], right[1]);
+      lane.pointsNumber += !subdivide && level <= recursionLimit;
+
+      lane.level[lane.top] = subdivide ? level + 1 : level;
+      lane.level[lane.top + 1] = level + 1;
+      const int step = subdivide ? 1 : -1;
+      lane.top += step;
+      if (lane.top >= 0) {
+        curves[laneCounter] += step * CurveComponents;
+        continue;
+      }
+
+      curveEnd[lane.curveIndex] = lane.pointsNumber;
+      curves[laneCounter] = idleCurve;
+      lane.curveIndex = -1;
+      --activeLanes;
+      curveFinished = true;
+    }
+
+    // Make room for the next point of every lane.
+    for (int laneCounter = 0; laneCounter < lanesNumber; ++laneCounter) {
+      Lane &lane = lanes[laneCounter];
+      if (lane.pointsNumber == lane.buffer.size())
+        lane.buffer.resize(2 * lane.buffer.size());
+    }
+
+    // Copy finished curves to the output in order.
+    if (!curveFinished)
+      continue;
+    for (; flushedCurve < nextCurve && curveEnd[flushedCurve] >= 0;
+         ++flushedCurve) {
+      const QPolygonF &buffer = lanes[curveLane[flushedCurve]].buffer;
+      const int pointsNumber = interpolatedPoints.size() +
+                               curveEnd[flushedCurve] -
+                               curveStart[flushedCurve];
+      if (pointsNumber > interpolatedPoints.capacity())
+        interpolatedPoints.reserve(qMax(pointsNumber,
+                                        2 * interpolatedPoints.capacity()));
+      for (int counter = curveStart[flushedCurve];
+           counter < curveEnd[flushedCurve]; ++counter)
+        interpolatedPoints.push_back(buffer[counter]);
+      if (curveEnds)
+        curveEnds[flushedCurve] = interpolatedPoints.size();
+    }
+  }
+}
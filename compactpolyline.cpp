@@ -0,0 +1,185 @@
+#include "compactpolyline.h"
+
+namespace {
+
+// Offsets are kept in these units of pixel.
+const double deltaScale = 16.0;
+
+// Blocks are not longer than this, so a point is decoded from at most this
+// many offsets.
+const int blockPointsNumber = 256;
+
+// Positions within block are kept in int, farther points start a new block.
+const double maxPosition = 1 << 30;
+
+inline bool FitsOffset(int offset) {
+  return offset >= -32768 && offset <= 32767;
+}
+
+} // namespace
+
+CompactPolyline::CompactPolyline(Format format) :
+  format(format), pointsNumber(0), lastX(0), lastY(0) {}
+
+void CompactPolyline::SetFormat(Format value) {
+  format = value;
+  Clear();
+}
+
+CompactPolyline::Format CompactPolyline::PointFormat() const {
+  return format;
+}
+
+void CompactPolyline::Clear() {
+  pointsNumber = 0;
+  coordinates.resize(0);
+  offsets.resize(0);
+  blocks.resize(0);
+  lastX = 0;
+  lastY = 0;
+}
+
+// push_back - offset is taken from rounded position of the previous point, so
+// that rounding errors don't add up.
+void CompactPolyline::push_back(const QPointF &point) {
+  if (format == FloatFormat) {
+    coordinates.push_back((float) point.x());
+    coordinates.push_back((float) point.y());
+    ++pointsNumber;
+    return;
+  }
+  if (blocks.isEmpty() ||
+      pointsNumber - blocks.last().first >= blockPointsNumber) {
+    StartBlock(point);
+    return;
+  }
+  const Block &block = blocks.last();
+  const double x = (point.x() - block.x) * deltaScale;
+  const double y = (point.y() - block.y) * deltaScale;
+  if (qAbs(x) >= maxPosition || qAbs(y) >= maxPosition) {
+    StartBlock(point);
+    return;
+  }
+  const int positionX = qRound(x);
+  const int positionY = qRound(y);
+  const int offsetX = positionX - lastX;
+  const int offsetY = positionY - lastY;
+  if (!FitsOffset(offsetX) || !FitsOffset(offsetY)) {
+    StartBlock(point);
+    return;
+  }
+  offsets.push_back((qint16) offsetX);
+  offsets.push_back((qint16) offsetY);
+  lastX = positionX;
+  lastY = positionY;
+  ++pointsNumber;
+}
+
+// Append - storage grows geometrically, so appending curve by curve stays
+// amortized.
+void CompactPolyline::Append(const QPointF *points, int number) {
+  const int size = pointsNumber + number;
+  if (size > capacity())
+    reserve(qMax(size, 2 * capacity()));
+  for (int counter = 0; counter < number; ++counter)
+    push_back(points[counter]);
+}
+
+int CompactPolyline::size() const {
+  return pointsNumber;
+}
+
+int CompactPolyline::capacity() const {
+  return format == FloatFormat ? coordinates.capacity() / 2 :
+                                 offsets.capacity() / 2;
+}
+
+// reserve - blocks are reserved for points which don't start new blocks
+// because of large offsets.
+void CompactPolyline::reserve(int size) {
+  if (format == FloatFormat) {
+    coordinates.reserve(2 * size);
+    return;
+  }
+  offsets.reserve(2 * size);
+  blocks.reserve(size / blockPointsNumber + 1);
+}
+
+QPointF CompactPolyline::Point(int index) const {
+  QPointF point;
+  Read(index, 1, &point);
+  return point;
+}
+
+// Read - offsets are summed from the first point of the block of \p first.
+void CompactPolyline::Read(int first, int number, QPointF *points) const {
+  Q_ASSERT(first >= 0 && first + number <= pointsNumber);
+  if (format == FloatFormat) {
+    const float *coordinate = coordinates.constData() + 2 * first;
+    for (int counter = 0; counter < number; ++counter, coordinate += 2)
+      points[counter] = QPointF(coordinate[0], coordinate[1]);
+    return;
+  }
+  if (number <= 0)
+    return;
+  int block = BlockOf(first);
+  const qint16 *offset = offsets.constData();
+  int x = 0;
+  int y = 0;
+  for (int index = blocks[block].first + 1; index < first; ++index) {
+    x += offset[2 * index];
+    y += offset[2 * index + 1];
+  }
+  const int end = first + number;
+  int blockEnd = block + 1 < blocks.size() ? blocks[block + 1].first :
+                                             pointsNumber;
+  const double scale = 1.0 / deltaScale;
+  for (int index = first; index < end; ++index) {
+    if (index == blockEnd) {
+      ++block;
+      blockEnd = block + 1 < blocks.size() ? blocks[block + 1].first :
+                                             pointsNumber;
+    }
+    // The first point of block has zero offset.
+    if (index == blocks[block].first) {
+      x = 0;
+      y = 0;
+    } else {
+      x += offset[2 * index];
+      y += offset[2 * index + 1];
+    }
+    points[index - first] = QPointF(blocks[block].x + x * scale,
+                                    blocks[block].y + y * scale);
+  }
+}
+
+qint64 CompactPolyline::MemoryBytes() const {
+  if (format == FloatFormat)
+    return (qint64) coordinates.capacity() * sizeof(float);
+  return (qint64) offsets.capacity() * sizeof(qint16) +
+         (qint64) blocks.capacity() * sizeof(Block);
+}
+
+// BlockOf - binary search of the last block which starts not after \p index.
+int CompactPolyline::BlockOf(int index) const {
+  int low = 0;
+  int high = blocks.size() - 1;
+  while (low < high) {
+    const int middle = (low + high + 1) / 2;
+    if (blocks[middle].first <= index)
+      low = middle;
+    else
+      high = middle - 1;
+  }
+  return low;
+}
+
+void CompactPolyline::StartBlock(const QPointF &point) {
+  const Block block = { point.x(), point.y(), pointsNumber };
+  blocks.push_back(block);
+  offsets.push_back(0);
+  offsets.push_back(0);
+  lastX = 0;
+  lastY = 0;
+  ++pointsNumber;
+}
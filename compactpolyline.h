@@ -0,0 +1,80 @@
+#ifndef COMPACTPOLYLINE_H
+#define COMPACTPOLYLINE_H
+
+#include <QPointF>
+#include <QVector>
+
+// CompactPolyline - polyline stored in fewer bytes per point than QPolygonF,
+// which keeps two doubles. FloatFormat keeps coordinates as floats, 8 bytes per
+// point. DeltaFormat splits points into blocks, keeps the first point of every
+// block exactly and the rest as 16-bit offsets from the previous point in
+// 1/16 of pixel, 4 bytes per point. Offsets are taken between rounded
+// positions, so errors don't accumulate along the block and stay within
+// 1/32 of pixel. A point too far from the previous one starts a new block.
+// Has push_back(), size(), capacity() and reserve(), so flatteners write into
+// it directly, readers decode runs of points into buffer of their own.
+class CompactPolyline {
+public:
+  enum Format {
+    FloatFormat,
+    DeltaFormat
+  };
+
+  explicit CompactPolyline(Format format = DeltaFormat);
+
+  // SetFormat - changes format, points are removed.
+  void SetFormat(Format value);
+  Format PointFormat() const;
+
+  // Clear - removes all points, storage is kept.
+  void Clear();
+
+  // push_back - appends \p point.
+  void push_back(const QPointF &point);
+
+  // Append - appends \p number points from \p points.
+  void Append(const QPointF *points, int number);
+
+  int size() const;
+  int capacity() const;
+  void reserve(int size);
+
+  // Point - decodes point \p index.
+  QPointF Point(int index) const;
+
+  // Read - decodes points [first, first + number) into \p points.
+  void Read(int first, int number, QPointF *points) const;
+
+  // MemoryBytes - size of storage of points including reserved one.
+  qint64 MemoryBytes() const;
+
+private:
+  // Block - points of DeltaFormat from \var first up to the first point of the
+  // next block. Offset of the first point is zero.
+  struct Block {
+    double x;
+    double y;
+    int first;
+  };
+
+  // BlockOf - index of block which holds point \p index.
+  int BlockOf(int index) const;
+
+  // StartBlock - makes \p point the first point of a new block.
+  void StartBlock(const QPointF &point);
+
+  Format format;
+  int pointsNumber;
+
+  // FloatFormat: x and y of every point.
+  QVector<float> coordinates;
+
+  // DeltaFormat: x and y offsets of every point from the previous one.
+  QVector<qint16> offsets;
+  QVector<Block> blocks;
+  // Position of the last point from the first point of the last block.
+  int lastX;
+  int lastY;
+};
+
+#endif // COMPACTPOLYLINE_H
@@ -0,0 +1,288 @@
+#include "controlpointintegrator.h"
+
+// Step of a point is p += v; if p left bounds, p -= 2 * v and v = -v. Kernels
+// compute both outcomes and select one with mask, so there are no branches
+// while points stay within bounds. Results are the same as of scalar code bit
+// for bit. Points which are out of bounds after reflection are rare, they are
+// found with mask and put to random position by scalar code.
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define INTEGRATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(INTEGRATOR_SSE2) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define INTEGRATOR_AVX
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Stores with fewer points per range are moved on one thread, threads would
+// cost more than they save.
+const int minPointsPerRange = 32768;
+
+// Every thread gets several ranges, so that threads which are done earlier
+// steal the rest.
+const int rangesPerThread = 4;
+
+// Step - parameters of one step which are the same for all points.
+struct Step {
+  double width;
+  double height;
+  double speedMultiplicator;
+  bool simd;
+};
+
+// NextRandom - xorshift generator, \p state must not be 0.
+inline quint32 NextRandom(quint32 &state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+// Relocate - puts point \p index to random position if it is out of bounds.
+inline void Relocate(const Step &step, qreal *x, qreal *y, int index,
+                     quint32 &randomState) {
+  if (x[index] < 0 || x[index] > step.width ||
+      y[index] < 0 || y[index] > step.height) {
+    x[index] = NextRandom(randomState) % (quint32) step.width;
+    y[index] = NextRandom(randomState) % (quint32) step.height;
+  }
+}
+
+// AdvanceScalar - moves points from \p begin to \p end one by one.
+void AdvanceScalar(const Step &step, qreal *x, qreal *y, qreal *speedX,
+                   qreal *speedY, int begin, int end, quint32 &randomState) {
+  for (int counter = begin; counter < end; ++counter) {
+    const qreal xSpeed = step.speedMultiplicator * speedX[counter];
+    const qreal ySpeed = step.speedMultiplicator * speedY[counter];
+    x[counter] += xSpeed;
+    y[counter] += ySpeed;
+    if (x[counter] < 0 || x[counter] > step.width) {
+      x[counter] -= 2 * xSpeed;
+      speedX[counter] = -speedX[counter];
+    }
+    if (y[counter] < 0 || y[counter] > step.height) {
+      y[counter] -= 2 * ySpeed;
+      speedY[counter] = -speedY[counter];
+    }
+    Relocate(step, x, y, counter, randomState);
+  }
+}
+
+// Kernel moves points from \p begin to \p end, returns index of the first
+// point which it has not moved.
+typedef int (*AdvanceKernel)(const Step &step, qreal *x, qreal *y,
+                             qreal *speedX, qreal *speedY, int begin, int end,
+                             quint32 &randomState);
+
+#ifdef INTEGRATOR_SSE2
+// Select - \p second where \p mask is set, \p first elsewhere.
+inline __m128d Select(__m128d first, __m128d second, __m128d mask) {
+  return _mm_or_pd(_mm_andnot_pd(mask, first), _mm_and_pd(mask, second));
+}
+
+// AdvanceCoordinate - moves two coordinates within [0, \p size]. Returns mask
+// of coordinates which are out of bounds even after reflection.
+inline __m128d AdvanceCoordinate(double *position, double *speed,
+                                 __m128d multiplicator, __m128d size) {
+  const __m128d zero = _mm_setzero_pd();
+  const __m128d signMask = _mm_set1_pd(-0.0);
+  __m128d p = _mm_loadu_pd(position);
+  __m128d v = _mm_loadu_pd(speed);
+  const __m128d step = _mm_mul_pd(multiplicator, v);
+  p = _mm_add_pd(p, step);
+  const __m128d out = _mm_or_pd(_mm_cmplt_pd(p, zero), _mm_cmpgt_pd(p, size));
+  p = Select(p, _mm_sub_pd(p, _mm_add_pd(step, step)), out);
+  v = _mm_xor_pd(v, _mm_and_pd(out, signMask));
+  _mm_storeu_pd(position, p);
+  _mm_storeu_pd(speed, v);
+  return _mm_or_pd(_mm_cmplt_pd(p, zero), _mm_cmpgt_pd(p, size));
+}
+
+// AdvanceSse2 - moves two points at once.
+int AdvanceSse2(const Step &step, qreal *x, qreal *y, qreal *speedX,
+                qreal *speedY, int begin, int end, quint32 &randomState) {
+  const __m128d multiplicator = _mm_set1_pd(step.speedMultiplicator);
+  const __m128d width = _mm_set1_pd(step.width);
+  const __m128d height = _mm_set1_pd(step.height);
+  int counter = begin;
+  for (; counter + 2 <= end; counter += 2) {
+    const __m128d out = _mm_or_pd(
+          AdvanceCoordinate(x + counter, speedX + counter, multiplicator,
+                            width),
+          AdvanceCoordinate(y + counter, speedY + counter, multiplicator,
+                            height));
+    if (_mm_movemask_pd(out)) {
+      Relocate(step, x, y, counter, randomState);
+      Relocate(step, x, y, counter + 1, randomState);
+    }
+  }
+  return counter;
+}
+#endif // INTEGRATOR_SSE2
+
+#ifdef INTEGRATOR_AVX
+// AdvanceCoordinateAvx - the same as AdvanceCoordinate for four coordinates.
+__attribute__((target("avx")))
+inline __m256d AdvanceCoordinateAvx(double *position, double *speed,
+                                    __m256d multiplicator, __m256d size) {
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d signMask = _mm256_set1_pd(-0.0);
+  __m256d p = _mm256_loadu_pd(position);
+  __m256d v = _mm256_loadu_pd(speed);
+  const __m256d step = _mm256_mul_pd(multiplicator, v);
+  p = _mm256_add_pd(p, step);
+  const __m256d out = _mm256_or_pd(_mm256_cmp_pd(p, zero, _CMP_LT_OQ),
+                                   _mm256_cmp_pd(p, size, _CMP_GT_OQ));
+  p = _mm256_blendv_pd(p, _mm256_sub_pd(p, _mm256_add_pd(step, step)), out);
+  v = _mm256_xor_pd(v, _mm256_and_pd(out, signMask));
+  _mm256_storeu_pd(position, p);
+  _mm256_storeu_pd(speed, v);
+  return _mm256_or_pd(_mm256_cmp_pd(p, zero, _CMP_LT_OQ),
+                      _mm256_cmp_pd(p, size, _CMP_GT_OQ));
+}
+
+// AdvanceAvx - moves four points at once.
+__attribute__((target("avx")))
+int AdvanceAvx(const Step &step, qreal *x, qreal *y, qreal *speedX,
+               qreal *speedY, int begin, int end, quint32 &randomState) {
+  const __m256d multiplicator = _mm256_set1_pd(step.speedMultiplicator);
+  const __m256d width = _mm256_set1_pd(step.width);
+  const __m256d height = _mm256_set1_pd(step.height);
+  int counter = begin;
+  for (; counter + 4 <= end; counter += 4) {
+    const __m256d out = _mm256_or_pd(
+          AdvanceCoordinateAvx(x + counter, speedX + counter, multiplicator,
+                               width),
+          AdvanceCoordinateAvx(y + counter, speedY + counter, multiplicator,
+                               height));
+    if (_mm256_movemask_pd(out)) {
+      for (int lane = 0; lane < 4; ++lane)
+        Relocate(step, x, y, counter + lane, randomState);
+    }
+  }
+  return counter;
+}
+#endif // INTEGRATOR_AVX
+
+// SelectKernel - chooses the widest kernel supported by processor. Returns 0
+// if there is no SIMD kernel.
+AdvanceKernel SelectKernel() {
+#ifdef INTEGRATOR_AVX
+  if (__builtin_cpu_supports("avx"))
+    return AdvanceAvx;
+#endif
+#ifdef INTEGRATOR_SSE2
+  return AdvanceSse2;
+#else
+  return 0;
+#endif
+}
+
+// AdvanceRange - moves points from \p begin to \p end with the best kernel,
+// the tail which doesn't fill SIMD register is moved by scalar code.
+void AdvanceRange(const Step &step, qreal *x, qreal *y, qreal *speedX,
+                  qreal *speedY, int begin, int end, quint32 &randomState) {
+  static const AdvanceKernel kernel = SelectKernel();
+  if (kernel && step.simd)
+    begin = kernel(step, x, y, speedX, speedY, begin, end, randomState);
+  AdvanceScalar(step, x, y, speedX, speedY, begin, end, randomState);
+}
+
+} // namespace
+
+// RangeTask - moves one range of points on a thread of pool.
+class ControlPointIntegrator::RangeTask : public WorkStealingPool::Task {
+public:
+  RangeTask() : x(0), y(0), speedX(0), speedY(0), begin(0), end(0),
+                randomState(0) {}
+
+  void Run() {
+    AdvanceRange(step, x, y, speedX, speedY, begin, end, *randomState);
+  }
+
+  Step step;
+  qreal *x;
+  qreal *y;
+  qreal *speedX;
+  qreal *speedY;
+  int begin;
+  int end;
+  quint32 *randomState;
+};
+
+ControlPointIntegrator::ControlPointIntegrator() :
+  width(0), height(0), speedMultiplicator(1.0), simd(true), pool(0) {
+  randomStates.push_back(1);
+}
+
+ControlPointIntegrator::~ControlPointIntegrator() {
+  for (int counter = 0; counter < tasks.size(); ++counter)
+    delete tasks[counter];
+}
+
+void ControlPointIntegrator::SetBounds(int width, int height) {
+  this->width = width;
+  this->height = height;
+}
+
+void ControlPointIntegrator::SetSpeedMultiplicator(double value) {
+  speedMultiplicator = value;
+}
+
+void ControlPointIntegrator::SetPool(WorkStealingPool *value) {
+  pool = value;
+}
+
+void ControlPointIntegrator::SetSimd(bool value) {
+  simd = value;
+}
+
+// Advance - moves all points of \p store by one step.
+void ControlPointIntegrator::Advance(ControlPointStore &store) {
+  if (width <= 0 || height <= 0)
+    return;
+  Step step;
+  step.width = width;
+  step.height = height;
+  step.speedMultiplicator = speedMultiplicator;
+  step.simd = simd;
+  const int pointsNumber = store.Size();
+
+  const int maxRanges = pointsNumber / minPointsPerRange;
+  if (maxRanges < 2 || !pool || pool->ThreadsNumber() < 2) {
+    AdvanceRange(step, store.X(), store.Y(), store.SpeedX(), store.SpeedY(),
+                 0, pointsNumber, randomStates[0]);
+    return;
+  }
+
+  const int rangesNumber = qMin(maxRanges,
+                                rangesPerThread * pool->ThreadsNumber());
+  // Pool runs all given tasks, so there is exactly one task per range.
+  while (tasks.size() < rangesNumber)
+    tasks.push_back(new RangeTask);
+  while (tasks.size() > rangesNumber) {
+    delete tasks.last();
+    tasks.pop_back();
+  }
+  // Every range has its own generator, so threads don't share state.
+  while (randomStates.size() < rangesNumber)
+    randomStates.push_back(2654435761u * (randomStates.size() + 1));
+  for (int counter = 0; counter < rangesNumber; ++counter) {
+    RangeTask *task = static_cast<RangeTask*>(tasks[counter]);
+    task->step = step;
+    task->x = store.X();
+    task->y = store.Y();
+    task->speedX = store.SpeedX();
+    task->speedY = store.SpeedY();
+    task->begin = (int) ((qint64) pointsNumber * counter / rangesNumber);
+    task->end = (int) ((qint64) pointsNumber * (counter + 1) / rangesNumber);
+    task->randomState = &randomStates[counter];
+  }
+  pool->Run(tasks);
+}
@@ -0,0 +1,58 @@
+#ifndef CONTROLPOINTINTEGRATOR_H
+#define CONTROLPOINTINTEGRATOR_H
+
+#include <QVector>
+#include "controlpointstore.h"
+#include "workstealingpool.h"
+
+// ControlPointIntegrator - moves control points of ControlPointStore by their
+// speeds and reflects them from borders of bounds. Coordinates are moved by
+// SIMD kernels without branches, large stores are split into ranges which are
+// moved on threads of WorkStealingPool.
+class ControlPointIntegrator {
+public:
+  ControlPointIntegrator();
+  ~ControlPointIntegrator();
+
+  // SetBounds - points move within rectangle from (0, 0) to (\p width,
+  // \p height). Bounds are not read while points are moved.
+  void SetBounds(int width, int height);
+
+  // SetSpeedMultiplicator - speed of every point is multiplied by \p value.
+  void SetSpeedMultiplicator(double value);
+
+  // SetPool - large stores are moved on threads of \p value, which is not
+  // owned. If it is 0 (the default), all points are moved on the calling
+  // thread.
+  void SetPool(WorkStealingPool *value);
+
+  // SetSimd - whether points are moved by SIMD kernels (the default) or by
+  // scalar code, which gives the same results and is kept to check kernels.
+  void SetSimd(bool value);
+
+  // Advance - moves all points of \p store by one step. Point which left
+  // bounds is returned by its speed and the speed is reversed. Point which is
+  // out of bounds even after that (bounds were shrunk) is put to random
+  // position.
+  void Advance(ControlPointStore &store);
+
+private:
+  class RangeTask;
+
+  int width;
+  int height;
+  double speedMultiplicator;
+  bool simd;
+
+  WorkStealingPool *pool;
+  // RangeTask of every range, kept between steps.
+  QVector<WorkStealingPool::Task*> tasks;
+  // State of random generator of every range, kept between steps.
+  QVector<quint32> randomStates;
+
+  // Copying is not supported.
+  ControlPointIntegrator(const ControlPointIntegrator &);
+  ControlPointIntegrator &operator=(const ControlPointIntegrator &);
+};
+
+#endif // CONTROLPOINTINTEGRATOR_H
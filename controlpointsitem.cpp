@@ -0,0 +1,99 @@
+#include "controlpointsitem.h"
+#include "splineworker.h"
+#include <QGraphicsSceneMouseEvent>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+ControlPointsItem::ControlPointsItem(SplineWorker *splineWorker,
+                                     qreal pointSize, QGraphicsItem *parent) :
+  QGraphicsItem(parent), splineWorker(splineWorker), pointSize(pointSize),
+  grid(pointSize), draggedHandle(ControlPointStore::InvalidHandle) {
+  // Only exposed points are painted.
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
+}
+
+/// setControlPoints - replaces control points and their \p handles. If number
+/// of points is the same, old and new boxes of moved points are updated.
+void ControlPointsItem::setControlPoints(
+    const QPolygonF &points,
+    const QVector<ControlPointStore::Handle> &handles) {
+  const qreal margin = pointSize / 2 + 1;
+  const bool sameSize = points.size() == grid.Size();
+  dirtyRegion.Clear();
+  if (sameSize) {
+    for (int counter = 0; counter < points.size(); ++counter) {
+      const QPointF oldPoint = grid.Point(counter);
+      if (oldPoint == points[counter])
+        continue;
+      dirtyRegion.AddPoints(&oldPoint, 0, 1, margin);
+      dirtyRegion.AddPoints(&points[counter], 0, 1, margin);
+    }
+  }
+  grid.SetPoints(points);
+  // Reserved storage is never shrunk by resize().
+  if (this->handles.capacity() < handles.size())
+    this->handles.reserve(handles.size());
+  this->handles.resize(handles.size());
+  for (int counter = 0; counter < handles.size(); ++counter)
+    this->handles[counter] = handles[counter];
+  pointsRect = points.boundingRect();
+
+  const QRectF rect = pointsRect.adjusted(-margin, -margin, margin, margin);
+  if (!sameSize || !itemRect.contains(rect) ||
+      2 * dirtyRegion.Area() > itemRect.width() * itemRect.height()) {
+    prepareGeometryChange();
+    itemRect = rect;
+    return;
+  }
+  const QVector<QRectF> &dirtyRects = dirtyRegion.Rects();
+  for (int counter = 0; counter < dirtyRects.size(); ++counter)
+    update(dirtyRects[counter]);
+}
+
+QRectF ControlPointsItem::boundingRect() const {
+  return itemRect;
+}
+
+void ControlPointsItem::paint(QPainter *painter,
+                              const QStyleOptionGraphicsItem *option,
+                              QWidget *widget) {
+  Q_UNUSED(widget);
+  // Points which are partially exposed are found too.
+  const qreal margin = pointSize / 2 + 1;
+  grid.FindInRect(option->exposedRect.adjusted(-margin, -margin,
+                                               margin, margin),
+                  visiblePoints);
+  painter->setPen(QPen());
+  painter->setBrush(QBrush("blue"));
+  for (int counter = 0; counter < visiblePoints.size(); ++counter) {
+    const QPointF point = grid.Point(visiblePoints[counter]);
+    painter->drawEllipse(QRectF(point.x() - pointSize / 2,
+                                point.y() - pointSize / 2,
+                                pointSize, pointSize));
+  }
+}
+
+/// mousePressEvent - picks the control point under cursor.
+void ControlPointsItem::mousePressEvent(QGraphicsSceneMouseEvent *event) {
+  const int index = grid.FindNearest(event->scenePos(), pointSize / 2);
+  if (index < 0) {
+    // Items below may take the press.
+    event->ignore();
+    return;
+  }
+  draggedHandle = handles[index];
+}
+
+/// mouseMoveEvent - sends new position of the picked control point to
+/// \var splineWorker.
+void ControlPointsItem::mouseMoveEvent(QGraphicsSceneMouseEvent *event) {
+  // Point isn't moved here: it is drawn at new position when the frame with
+  // the moved point is shown.
+  if (draggedHandle != ControlPointStore::InvalidHandle)
+    splineWorker->MoveControlPoint(draggedHandle, event->scenePos());
+}
+
+void ControlPointsItem::mouseReleaseEvent(QGraphicsSceneMouseEvent *event) {
+  Q_UNUSED(event);
+  draggedHandle = ControlPointStore::InvalidHandle;
+}
@@ -0,0 +1,65 @@
+#ifndef CONTROLPOINTSITEM_H
+#define CONTROLPOINTSITEM_H
+
+#include <QGraphicsItem>
+#include <QPolygonF>
+#include <QVector>
+#include "controlpointstore.h"
+#include "dirtyregion.h"
+#include "pointgrid.h"
+
+class SplineWorker;
+
+/// ControlPointsItem - this class draws all control points as one item on
+/// QGraphicsScene and lets user drag them. Points are indexed by PointGrid, so
+/// a press is hit-tested against points around it only and painting draws only
+/// points within exposed part of the view. Only boxes of moved points are
+/// repainted. Nothing is allocated per point.
+class ControlPointsItem : public QGraphicsItem {
+public:
+  /// ControlPointsItem - dragged points are sent to \p splineWorker. Points are
+  /// drawn as circles of \p pointSize in units of scene.
+  ControlPointsItem(SplineWorker *splineWorker, qreal pointSize,
+                    QGraphicsItem *parent = 0);
+
+  /// setControlPoints - replaces control points and their \p handles. Points
+  /// are copied into storage of the item which is reused between calls.
+  void setControlPoints(const QPolygonF &points,
+                        const QVector<ControlPointStore::Handle> &handles);
+
+  QRectF boundingRect() const;
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+             QWidget *widget = 0);
+
+protected:
+  /// mousePressEvent - picks the control point under cursor, the event is
+  /// ignored if there is no such point.
+  void mousePressEvent(QGraphicsSceneMouseEvent *event);
+
+  /// mouseMoveEvent - sends new position of the picked control point to
+  /// \var splineWorker.
+  void mouseMoveEvent(QGraphicsSceneMouseEvent *event);
+
+  void mouseReleaseEvent(QGraphicsSceneMouseEvent *event);
+
+private:
+  SplineWorker *splineWorker;
+  qreal pointSize;
+
+  PointGrid grid;
+  // Handle of every point of \var grid.
+  QVector<ControlPointStore::Handle> handles;
+  QRectF pointsRect;
+  // Bounding rect of the item, it may be larger than points, so that moving
+  // a point doesn't change geometry of the item and repaint all of it.
+  QRectF itemRect;
+  // Old and new boxes of moved points, kept between calls.
+  DirtyRegion dirtyRegion;
+  // Handle of the dragged point.
+  ControlPointStore::Handle draggedHandle;
+
+  // Points found for painting, kept between calls.
+  QVector<int> visiblePoints;
+};
+
+#endif // CONTROLPOINTSITEM_H
@@ -0,0 +1,129 @@
+#include "controlpointstore.h"
+
+namespace {
+
+// Lower bits of handle keep slot, the rest up to the sign bit keeps generation.
+const int slotBits = 20;
+const int slotMask = (1 << slotBits) - 1;
+const int generationMask = (1 << (31 - slotBits)) - 1;
+
+inline ControlPointStore::Handle MakeHandle(int slot, int generation) {
+  return (generation << slotBits) | slot;
+}
+
+} // namespace
+
+ControlPointStore::ControlPointStore() {}
+
+int ControlPointStore::Size() const {
+  return x.size();
+}
+
+bool ControlPointStore::IsEmpty() const {
+  return x.isEmpty();
+}
+
+// Add - appends control point to the end of the spline, returns its handle.
+ControlPointStore::Handle ControlPointStore::Add(const QPointF &point,
+                                                 const QPointF &speed) {
+  int slot;
+  if (freeSlots.isEmpty()) {
+    slot = indices.size();
+    Q_ASSERT(slot <= slotMask);
+    indices.push_back(x.size());
+    generations.push_back(0);
+  } else {
+    slot = freeSlots.last();
+    freeSlots.pop_back();
+    indices[slot] = x.size();
+  }
+  const Handle handle = MakeHandle(slot, generations[slot]);
+  handles.push_back(handle);
+  x.push_back(point.x());
+  y.push_back(point.y());
+  speedX.push_back(speed.x());
+  speedY.push_back(speed.y());
+  return handle;
+}
+
+// RemoveLast - removes the last control point, its handle becomes invalid.
+void ControlPointStore::RemoveLast() {
+  Q_ASSERT(!IsEmpty());
+  Release(handles.last());
+  handles.pop_back();
+  x.pop_back();
+  y.pop_back();
+  speedX.pop_back();
+  speedY.pop_back();
+}
+
+// Clear - removes all control points. Slots are kept with their generations,
+// so handles of removed points stay invalid.
+void ControlPointStore::Clear() {
+  for (int counter = 0; counter < handles.size(); ++counter)
+    Release(handles[counter]);
+  x.resize(0);
+  y.resize(0);
+  speedX.resize(0);
+  speedY.resize(0);
+  handles.resize(0);
+}
+
+// Index - index of control point with \p handle or -1 if it was removed.
+int ControlPointStore::Index(Handle handle) const {
+  const int slot = handle & slotMask;
+  if (handle < 0 || slot >= indices.size() ||
+      generations[slot] != handle >> slotBits)
+    return -1;
+  return indices[slot];
+}
+
+ControlPointStore::Handle ControlPointStore::HandleAt(int index) const {
+  return handles[index];
+}
+
+QPointF ControlPointStore::Point(int index) const {
+  return QPointF(x[index], y[index]);
+}
+
+void ControlPointStore::SetPoint(int index, const QPointF &point) {
+  x[index] = point.x();
+  y[index] = point.y();
+}
+
+QPointF ControlPointStore::Speed(int index) const {
+  return QPointF(speedX[index], speedY[index]);
+}
+
+void ControlPointStore::SetSpeed(int index, const QPointF &speed) {
+  speedX[index] = speed.x();
+  speedY[index] = speed.y();
+}
+
+// CopyPoints - copies control points into \p points keeping its capacity.
+void ControlPointStore::CopyPoints(QPolygonF &points) const {
+  if (points.capacity() < Size())
+    points.reserve(Size());
+  points.resize(Size());
+  QPointF *data = points.data();
+  for (int counter = 0; counter < Size(); ++counter)
+    data[counter] = QPointF(x[counter], y[counter]);
+}
+
+// CopyHandles - copies handles of control points into \p handles keeping its
+// capacity.
+void ControlPointStore::CopyHandles(QVector<Handle> &handles) const {
+  if (handles.capacity() < Size())
+    handles.reserve(Size());
+  handles.resize(Size());
+  for (int counter = 0; counter < Size(); ++counter)
+    handles[counter] = this->handles[counter];
+}
+
+// Release - the next point in the slot gets the next generation.
+void ControlPointStore::Release(Handle handle) {
+  const int slot = handle & slotMask;
+  indices[slot] = -1;
+  generations[slot] = (generations[slot] + 1) & generationMask;
+  freeSlots.push_back(slot);
+}
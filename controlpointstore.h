@@ -0,0 +1,84 @@
+#ifndef CONTROLPOINTSTORE_H
+#define CONTROLPOINTSTORE_H
+
+#include <QPointF>
+#include <QPolygonF>
+#include <QVector>
+
+// ControlPointStore - control points of B-spline and their speeds in
+// contiguous arrays of coordinates (structure of arrays), so that moving of
+// points and de Boor algorithm walk memory sequentially. Points are kept in
+// order of the spline and are addressed by index. Besides, every point has a
+// handle which stays valid while the point exists, whatever points are added
+// or removed before it. Handle keeps a slot in its lower bits and generation of
+// the slot in the upper ones. Slots of removed points are reused with the next
+// generation, so a handle kept after its point is removed, e.g. in a queued
+// command, never addresses the point added in its place.
+class ControlPointStore {
+public:
+  typedef int Handle;
+  enum { InvalidHandle = -1 };
+
+  ControlPointStore();
+
+  int Size() const;
+  bool IsEmpty() const;
+
+  // Add - appends control point to the end of the spline, returns its handle.
+  Handle Add(const QPointF &point, const QPointF &speed = QPointF());
+
+  // RemoveLast - removes the last control point, its handle becomes invalid.
+  void RemoveLast();
+
+  // Clear - removes all control points, their handles become invalid.
+  void Clear();
+
+  // Index - index of control point with \p handle or -1 if it was removed.
+  int Index(Handle handle) const;
+
+  // HandleAt - handle of control point \p index.
+  Handle HandleAt(int index) const;
+
+  QPointF Point(int index) const;
+  void SetPoint(int index, const QPointF &point);
+  QPointF Speed(int index) const;
+  void SetSpeed(int index, const QPointF &speed);
+
+  // operator[] - control point \p index, lets spline core read store as array
+  // of points.
+  QPointF operator[](int index) const { return QPointF(x[index], y[index]); }
+
+  // Coordinates and speeds, Size() values each.
+  qreal *X() { return x.data(); }
+  qreal *Y() { return y.data(); }
+  qreal *SpeedX() { return speedX.data(); }
+  qreal *SpeedY() { return speedY.data(); }
+  const qreal *X() const { return x.constData(); }
+  const qreal *Y() const { return y.constData(); }
+
+  // CopyPoints - copies control points into \p points keeping its capacity.
+  void CopyPoints(QPolygonF &points) const;
+
+  // CopyHandles - copies handles of control points into \p handles keeping its
+  // capacity.
+  void CopyHandles(QVector<Handle> &handles) const;
+
+private:
+  QVector<qreal> x;
+  QVector<qreal> y;
+  QVector<qreal> speedX;
+  QVector<qreal> speedY;
+
+  // Release - frees slot of control point with \p handle.
+  void Release(Handle handle);
+
+  // Handle of every control point, index of control point and generation of
+  // every slot. Slots of removed points are reused, their indices are -1
+  // meanwhile.
+  QVector<Handle> handles;
+  QVector<int> indices;
+  QVector<int> generations;
+  QVector<int> freeSlots;
+};
+
+#endif // CONTROLPOINTSTORE_H
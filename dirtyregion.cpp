@@ -0,0 +1,121 @@
+#include "dirtyregion.h"
+
+namespace {
+
+// Changed polylines are covered by boxes of this many segments.
+const int chunkSegmentsNumber = 32;
+
+inline qreal Area(const QRectF &rect) {
+  return rect.width() * rect.height();
+}
+
+} // namespace
+
+DirtyRegion::DirtyRegion(int maxRectsNumber) :
+  maxRectsNumber(qMax(maxRectsNumber, 1)) {}
+
+void DirtyRegion::Clear() {
+  rects.resize(0);
+}
+
+// Add - rectangle inside one of the kept ones adds nothing, kept ones inside
+// the rectangle are removed.
+void DirtyRegion::Add(const QRectF &rect) {
+  if (rect.isEmpty())
+    return;
+  for (int counter = rects.size() - 1; counter >= 0; --counter) {
+    if (rects[counter].contains(rect))
+      return;
+    if (rect.contains(rects[counter])) {
+      rects[counter] = rects.last();
+      rects.pop_back();
+    }
+  }
+  rects.push_back(rect);
+  if (rects.size() > maxRectsNumber)
+    MergeClosest();
+}
+
+// AddPoints - every box covers a run of segments and shares its last point
+// with the next box.
+void DirtyRegion::AddPoints(const QPointF *points, int begin, int end,
+                            qreal margin) {
+  for (int first = begin; first < end; first += chunkSegmentsNumber) {
+    const int last = qMin(first + chunkSegmentsNumber, end - 1);
+    qreal left = points[first].x();
+    qreal right = left;
+    qreal top = points[first].y();
+    qreal bottom = top;
+    for (int counter = first + 1; counter <= last; ++counter) {
+      left = qMin(left, points[counter].x());
+      right = qMax(right, points[counter].x());
+      top = qMin(top, points[counter].y());
+      bottom = qMax(bottom, points[counter].y());
+    }
+    Add(QRectF(left - margin, top - margin, right - left + 2 * margin,
+               bottom - top + 2 * margin));
+    if (last == end - 1)
+      break;
+  }
+}
+
+// AddChangedPolyline - the changed part lies between the longest common
+// prefix and the longest common suffix of polylines.
+void DirtyRegion::AddChangedPolyline(const QPolygonF &oldPolyline,
+                                     const QPolygonF &newPolyline,
+                                     qreal margin) {
+  const int oldSize = oldPolyline.size();
+  const int newSize = newPolyline.size();
+  const int commonSize = qMin(oldSize, newSize);
+  const QPointF *oldPoints = oldPolyline.constData();
+  const QPointF *newPoints = newPolyline.constData();
+  int prefix = 0;
+  while (prefix < commonSize && oldPoints[prefix] == newPoints[prefix])
+    ++prefix;
+  if (prefix == oldSize && prefix == newSize)
+    return;
+  int suffix = 0;
+  while (suffix < commonSize - prefix &&
+         oldPoints[oldSize - 1 - suffix] == newPoints[newSize - 1 - suffix])
+    ++suffix;
+  // Segments which join changed points to unchanged ones are changed too.
+  const int begin = qMax(prefix - 1, 0);
+  AddPoints(oldPoints, begin, qMin(oldSize - suffix + 1, oldSize), margin);
+  AddPoints(newPoints, begin, qMin(newSize - suffix + 1, newSize), margin);
+}
+
+bool DirtyRegion::IsEmpty() const {
+  return rects.isEmpty();
+}
+
+const QVector<QRectF> &DirtyRegion::Rects() const {
+  return rects;
+}
+
+qreal DirtyRegion::Area() const {
+  qreal area = 0;
+  for (int counter = 0; counter < rects.size(); ++counter)
+    area += ::Area(rects[counter]);
+  return area;
+}
+
+// MergeClosest - overlapping rectangles have negative growth and are merged
+// first.
+void DirtyRegion::MergeClosest() {
+  int bestFirst = 0;
+  int bestSecond = 1;
+  qreal bestGrowth = 0;
+  for (int first = 0; first < rects.size(); ++first)
+    for (int second = first + 1; second < rects.size(); ++second) {
+      const qreal growth = ::Area(rects[first].united(rects[second])) -
+                           ::Area(rects[first]) - ::Area(rects[second]);
+      if ((first == 0 && second == 1) || growth < bestGrowth) {
+        bestFirst = first;
+        bestSecond = second;
+        bestGrowth = growth;
+      }
+    }
+  rects[bestFirst] = rects[bestFirst].united(rects[bestSecond]);
+  rects[bestSecond] = rects.last();
+  rects.pop_back();
+}
@@ -0,0 +1,50 @@
+#ifndef DIRTYREGION_H
+#define DIRTYREGION_H
+
+#include <QPolygonF>
+#include <QRectF>
+#include <QVector>
+
+// DirtyRegion - collects bounding boxes of changed parts of a frame and keeps
+// them as a few rectangles, so that only they are repainted. When there are
+// more rectangles than the limit, the two rectangles whose union adds the least
+// area are merged. Changed polylines are covered by boxes of short runs of
+// points, so a long curve which changed in one place doesn't dirty its whole
+// bounding box.
+class DirtyRegion {
+public:
+  // DirtyRegion - region keeps at most \p maxRectsNumber rectangles.
+  explicit DirtyRegion(int maxRectsNumber = 8);
+
+  // Clear - removes all rectangles, storage is kept.
+  void Clear();
+
+  // Add - adds \p rect, empty rectangles are ignored.
+  void Add(const QRectF &rect);
+
+  // AddPoints - adds boxes of points [begin, end) of \p points and segments
+  // between them grown by \p margin.
+  void AddPoints(const QPointF *points, int begin, int end, qreal margin);
+
+  // AddChangedPolyline - compares \p oldPolyline with \p newPolyline and adds
+  // boxes of their points and segments which differ, in both of them, grown by
+  // \p margin. Points are compared from both ends, so points inserted or
+  // removed in the middle are found too.
+  void AddChangedPolyline(const QPolygonF &oldPolyline,
+                          const QPolygonF &newPolyline, qreal margin);
+
+  bool IsEmpty() const;
+  const QVector<QRectF> &Rects() const;
+
+  // Area - sum of areas of rectangles.
+  qreal Area() const;
+
+private:
+  // MergeClosest - merges the pair of rectangles with the least growth of area.
+  void MergeClosest();
+
+  int maxRectsNumber;
+  QVector<QRectF> rects;
+};
+
+#endif // DIRTYREGION_H
@@ -0,0 +1,149 @@
+#include "frameprofiler.h"
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <algorithm>
+
+namespace {
+
+const char *const stageNames[FrameProfiler::StagesNumber] = {
+  "move", "boor_net", "interpolation", "scene", "paint"
+};
+
+const char *const counterNames[FrameProfiler::CountersNumber] = {
+  "interpolated_points", "subdivision_level"
+};
+
+} // namespace
+
+Histogram::Histogram() {
+  Reset();
+}
+
+void Histogram::Add(qint64 value) {
+  if (value < 0)
+    value = 0;
+  ++buckets[BucketIndex(value)];
+  ++count;
+  if (value > max)
+    max = value;
+}
+
+// Merge - adds all values of \p other.
+void Histogram::Merge(const Histogram &other) {
+  for (int counter = 0; counter < BucketsNumber; ++counter)
+    buckets[counter] += other.buckets[counter];
+  count += other.count;
+  max = qMax(max, other.max);
+}
+
+void Histogram::Reset() {
+  std::fill(buckets, buckets + BucketsNumber, 0);
+  count = 0;
+  max = 0;
+}
+
+// Percentile - approximate value below which \p fraction of values are.
+qint64 Histogram::Percentile(double fraction) const {
+  if (count == 0)
+    return 0;
+  // Rank of the value, starting from 1.
+  qint64 rank = qMax((qint64) 1, (qint64) (fraction * count + 0.5));
+  qint64 seen = 0;
+  for (int counter = 0; counter < BucketsNumber; ++counter) {
+    seen += buckets[counter];
+    if (seen >= rank)
+      return qMin(BucketValue(counter), max);
+  }
+  return max;
+}
+
+// BucketIndex - index of bucket for \p value. Values 2^k..2^(k+1)-1 for
+// k >= SubBucketBits are split by their SubBucketBits highest bits after the
+// leading one.
+int Histogram::BucketIndex(qint64 value) {
+  if (value < SubBucketsNumber)
+    return (int) value;
+#ifdef Q_CC_GNU
+  int highestBit = 63 - __builtin_clzll((unsigned long long) value);
+#else
+  int highestBit = 0;
+  while ((value >> (highestBit + 1)) != 0)
+    ++highestBit;
+#endif
+  int shift = highestBit - SubBucketBits;
+  return (shift + 1) * SubBucketsNumber +
+         (int) (value >> shift) - SubBucketsNumber;
+}
+
+// BucketValue - the greatest value of bucket \p index.
+qint64 Histogram::BucketValue(int index) {
+  if (index < SubBucketsNumber)
+    return index;
+  int shift = index / SubBucketsNumber - 1;
+  qint64 subBucket = index % SubBucketsNumber + SubBucketsNumber;
+  return ((subBucket + 1) << shift) - 1;
+}
+
+// Merge - adds all records of \p other.
+void FrameProfiler::Merge(const FrameProfiler &other) {
+  for (int counter = 0; counter < StagesNumber; ++counter)
+    stages[counter].Merge(other.stages[counter]);
+  for (int counter = 0; counter < CountersNumber; ++counter)
+    counters[counter].Merge(other.counters[counter]);
+}
+
+void FrameProfiler::Reset() {
+  for (int counter = 0; counter < StagesNumber; ++counter)
+    stages[counter].Reset();
+  for (int counter = 0; counter < CountersNumber; ++counter)
+    counters[counter].Reset();
+}
+
+// Summary - one line with p50/p99/max of every stage in microseconds and of
+// every counter.
+QString FrameProfiler::Summary() const {
+  QStringList parts;
+  for (int counter = 0; counter < StagesNumber; ++counter) {
+    const Histogram &stage = stages[counter];
+    if (stage.Count() == 0)
+      continue;
+    parts << QString("%1 %2/%3/%4 us").arg(stageNames[counter])
+             .arg(stage.Percentile(0.5) / 1000)
+             .arg(stage.Percentile(0.99) / 1000)
+             .arg(stage.Max() / 1000);
+  }
+  for (int counter = 0; counter < CountersNumber; ++counter) {
+    const Histogram &histogram = counters[counter];
+    if (histogram.Count() == 0)
+      continue;
+    parts << QString("%1 %2/%3/%4").arg(counterNames[counter])
+             .arg(histogram.Percentile(0.5))
+             .arg(histogram.Percentile(0.99))
+             .arg(histogram.Max());
+  }
+  return parts.join(", ");
+}
+
+// Dump - writes table with count, p50, p99 and max of every stage and counter
+// into file \p fileName.
+bool FrameProfiler::Dump(const QString &fileName) const {
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    return false;
+  QTextStream stream(&file);
+  stream << "name,unit,count,p50,p99,max\n";
+  for (int counter = 0; counter < StagesNumber; ++counter) {
+    const Histogram &stage = stages[counter];
+    stream << stageNames[counter] << ",ns," << stage.Count() << ","
+           << stage.Percentile(0.5) << "," << stage.Percentile(0.99) << ","
+           << stage.Max() << "\n";
+  }
+  for (int counter = 0; counter < CountersNumber; ++counter) {
+    const Histogram &histogram = counters[counter];
+    stream << counterNames[counter] << ",," << histogram.Count() << ","
+           << histogram.Percentile(0.5) << "," << histogram.Percentile(0.99)
+           << "," << histogram.Max() << "\n";
+  }
+  return stream.status() == QTextStream::Ok;
+}
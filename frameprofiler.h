@@ -0,0 +1,111 @@
+#ifndef FRAMEPROFILER_H
+#define FRAMEPROFILER_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QtGlobal>
+
+// Histogram - distribution of non-negative values with relative error of about
+// 3%. Adding a value is a few arithmetic operations and nothing is allocated.
+class Histogram {
+public:
+  Histogram();
+
+  void Add(qint64 value);
+
+  // Merge - adds all values of \p other.
+  void Merge(const Histogram &other);
+
+  void Reset();
+
+  // Percentile - approximate value below which \p fraction of values are.
+  qint64 Percentile(double fraction) const;
+
+  qint64 Count() const { return count; }
+  qint64 Max() const { return max; }
+
+private:
+  // Values below 2^SubBucketBits have own buckets, every greater power of two
+  // is split into 2^SubBucketBits buckets.
+  enum {
+    SubBucketBits = 5,
+    SubBucketsNumber = 1 << SubBucketBits,
+    BucketsNumber = (64 - SubBucketBits) * SubBucketsNumber
+  };
+
+  static int BucketIndex(qint64 value);
+  static qint64 BucketValue(int index);
+
+  qint64 buckets[BucketsNumber];
+  qint64 count;
+  qint64 max;
+};
+
+// FrameProfiler - collects histograms of time spent in every stage of a frame
+// and of per-frame counters.
+class FrameProfiler {
+public:
+  enum Stage {
+    MoveStage,          // Moving of control points by animation.
+    BoorNetStage,       // De Boor algorithm.
+    InterpolationStage, // Subdivision of Bezier curves.
+    SceneStage,         // Updating of items on the scene.
+    PaintStage,         // Painting of items by the view.
+    StagesNumber
+  };
+
+  enum Counter {
+    InterpolatedPointsCounter,
+    SubdivisionLevelCounter, // Deepest level of subdivision reached.
+    CountersNumber
+  };
+
+  // AddStageTime - records that \p stage took \p nanoseconds.
+  void AddStageTime(Stage stage, qint64 nanoseconds) {
+    stages[stage].Add(nanoseconds);
+  }
+
+  // AddCounter - records \p value of \p counter in current frame.
+  void AddCounter(Counter counter, qint64 value) {
+    counters[counter].Add(value);
+  }
+
+  // Merge - adds all records of \p other.
+  void Merge(const FrameProfiler &other);
+
+  void Reset();
+
+  // Summary - one line with p50/p99/max of every stage and counter.
+  QString Summary() const;
+
+  // Dump - writes table with count, p50, p99 and max of every stage and
+  // counter into file \p fileName. Returns false if file can't be written.
+  bool Dump(const QString &fileName) const;
+
+private:
+  Histogram stages[StagesNumber];
+  Histogram counters[CountersNumber];
+};
+
+// StageTimer - measures time of its scope and adds it to \p profiler as
+// \p stage. Does nothing if \p profiler is 0.
+class StageTimer {
+public:
+  StageTimer(FrameProfiler *profiler, FrameProfiler::Stage stage) :
+    profiler(profiler), stage(stage) {
+    if (profiler)
+      timer.start();
+  }
+
+  ~StageTimer() {
+    if (profiler)
+      profiler->AddStageTime(stage, timer.nsecsElapsed());
+  }
+
+private:
+  FrameProfiler *profiler;
+  FrameProfiler::Stage stage;
+  QElapsedTimer timer;
+};
+
+#endif // FRAMEPROFILER_H
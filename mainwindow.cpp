@@ -1,259 +1,254 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
-#include "movingellipseitem.h"
-#include <QTime>
+#include "controlpointsitem.h"
+#include "polylineitem.h"
+#include <QScrollBar>
+#include <QStatusBar>
+#include <qmath.h>
+
+// Timings of frames are written to this file on exit.
+static const char *const frameProfileFileName = "frame_profile.csv";
+// Adaptive quality keeps frames within this time in nanoseconds, which leaves
+// headroom within period of animation.
+static const qint64 targetFrameTime = 20000000;
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent), ui(new Ui::MainWindow), framesNumber(0),
-    speedMultiplicator(1.0), pointsNumber(6) {
+    softwareRaster(false), adaptiveQuality(false), pointsNumber(6) {
   ui->setupUi(this);
 
-  fillKnotVector();
+  // Frames are calculated by worker and shown as soon as they are ready.
+  connect(&splineWorker, SIGNAL(FrameReady()), SLOT(updateView()));
+  splineWorker.start();
 
-  animationTimer = new QTimer();
-  connect(animationTimer, SIGNAL(timeout()), SLOT(moveCurve()));
+  qualityGovernor.SetTargetFrameTime(targetFrameTime);
 
   fpsTimer = new QTimer();
   connect(fpsTimer, SIGNAL(timeout()), SLOT(updateFPS()));
 
-  scene = new QGraphicsScene();
+  scene = new SplineScene(&frameProfiler);
   ui->graphicsView->setScene(scene);
+  // Items update boxes of changed parts only, view repaints just them.
+  ui->graphicsView->setViewportUpdateMode(
+        QGraphicsView::MinimalViewportUpdate);
+  // Only visible part of spline is interpolated in detail.
+  connect(ui->graphicsView->horizontalScrollBar(), SIGNAL(valueChanged(int)),
+          SLOT(updateViewport()));
+  connect(ui->graphicsView->verticalScrollBar(), SIGNAL(valueChanged(int)),
+          SLOT(updateViewport()));
+
+  curveItem = new PolylineItem(QColor("black"), QColor("black"));
+  controlPolygonItem = new PolylineItem(QColor("blue"), QColor("blue"));
+  boorNetItem = new PolylineItem(QColor("red"), QColor("green"));
+  // On Android control points must be larger for moving them with fingers.
+#ifdef Q_OS_ANDROID
+  const int controlPointSize = 50;
+#else
+  const int controlPointSize = 10;
+#endif
+  controlPointsItem = new ControlPointsItem(&splineWorker, controlPointSize);
+  controlPolygonItem->setZValue(1);
+  boorNetItem->setZValue(2);
+  controlPointsItem->setZValue(3);
+  scene->addItem(curveItem);
+  scene->addItem(controlPolygonItem);
+  scene->addItem(boorNetItem);
+  scene->addItem(controlPointsItem);
+  applyDisplaySettings();
   showRandomSpline();
 
   ui->ControlPointsLabel->setText(QString::number(pointsNumber));
 }
 
 MainWindow::~MainWindow() {
+  splineWorker.Stop();
+  splineWorker.TakeProfile(frameProfiler);
+  totalProfiler.Merge(frameProfiler);
+  totalProfiler.Dump(frameProfileFileName);
   delete ui;
-  delete animationTimer;
   delete fpsTimer;
   delete scene;
-  clearPoints();
 }
 
-/// fillKnotVector - fill \var knotVector with knots for uniform cubic B-spline
-/// that passes through endpoints.
-void MainWindow::fillKnotVector() {
-  int middleKnotNumber = pointsNumber - 4;
-  knotVector.clear();
-  for (int counter = 0; counter < 4; ++counter)
-    knotVector.push_back(0.0);
-  for (int counter = 1; counter <= middleKnotNumber; ++counter)
-    knotVector.push_back(1.0 / (middleKnotNumber + 1) * counter);
-  for (int counter = 0; counter < 4; ++counter)
-    knotVector.push_back(1.0);
+/// updateViewport - tell \var splineWorker which part of scene is visible in
+/// graphicsView and how it is scaled.
+void MainWindow::updateViewport() {
+  // Interpolated points are drawn as circles of this size in pixels.
+  const int margin = 4;
+  QGraphicsView *view = ui->graphicsView;
+  const double scale = qSqrt(qAbs(view->transform().determinant()));
+  QRectF visibleRect = visibleSceneRect();
+  const double sceneMargin = scale > 0.0 ? margin / scale : margin;
+  visibleRect.adjust(-sceneMargin, -sceneMargin, sceneMargin, sceneMargin);
+  splineWorker.SetViewport(visibleRect, scale);
+  // Image of the raster covers only visible part of the scene.
+  if (softwareRaster)
+    showFrame(splineWorker.Frame());
 }
 
-/// interpolateCurve - calculate new control points with de Boor algorithm,
-/// break curve into multiple Bezier curves and interpolate each Bezier curve.
-void MainWindow::interpolateCurve() {
-  interpolatedPoints.clear();
-  bezierInterpolator.CalculateBoorNet(controlPoints, knotVector, boorNetPoints);
-  interpolatedPoints.push_back(*(controlPoints.first()));
-  for (int counter = 0; counter < boorNetPoints.size() - 3; counter += 3)
-    bezierInterpolator.InterpolateBezier(boorNetPoints[counter],
-                                         boorNetPoints[counter + 1],
-                                         boorNetPoints[counter + 2],
-                                         boorNetPoints[counter + 3],
-                                         interpolatedPoints);
-  interpolatedPoints.push_back(*(controlPoints.last()));
+/// visibleSceneRect - part of the scene visible in graphicsView.
+QRectF MainWindow::visibleSceneRect() const {
+  QGraphicsView *view = ui->graphicsView;
+  return view->mapToScene(view->viewport()->rect()).boundingRect();
 }
 
-/// clearPoints - delete all control points properly.
-void MainWindow::clearPoints() {
-  for (int counter = 0; counter < controlPoints.size(); ++counter)
-    delete controlPoints[counter];
-  controlPoints.clear();
+void MainWindow::resizeEvent(QResizeEvent *event) {
+  QMainWindow::resizeEvent(event);
+  updateViewport();
 }
 
-/// addControlPoint - adds control point within borders of \var graphicsView.
-void MainWindow::addControlPoint()
-{
-  int x_border = ui->graphicsView->width();;
+/// randomControlPoint - random point within borders of \var graphicsView.
+QPointF MainWindow::randomControlPoint() const {
+  int x_border = ui->graphicsView->width();
   int y_border = ui->graphicsView->height();
   int x = qrand() % x_border;
   int y = qrand() % y_border;
-  controlPoints.push_back(new QPointF(x, y));
+  return QPointF(x, y);
+}
+
+/// applyDisplaySettings - shows or hides parts of items on the scene according
+/// to \var displaySettings.
+void MainWindow::applyDisplaySettings() {
+  // Adaptive quality may cull markers of points on the worst level.
+  const bool culled = adaptiveQuality && qualityGovernor.PointsCulled();
+  const bool showInterpolatedPoints =
+      displaySettings.showInterpolatedPoints && !culled;
+  const bool showBoorPoints = displaySettings.showBoorPoints && !culled;
+  curveItem->setShowPoints(showInterpolatedPoints);
+  controlPolygonItem->setShowLines(displaySettings.showControlLines);
+  boorNetItem->setShowPoints(showBoorPoints);
+  boorNetItem->setShowLines(displaySettings.showBoorLines);
+  controlPointsItem->setVisible(displaySettings.showControlPoints);
+
+  rasterizer.setShowInterpolatedPoints(showInterpolatedPoints);
+  rasterizer.setShowControlLines(displaySettings.showControlLines);
+  rasterizer.setShowBoorPoints(showBoorPoints);
+  rasterizer.setShowBoorLines(displaySettings.showBoorLines);
+  // Items of polylines are replaced by raster.
+  curveItem->setVisible(!softwareRaster);
+  controlPolygonItem->setVisible(!softwareRaster);
+  boorNetItem->setVisible(!softwareRaster);
+  if (softwareRaster)
+    showFrame(splineWorker.Frame());
 }
 
 /// showRandomSpline - generate random control points and show them.
 void MainWindow::showRandomSpline() {
-  scene->clear();
-  clearPoints();  
-
+  QPolygonF controlPoints;
   for (int counter = 0; counter < pointsNumber; ++counter) {
-    addControlPoint();
+    controlPoints.push_back(randomControlPoint());
   }
 
-  updateView();
+  splineWorker.SetControlPoints(controlPoints);
 }
 
 void MainWindow::on_startStopButton_clicked() {
   showRandomSpline();
 }
 
-/// updateView - calculate content of the scene based on control points and show
-/// it in graphicsView.
-void MainWindow::updateView(QPointF *skipPoint) {
-  QTime t;
-  t.start();
-  interpolateCurve();
-
-  // Show interpolated curve.
-  for (QPolygonF::iterator pointIt = interpolatedPoints.begin(),
-       pointEnd = interpolatedPoints.end(); pointIt != pointEnd; ++pointIt) {
-    if (pointIt != interpolatedPoints.end() - 1)
-     scene->addLine(QLineF(*pointIt, *(pointIt + 1)), QPen("black"));
-    if (displaySettings.showInterpolatedPoints)
-      scene->addEllipse(pointIt->x() - 2, pointIt->y() - 2, 4, 4, QPen("black"),
-                        QBrush("black"));
-  }
-  // Show control points.
-  for (QVector<QPointF*>::iterator pointIt = controlPoints.begin(),
-       pointEnd = controlPoints.end(); pointIt != pointEnd; ++pointIt) {
-    if (displaySettings.showControlLines && pointIt != controlPoints.end() - 1)
-      scene->addLine(QLineF(**pointIt, **(pointIt + 1)), QPen("blue"));
-    if ((skipPoint && skipPoint == *pointIt) ||
-        !displaySettings.showControlPoints) {
-      continue;
-    }
-    // On Android control points must be larger for moving them with fingers.
-#ifdef Q_OS_ANDROID
-    const int controlPointSize = 50;
-#else
-    const int controlPointSize = 10;
-#endif
-    MovingEllipseItem *pointItem = new MovingEllipseItem(
-                                     (*pointIt)->x() - controlPointSize / 2,
-                                     (*pointIt)->y() - controlPointSize / 2,
-                                     controlPointSize, controlPointSize, this);
-    itemToPoint[pointItem] = *pointIt;
-    pointItem->setBrush(QBrush("blue"));
-    pointItem->setFlag(QGraphicsItem::ItemIsMovable, true);
-    scene->addItem(pointItem);
-  }
-  // Show boor net points.
-  for (QPolygonF::iterator pointIt = boorNetPoints.begin(),
-       pointEnd = boorNetPoints.end(); pointIt != pointEnd; ++pointIt) {
-    if (displaySettings.showBoorLines && pointIt != boorNetPoints.end() - 1)
-      scene->addLine(QLineF(*pointIt, *(pointIt + 1)), QPen("red"));
-    if (displaySettings.showBoorPoints)
-      scene->addEllipse(pointIt->x() - 2, pointIt->y() - 2, 4, 4, QPen("green"),
-                        QBrush("green"));
+/// updateView - show the latest frame calculated by \var splineWorker in
+/// graphicsView.
+void MainWindow::updateView() {
+  if (!splineWorker.TakeFrame())
+    return;
+  const SplineFrame &frame = splineWorker.Frame();
+
+  QElapsedTimer sceneTimer;
+  sceneTimer.start();
+  {
+    StageTimer timer(&frameProfiler, FrameProfiler::SceneStage);
+    showFrame(frame);
   }
+  // Worker and view may overlap, so the sum is an upper bound of frame time.
+  // Painting of this frame is not done yet, the last one is close to it.
+  if (adaptiveQuality)
+    adaptQuality(frame.calculationTime + sceneTimer.nsecsElapsed() +
+                 scene->lastPaintTime());
 
   ui->InterpolatedPointsLabel->setText(
-        QString::number(interpolatedPoints.size()));
+        QString::number(frame.interpolatedPoints.size()));
   ++framesNumber;
 }
 
+/// showFrame - shows \p frame with items on the scene or with \var rasterizer.
+/// Raster is drawn here, so its time is counted in scene stage.
+void MainWindow::showFrame(const SplineFrame &frame) {
+  if (softwareRaster) {
+    rasterizer.render(frame, visibleSceneRect(),
+                      ui->graphicsView->viewport()->size());
+    scene->setRaster(&rasterizer.image(), rasterizer.sceneRect());
+  } else {
+    // Show interpolated curve.
+    curveItem->setPolyline(frame.interpolatedPoints);
+    // Show control points.
+    controlPolygonItem->setPolyline(frame.controlPoints);
+    // Show boor net points.
+    boorNetItem->setPolyline(frame.boorNetPoints);
+  }
+  controlPointsItem->setControlPoints(frame.controlPoints,
+                                      frame.controlPointHandles);
+}
+
 void MainWindow::on_checkBox_stateChanged(int arg1) {
   displaySettings.showInterpolatedPoints = arg1;
-  scene->clear();
-  updateView();
+  applyDisplaySettings();
 }
 
 void MainWindow::on_checkBox_2_stateChanged(int arg1) {
   displaySettings.showControlPoints = arg1;
-  scene->clear();
-  updateView();
+  applyDisplaySettings();
 }
 
 void MainWindow::on_checkBox_3_stateChanged(int arg1) {
     displaySettings.showBoorPoints = arg1;
-    scene->clear();
-    updateView();
+    applyDisplaySettings();
 }
 
 void MainWindow::on_checkBox_4_stateChanged(int arg1) {
     displaySettings.showControlLines = arg1;
-    scene->clear();
-    updateView();
+    applyDisplaySettings();
 }
 
 void MainWindow::on_checkBox_5_stateChanged(int arg1) {
     displaySettings.showBoorLines = arg1;
-    scene->clear();
-    updateView();
-}
-
-/// moveCurve - moves control points according to its speed and updates view.
-void MainWindow::moveCurve() {
-  if (controlPointsSpeed.size() != controlPoints.size()) {
-    // Randomly create speed.
-    controlPointsSpeed.clear();
-    const int speedLimit = 5;
-    for (int counter = 0; counter < controlPoints.size(); ++counter) {
-      controlPointsSpeed.push_back(QPointF(qrand() % speedLimit,
-                                           qrand() % speedLimit));
-    }
-  }
-
-  // Move each control point.
-  for (int counter = 0; counter < controlPoints.size(); ++counter) {
-    QPointF &point = *controlPoints[counter];
-    QPointF &speed = controlPointsSpeed[counter];
-    double xSpeed = speedMultiplicator * speed.x();
-    double ySpeed = speedMultiplicator * speed.y();
-    point.setX(point.x() + xSpeed);
-    point.setY(point.y() + ySpeed);
-    if (point.x() < 0 || point.x() > ui->graphicsView->width()) {
-      point.setX(point.x() - 2 * xSpeed);
-      speed.setX(-speed.x());
-    }
-    if (point.y() < 0 || point.y() > ui->graphicsView->height()) {
-      point.setY((point.y() - 2 * ySpeed));
-      speed.setY(-speed.y());
-    }
-    if (point.x() < 0 || point.x() > ui->graphicsView->width() ||
-        point.y() < 0 || point.y() > ui->graphicsView->height()) {
-      // Looks like view was resized and point is out of view.
-      point.setX(qrand() % ui->graphicsView->width());
-      point.setY(qrand() % ui->graphicsView->height());
-    }
-  }
-
-  scene->clear();
-  updateView();
+    applyDisplaySettings();
 }
 
 void MainWindow::on_RandomButton_clicked() {
-  if (animationTimer->isActive()) {
-    animationTimer->stop();
+  if (fpsTimer->isActive()) {
+    splineWorker.SetAnimated(false);
     fpsTimer->stop();
   } else {
-    animationTimer->start(30);
+    splineWorker.SetBounds(ui->graphicsView->size());
+    splineWorker.SetAnimated(true);
     fpsTimer->start(1000);
   }
 }
 
 void MainWindow::on_AddPointButton_clicked() {
   ++pointsNumber;
-  addControlPoint();
-  fillKnotVector();
-  scene->clear();
+  splineWorker.AddControlPoint(randomControlPoint());
   ui->ControlPointsLabel->setText(QString::number(pointsNumber));
-  updateView();
 }
 
 void MainWindow::on_DelPointButton_clicked() {
   if (pointsNumber < 4)
     return;
   --pointsNumber;
-  delete controlPoints.last();
-  controlPoints.pop_back();
-  if (!controlPointsSpeed.empty())
-    controlPointsSpeed.pop_back();
-  fillKnotVector();
-  scene->clear();
+  splineWorker.RemoveControlPoint();
   ui->ControlPointsLabel->setText(QString::number(pointsNumber));
-  updateView();
 }
 
-/// updateFPS - show FPS in gui.
+/// updateFPS - show FPS and frame timings in gui.
 void MainWindow::updateFPS() {
   ui->fpsLabel_2->setText(QString::number(framesNumber));
   framesNumber = 0;
+  // View may be resized while control points are moving.
+  splineWorker.SetBounds(ui->graphicsView->size());
+  splineWorker.TakeProfile(frameProfiler);
+  statusBar()->showMessage(frameProfiler.Summary());
+  totalProfiler.Merge(frameProfiler);
+  frameProfiler.Reset();
 }
 
 void MainWindow::on_AntialiasingSlider_sliderMoved(int position) {
@@ -263,26 +258,32 @@ void MainWindow::on_AntialiasingSlider_sliderMoved(int position) {
       // Disable antialiasing.
       ui->graphicsView->setRenderHint(QPainter::Antialiasing, false);
       ui->graphicsView->setRenderHint(QPainter::HighQualityAntialiasing, false);
+      rasterizer.setQuality(SplineRasterizer::AliasedQuality);
       ui->AntialiasingLabel->setText("Antialiasing: None");
       break;
     case 1:
       // Enable antialiasing.
       ui->graphicsView->setRenderHint(QPainter::Antialiasing, true);
       ui->graphicsView->setRenderHint(QPainter::HighQualityAntialiasing, false);
+      rasterizer.setQuality(SplineRasterizer::AntialiasedQuality);
       ui->AntialiasingLabel->setText("Antialiasing: Medium");
       break;
     case 2:
       // Maximum quality - maximum lags.
       ui->graphicsView->setRenderHint(QPainter::Antialiasing, true);
       ui->graphicsView->setRenderHint(QPainter::HighQualityAntialiasing, true);
+      rasterizer.setQuality(SplineRasterizer::SupersampledQuality);
       ui->AntialiasingLabel->setText("Antialiasing: High");
       break;
   }
+  if (softwareRaster)
+    showFrame(splineWorker.Frame());
 }
 
 void MainWindow::on_SpeedSlider_sliderMoved(int position) {
   Q_ASSERT(position >= 1 && position <= 20);
-  speedMultiplicator = (double) position / 10.0;
+  double speedMultiplicator = (double) position / 10.0;
+  splineWorker.SetSpeedMultiplicator(speedMultiplicator);
   ui->SpeedLabel->setText("Speed: " +
                           QString::number(speedMultiplicator, 'f', 1) + "x");
 }
@@ -296,10 +297,30 @@ void MainWindow::on_SpeedSlider_valueChanged(int value) {
 }
 
 void MainWindow::on_horizontalSlider_sliderMoved(int position) {
+  Q_UNUSED(position);
+  applyDistanceTolerance();
+}
+
+/// manualDistanceTolerance - distance tolerance chosen by horizontalSlider.
+double MainWindow::manualDistanceTolerance() const {
+  int max = ui->horizontalSlider->maximum();
+  return (double) (max - ui->horizontalSlider->sliderPosition()) + 0.5;
+}
+
+/// applyDistanceTolerance - passes tolerance of the slider or of
+/// \var qualityGovernor to \var splineWorker and shows it.
+void MainWindow::applyDistanceTolerance() {
   int max = ui->horizontalSlider->maximum();
-  double distanceTolerance = (double) (max - position) + 0.5;
-  bezierInterpolator.SetDistanceTolerance(distanceTolerance);
+  double distanceTolerance = manualDistanceTolerance();
+  if (adaptiveQuality) {
+    // Governor never goes beyond the worst quality of the slider.
+    qualityGovernor.SetToleranceRange(distanceTolerance, (double) max + 0.5);
+    distanceTolerance = qualityGovernor.DistanceTolerance();
+  }
+  splineWorker.SetDistanceTolerance(distanceTolerance);
 
+  // Position of the slider which corresponds to the tolerance.
+  int position = qMax(0, (int) (max - distanceTolerance + 0.5));
   QString prefix = "Interp Quality: ";
   QString postfix;
   // Divide quality into 4 ranges: Best, Good, Bad, Worst
@@ -312,12 +333,38 @@ void MainWindow::on_horizontalSlider_sliderMoved(int position) {
   else
     postfix = "Best";
 
+  if (adaptiveQuality)
+    postfix += " (Auto)";
+
   ui->QualityLabel->setText(prefix + postfix);
+}
 
-  scene->clear();
-  updateView();
+/// adaptQuality - records \p frameTime in \var qualityGovernor and applies
+/// its quality if it was changed.
+void MainWindow::adaptQuality(qint64 frameTime) {
+  if (!qualityGovernor.AddFrame(frameTime))
+    return;
+  applyDistanceTolerance();
+  // Markers of points may be culled.
+  applyDisplaySettings();
 }
 
 void MainWindow::on_horizontalSlider_valueChanged(int value) {
   on_horizontalSlider_sliderMoved(value);
 }
+
+void MainWindow::on_RasterCheckBox_stateChanged(int arg1) {
+  softwareRaster = arg1;
+  if (!softwareRaster)
+    scene->setRaster(0, QRectF());
+  // Items were not updated while raster was shown.
+  showFrame(splineWorker.Frame());
+  applyDisplaySettings();
+}
+
+void MainWindow::on_AdaptiveQualityCheckBox_stateChanged(int arg1) {
+  adaptiveQuality = arg1;
+  qualityGovernor.Reset();
+  applyDistanceTolerance();
+  applyDisplaySettings();
+}
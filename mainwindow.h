@@ -2,12 +2,15 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QGraphicsScene>
-#include <QHash>
 #include <QTimer>
-#include "bezierinterpolator.h"
+#include "frameprofiler.h"
+#include "qualitygovernor.h"
+#include "splinerasterizer.h"
+#include "splinescene.h"
+#include "splineworker.h"
 
-class MovingEllipseItem;
+class ControlPointsItem;
+class PolylineItem;
 
 namespace Ui {
 class MainWindow;
@@ -34,14 +37,11 @@ private slots:
   void on_AntialiasingSlider_sliderMoved(int position);
   void on_SpeedSlider_sliderMoved(int position);
 
-  /// updateView - calculate content of the scene based on control points and
-  /// show it in graphicsView.
-  void updateView(QPointF *skipPoint = 0);
+  /// updateView - show the latest frame calculated by \var splineWorker in
+  /// graphicsView.
+  void updateView();
 
-  /// moveCurve - moves control points according to its speed and updates view.
-  void moveCurve();
-
-  /// updateFPS - show FPS in gui.
+  /// updateFPS - show FPS and frame timings in gui.
   void updateFPS();
 
   void on_AntialiasingSlider_valueChanged(int value);
@@ -52,55 +52,81 @@ private slots:
 
   void on_horizontalSlider_valueChanged(int value);
 
-private:
-  // Crunch. After moving of control point scene must be rerendered and I am too
-  // lazy to create public function for it.
-  friend class MovingEllipseItem;
+  void on_RasterCheckBox_stateChanged(int arg1);
+
+  void on_AdaptiveQualityCheckBox_stateChanged(int arg1);
+
+  /// updateViewport - tell \var splineWorker which part of scene is visible in
+  /// graphicsView and how it is scaled.
+  void updateViewport();
+
+protected:
+  void resizeEvent(QResizeEvent *event);
 
+private:
   // User interface.
   Ui::MainWindow *ui;
 
   // Main scene for spline visualization.
-  QGraphicsScene *scene;
+  SplineScene *scene;
 
-  QTimer *animationTimer; // Control points will be moved by this timer.
   QTimer *fpsTimer; // On this timer fpsLabel is updated.
   unsigned framesNumber; // Number of frames rendered so far.
 
-  // Speed of control point is multiplied by this value before moving.
-  double speedMultiplicator;
+  // Timings of frames since the last update of FPS and since the start. The
+  // latter is written to file on exit.
+  FrameProfiler frameProfiler;
+  FrameProfiler totalProfiler;
 
-  QVector<QPointF*> controlPoints;
-  QVector<qreal> knotVector;
-  QPolygonF boorNetPoints;
-  QPolygonF interpolatedPoints;
+  // Moves control points and interpolates spline in its own thread.
+  SplineWorker splineWorker;
 
-  // Mapping of items on the scene to points in \var controlPoints.
-  QHash<MovingEllipseItem*, QPointF*> itemToPoint;
+  // Items on the scene. They are created once and only updated every frame.
+  PolylineItem *curveItem;
+  PolylineItem *controlPolygonItem;
+  PolylineItem *boorNetItem;
+  // One item for all control points.
+  ControlPointsItem *controlPointsItem;
 
-  QVector<QPointF> controlPointsSpeed;
+  // Draws curve, control polygon and boor net instead of items if
+  // \var softwareRaster is set. Control points are an item anyway.
+  SplineRasterizer rasterizer;
+  bool softwareRaster;
 
-  // Object with interface to boor net calculator and Bezier interpolation.
-  BezierInterpolator bezierInterpolator;
+  // Chooses distance tolerance by time of frames if \var adaptiveQuality is
+  // set. Tolerance of the slider is the best quality then.
+  QualityGovernor qualityGovernor;
+  bool adaptiveQuality;
 
   int pointsNumber;
 
   /// showRandomSpline - generate random control points and show them.
   void showRandomSpline();
 
-  /// interpolateCurve - calculate new control points with de Boor algorithm,
-  /// break curve into multiple Bezier curves and interpolate each Bezier curve.
-  void interpolateCurve();
+  /// randomControlPoint - random point within borders of \var graphicsView.
+  QPointF randomControlPoint() const;
+
+  /// visibleSceneRect - part of the scene visible in graphicsView.
+  QRectF visibleSceneRect() const;
+
+  /// showFrame - shows \p frame with items on the scene or with
+  /// \var rasterizer.
+  void showFrame(const SplineFrame &frame);
+
+  /// applyDisplaySettings - shows or hides parts of items on the scene
+  /// according to \var displaySettings.
+  void applyDisplaySettings();
 
-  /// clearPoints - delete all control points properly.
-  void clearPoints();
+  /// manualDistanceTolerance - distance tolerance chosen by horizontalSlider.
+  double manualDistanceTolerance() const;
 
-  /// fillKnotVector - fill \var knotVector with knots for uniform cubic
-  /// B-spline that passes through endpoints.
-  void fillKnotVector();
+  /// applyDistanceTolerance - passes tolerance of the slider or of
+  /// \var qualityGovernor to \var splineWorker and shows it.
+  void applyDistanceTolerance();
 
-  /// addControlPoint - adds control point within borders of \var graphicsView.
-  void addControlPoint();
+  /// adaptQuality - records \p frameTime in \var qualityGovernor and applies
+  /// its quality if it was changed.
+  void adaptQuality(qint64 frameTime);
 
   struct DisplaySettings {
     DisplaySettings() : showInterpolatedPoints(false), showControlPoints(true),
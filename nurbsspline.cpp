@@ -0,0 +1,90 @@
+#include "nurbsspline.h"
+
+NurbsSpline::NurbsSpline() : degree(3), bezierCurvesNumber(0) {}
+
+// SetDegree - knot vector must be set again after changing degree.
+void NurbsSpline::SetDegree(int degree) {
+  Q_ASSERT(degree >= 1 && degree <= bspline::maxNurbsDegree);
+  this->degree = degree;
+}
+
+int NurbsSpline::Degree() const {
+  return degree;
+}
+
+// SetControlPoints - weights of all control points are 1.
+void NurbsSpline::SetControlPoints(const QPolygonF &points) {
+  controlPoints.resize(points.size());
+  for (int counter = 0; counter < points.size(); ++counter)
+    controlPoints[counter] = bspline::MakeHomogeneous<qreal>(
+          points[counter].x(), points[counter].y(), 1.0);
+}
+
+void NurbsSpline::SetControlPoints(const QPolygonF &points,
+                                   const QVector<qreal> &weights) {
+  Q_ASSERT(points.size() == weights.size());
+  controlPoints.resize(points.size());
+  for (int counter = 0; counter < points.size(); ++counter) {
+    Q_ASSERT(weights[counter] > 0.0);
+    controlPoints[counter] = bspline::MakeHomogeneous<qreal>(
+          points[counter].x(), points[counter].y(), weights[counter]);
+  }
+}
+
+// SetControlPoint - moves control point \p index keeping its weight.
+void NurbsSpline::SetControlPoint(int index, const QPointF &point) {
+  HomogeneousPoint &controlPoint = controlPoints[index];
+  controlPoint = bspline::MakeHomogeneous<qreal>(point.x(), point.y(),
+                                                 controlPoint.w);
+}
+
+int NurbsSpline::ControlPointsNumber() const {
+  return controlPoints.size();
+}
+
+void NurbsSpline::SetKnotVector(const QVector<qreal> &knots) {
+  knotVector = knots;
+}
+
+// FillUniformKnotVector - clamped knot vector with evenly spaced interior knots
+// for current number of control points and degree.
+void NurbsSpline::FillUniformKnotVector() {
+  bspline::FillUniformKnotVector(degree, controlPoints.size(), knotVector);
+}
+
+void NurbsSpline::SetDistanceTolerance(double value) {
+  flattener.SetDistanceTolerance(value);
+}
+
+// Decompose - converts spline into rational Bezier curves.
+void NurbsSpline::Decompose() {
+  const int controlPointsNumber = controlPoints.size();
+  if (controlPointsNumber <= degree) {
+    bezierCurvesNumber = 0;
+    return;
+  }
+  Q_ASSERT(knotVector.size() == controlPointsNumber + degree + 1);
+  bezierPoints.resize(bspline::NurbsBezierPointsNumber(degree,
+                                                       controlPointsNumber));
+  bezierCurvesNumber = bspline::DecomposeNurbs(degree, knotVector.constData(),
+                                               controlPointsNumber,
+                                               controlPoints.constData(),
+                                               bezierPoints.data());
+}
+
+// BezierCurvesNumber - number of Bezier curves found by Decompose().
+int NurbsSpline::BezierCurvesNumber() const {
+  return bezierCurvesNumber;
+}
+
+// Interpolate - appends points of the spline including the first and the last
+// ones to \p interpolatedPoints.
+void NurbsSpline::Interpolate(QPolygonF &interpolatedPoints) const {
+  if (bezierCurvesNumber == 0)
+    return;
+  const HomogeneousPoint &first = bezierPoints.first();
+  interpolatedPoints.push_back(QPointF(first.x / first.w, first.y / first.w));
+  for (int counter = 0; counter < bezierCurvesNumber; ++counter)
+    flattener.Flatten(bezierPoints.constData() + degree * counter, degree,
+                      interpolatedPoints);
+}
@@ -0,0 +1,64 @@
+#ifndef NURBSSPLINE_H
+#define NURBSSPLINE_H
+
+#include <QPolygonF>
+#include <QVector>
+#include "bezierinterpolator.h"
+
+// NurbsSpline - non-uniform rational B-spline of degree from 1 to
+// bspline::maxNurbsDegree with arbitrary clamped knot vector and weights of
+// control points. It is interpolated by decomposition into rational Bezier
+// curves, which are subdivided adaptively. Uniform cubic B-spline without
+// weights is interpolated faster by BezierInterpolator.
+class NurbsSpline {
+public:
+  NurbsSpline();
+
+  // SetDegree - knot vector must be set again after changing degree.
+  void SetDegree(int degree);
+  int Degree() const;
+
+  // SetControlPoints - weights of all control points are 1.
+  void SetControlPoints(const QPolygonF &points);
+  void SetControlPoints(const QPolygonF &points, const QVector<qreal> &weights);
+  // SetControlPoint - moves control point \p index keeping its weight.
+  void SetControlPoint(int index, const QPointF &point);
+  int ControlPointsNumber() const;
+
+  // SetKnotVector - \p knots must have ControlPointsNumber() + Degree() + 1
+  // nondecreasing knots, the first and the last knots repeated Degree() + 1
+  // times, interior knots at most Degree() times.
+  void SetKnotVector(const QVector<qreal> &knots);
+
+  // FillUniformKnotVector - clamped knot vector with evenly spaced interior
+  // knots for current number of control points and degree.
+  void FillUniformKnotVector();
+
+  void SetDistanceTolerance(double value);
+
+  // Decompose - converts spline into rational Bezier curves. Must be called
+  // after changes of the spline before Interpolate().
+  void Decompose();
+
+  // BezierCurvesNumber - number of Bezier curves found by Decompose().
+  int BezierCurvesNumber() const;
+
+  // Interpolate - appends points of the spline including the first and the
+  // last ones to \p interpolatedPoints.
+  void Interpolate(QPolygonF &interpolatedPoints) const;
+
+private:
+  typedef bspline::HomogeneousPoint<qreal> HomogeneousPoint;
+
+  int degree;
+  QVector<HomogeneousPoint> controlPoints;
+  QVector<qreal> knotVector;
+
+  // Control points of Bezier curves, neighbour curves share end points.
+  QVector<HomogeneousPoint> bezierPoints;
+  int bezierCurvesNumber;
+
+  bspline::RationalBezierFlattener<qreal, QPointF> flattener;
+};
+
+#endif // NURBSSPLINE_H
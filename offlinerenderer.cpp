@@ -0,0 +1,217 @@
+#include "offlinerenderer.h"
+#include "bezierinterpolator.h"
+#include "compactpolyline.h"
+#include "workstealingpool.h"
+#include <QAtomicInt>
+#include <QDir>
+#include <qmath.h>
+
+namespace {
+
+// Control points are drawn as circles of this size, as in MainWindow.
+const qreal controlPointSize = 10;
+
+// Compact curve is decoded and drawn in runs of this many points.
+const int drawnRunPointsNumber = 256;
+
+// BouncedCoordinate - coordinate of control point after \p steps calls of
+// SplineWorker::MoveControlPoints(). Point which left [0, \p size] is put back
+// to its previous position minus one more step, so it walks over nodes
+// start + k * step between the lowest and the highest nodes within bounds and
+// turns back at them. Its node is a triangle wave of number of steps.
+// Worker accumulates rounding errors of fractional steps and may turn one node
+// earlier at the bound, here the node on the bound is always reached.
+qreal BouncedCoordinate(qreal start, qreal speed, qreal size, int steps) {
+  const qreal step = qAbs(speed);
+  if (step == 0 || start < 0 || start > size)
+    return start;
+  const qreal epsilon = 1e-9;
+  const qint64 below = (qint64) qFloor(start / step + epsilon);
+  const qint64 above = (qint64) qFloor((size - start) / step + epsilon);
+  // Highest node, the lowest one is 0.
+  const qint64 nodes = below + above;
+  // Worker relocates point randomly if step is larger than bounds.
+  if (nodes == 0)
+    return start;
+  const qint64 period = 2 * nodes;
+  // Phases above \var nodes are the way back.
+  qint64 phase = speed > 0 ? below : period - below;
+  phase = (phase + steps) % period;
+  const qint64 node = phase <= nodes ? phase : period - phase;
+  return start + (node - below) * step;
+}
+
+// DrawPolyline - draws \p points run by run, every run starts with the last
+// point of the previous one, so the whole curve is never decoded at once.
+void DrawPolyline(QPainter &painter, const CompactPolyline &points) {
+  QPointF run[drawnRunPointsNumber];
+  for (int first = 0; first + 1 < points.size();
+       first += drawnRunPointsNumber - 1) {
+    const int number = qMin(drawnRunPointsNumber, points.size() - first);
+    points.Read(first, number, run);
+    painter.drawPolyline(run, number);
+  }
+}
+
+// FramePen - cosmetic pen which is one pixel wide in the image scaled down
+// \p scale times.
+QPen FramePen(const QColor &color, int scale) {
+  QPen pen(color);
+  pen.setWidth(scale > 1 ? scale : 0);
+  pen.setCosmetic(true);
+  return pen;
+}
+
+} // namespace
+
+// FrameTask - renders one frame and writes it to file.
+class OfflineRenderer::FrameTask : public WorkStealingPool::Task {
+public:
+  FrameTask(const OfflineRenderer *renderer, int frame, QAtomicInt *failures) :
+    renderer(renderer), frame(frame), failures(failures) {}
+
+  void Run() {
+    QImage image(renderer->settings.size, QImage::Format_ARGB32_Premultiplied);
+    renderer->RenderFrame(frame, image);
+    if (!image.save(renderer->FileName(frame), "PNG"))
+      failures->fetchAndAddOrdered(1);
+  }
+
+private:
+  const OfflineRenderer *renderer;
+  int frame;
+  QAtomicInt *failures;
+};
+
+OfflineRenderer::Settings::Settings() :
+  seed(1), framesNumber(100), size(800, 600), antialiasing(1),
+  controlPointsNumber(6), distanceTolerance(0.5), speedMultiplicator(1.0),
+  compactPoints(false), directory(".") {}
+
+// Starting state is generated as in MainWindow::showRandomSpline() and
+// SplineWorker::MoveControlPoints().
+OfflineRenderer::OfflineRenderer(const Settings &settings) :
+  settings(settings) {
+  qsrand(settings.seed);
+  const int width = qMax(settings.size.width(), 1);
+  const int height = qMax(settings.size.height(), 1);
+  for (int counter = 0; counter < settings.controlPointsNumber; ++counter)
+    startPoints.push_back(QPointF(qrand() % width, qrand() % height));
+  const int speedLimit = 5;
+  for (int counter = 0; counter < settings.controlPointsNumber; ++counter)
+    speeds.push_back(QPointF(qrand() % speedLimit, qrand() % speedLimit));
+
+  bspline::FillUniformKnotVector(3, settings.controlPointsNumber, knotVector);
+}
+
+// Render - renders all frames on threads of \p pool, one task per frame.
+int OfflineRenderer::Render(WorkStealingPool &pool) const {
+  QDir().mkpath(settings.directory);
+  QAtomicInt failures(0);
+  QVector<WorkStealingPool::Task*> tasks;
+  for (int frame = 0; frame < settings.framesNumber; ++frame)
+    tasks.push_back(new FrameTask(this, frame, &failures));
+  pool.Run(tasks);
+  qDeleteAll(tasks);
+  return failures.fetchAndAddOrdered(0);
+}
+
+// RenderFrame - draws curve, control polygon and control points of frame
+// \p frame like MainWindow with default display settings.
+void OfflineRenderer::RenderFrame(int frame, QImage &image) const {
+  const QPolygonF controlPoints = ControlPoints(frame);
+  QPolygonF interpolatedPoints;
+  CompactPolyline compactPoints;
+  if (controlPoints.size() > 2) {
+    BezierInterpolator bezierInterpolator;
+    bezierInterpolator.SetDistanceTolerance(settings.distanceTolerance);
+    bezierInterpolator.SetClipRect(QRectF(QPointF(0, 0), settings.size));
+    QPolygonF boorNetPoints;
+    bezierInterpolator.CalculateBoorNet(controlPoints, knotVector,
+                                        boorNetPoints);
+    if (settings.compactPoints) {
+      compactPoints.push_back(controlPoints.first());
+      for (int first = 0; first + 3 < boorNetPoints.size(); first += 3)
+        bezierInterpolator.InterpolateCurve(boorNetPoints[first],
+                                            boorNetPoints[first + 1],
+                                            boorNetPoints[first + 2],
+                                            boorNetPoints[first + 3],
+                                            compactPoints);
+      compactPoints.push_back(controlPoints.last());
+    } else {
+      interpolatedPoints.push_back(controlPoints.first());
+      for (int first = 0; first + 3 < boorNetPoints.size(); first += 3)
+        bezierInterpolator.InterpolateCurve(boorNetPoints[first],
+                                            boorNetPoints[first + 1],
+                                            boorNetPoints[first + 2],
+                                            boorNetPoints[first + 3],
+                                            interpolatedPoints);
+      interpolatedPoints.push_back(controlPoints.last());
+    }
+  }
+
+  // Supersampled frame is drawn into a larger image of its own.
+  const int scale = SupersamplingScale(settings.antialiasing);
+  QImage supersampledImage;
+  if (scale > 1)
+    supersampledImage = QImage(image.size() * scale, image.format());
+  QImage &target = scale > 1 ? supersampledImage : image;
+  target.fill(qRgb(255, 255, 255));
+  QPainter painter(&target);
+  painter.setRenderHints(RenderHints(settings.antialiasing));
+  painter.scale(scale, scale);
+  painter.setPen(FramePen(QColor("black"), scale));
+  if (settings.compactPoints)
+    DrawPolyline(painter, compactPoints);
+  else
+    painter.drawPolyline(interpolatedPoints);
+  painter.setPen(FramePen(QColor("blue"), scale));
+  painter.drawPolyline(controlPoints);
+  painter.setPen(FramePen(QColor("black"), scale));
+  painter.setBrush(QBrush("blue"));
+  for (int counter = 0; counter < controlPoints.size(); ++counter) {
+    const QPointF &point = controlPoints[counter];
+    painter.drawEllipse(QRectF(point.x() - controlPointSize / 2,
+                               point.y() - controlPointSize / 2,
+                               controlPointSize, controlPointSize));
+  }
+  painter.end();
+  if (scale > 1)
+    image = supersampledImage.scaled(image.size(), Qt::IgnoreAspectRatio,
+                                     Qt::SmoothTransformation);
+}
+
+// ControlPoints - positions of control points at frame \p frame, frame 0 is the
+// starting state.
+QPolygonF OfflineRenderer::ControlPoints(int frame) const {
+  QPolygonF points(startPoints.size());
+  for (int counter = 0; counter < startPoints.size(); ++counter) {
+    const QPointF &start = startPoints[counter];
+    const QPointF speed = settings.speedMultiplicator * speeds[counter];
+    points[counter] = QPointF(
+          BouncedCoordinate(start.x(), speed.x(), settings.size.width(), frame),
+          BouncedCoordinate(start.y(), speed.y(), settings.size.height(),
+                            frame));
+  }
+  return points;
+}
+
+QString OfflineRenderer::FileName(int frame) const {
+  return QDir(settings.directory).filePath(
+        QString("frame_%1.png").arg(frame, 5, 10, QChar('0')));
+}
+
+// RenderHints - hints of painter for antialiasing level of AntialiasingSlider,
+// see MainWindow::on_AntialiasingSlider_sliderMoved(). HighQualityAntialiasing
+// works only with OpenGL paint engine, so high level of QImage is supersampled
+// instead.
+QPainter::RenderHints OfflineRenderer::RenderHints(int antialiasing) {
+  QPainter::RenderHints hints = 0;
+  if (antialiasing >= 1)
+    hints |= QPainter::Antialiasing;
+  return hints;
+}
+
+int OfflineRenderer::SupersamplingScale(int antialiasing) {
+  return antialiasing >= 2 ? 2 : 1;
+}
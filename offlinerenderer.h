@@ -0,0 +1,72 @@
+#ifndef OFFLINERENDERER_H
+#define OFFLINERENDERER_H
+
+#include <QImage>
+#include <QPainter>
+#include <QPolygonF>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+class WorkStealingPool;
+
+// OfflineRenderer - renders animation of B-spline without GUI into numbered
+// PNG images, one image per frame. Control points move as in SplineWorker, but
+// their positions are calculated directly from frame number, so frames are
+// independent and are rendered in parallel.
+class OfflineRenderer {
+public:
+  struct Settings {
+    Settings();
+
+    // Starting positions and speeds of control points are generated from seed.
+    unsigned seed;
+    int framesNumber;
+    QSize size;
+    // Levels of AntialiasingSlider: 0 - none, 1 - medium, 2 - high. High level
+    // is drawn at twice the size and scaled down.
+    int antialiasing;
+    int controlPointsNumber;
+    // Squared distance in pixels, see BezierInterpolator::SetDistanceTolerance.
+    double distanceTolerance;
+    double speedMultiplicator;
+    // Curve is interpolated into CompactPolyline and drawn from it.
+    bool compactPoints;
+    // Images are written into this directory as frame_00000.png and so on.
+    QString directory;
+  };
+
+  explicit OfflineRenderer(const Settings &settings);
+
+  // Render - renders all frames on threads of \p pool. Returns number of
+  // frames which could not be written.
+  int Render(WorkStealingPool &pool) const;
+
+  // RenderFrame - draws frame \p frame into \p image of size from settings.
+  void RenderFrame(int frame, QImage &image) const;
+
+  // ControlPoints - positions of control points at frame \p frame.
+  QPolygonF ControlPoints(int frame) const;
+
+  // FileName - path of image of frame \p frame.
+  QString FileName(int frame) const;
+
+  // RenderHints - hints of painter for antialiasing level of
+  // AntialiasingSlider.
+  static QPainter::RenderHints RenderHints(int antialiasing);
+
+  // SupersamplingScale - frames of \p antialiasing level are drawn this many
+  // times larger and are scaled down.
+  static int SupersamplingScale(int antialiasing);
+
+private:
+  class FrameTask;
+
+  Settings settings;
+  // Control points and their speeds at frame 0.
+  QPolygonF startPoints;
+  QPolygonF speeds;
+  QVector<qreal> knotVector;
+};
+
+#endif // OFFLINERENDERER_H
@@ -0,0 +1,144 @@
+#include "parallelflattener.h"
+
+namespace {
+
+// Composite curves with fewer curves per range are interpolated on one
+// thread, threads would cost more than they save.
+const int minCurvesPerRange = 256;
+
+// Every thread gets several ranges, so that threads which are done earlier
+// steal the rest. Curves near the view are much longer than clipped ones, so
+// ranges take different time.
+const int rangesPerThread = 4;
+
+} // namespace
+
+// RangeTask - counts points of one range of curves in the first phase and
+// writes them at the offset of the range in the second one.
+class ParallelFlattener::RangeTask : public WorkStealingPool::Task {
+public:
+  explicit RangeTask(const QVector<BezierInterpolator*> &interpolators) :
+    interpolators(interpolators), x(0), y(0), curvesNumber(0),
+    pointsNumber(0), output(0), offset(0), curveEnds(0) {}
+
+  void Run() {
+    // Interpolation records statistics, so every thread has its own copy.
+    const BezierInterpolator &interpolator =
+        *interpolators[qMax(ThreadIndex(), 0)];
+    if (!output)
+      pointsNumber = interpolator.CountBezierBatch(x, y, curvesNumber);
+    else
+      interpolator.FillBezierBatch(x, y, curvesNumber, output, offset,
+                                   curveEnds);
+  }
+
+  const QVector<BezierInterpolator*> &interpolators;
+  const double *x;
+  const double *y;
+  int curvesNumber;
+  // Result of the first phase.
+  int pointsNumber;
+
+  // Second phase, \var output is 0 in the first one.
+  QPointF *output;
+  int offset;
+  int *curveEnds;
+};
+
+ParallelFlattener::ParallelFlattener() :
+  pool(0), interpolatorsRevision(0) {}
+
+ParallelFlattener::~ParallelFlattener() {
+  for (int counter = 0; counter < tasks.size(); ++counter)
+    delete tasks[counter];
+  for (int counter = 0; counter < interpolators.size(); ++counter)
+    delete interpolators[counter];
+}
+
+void ParallelFlattener::SetPool(WorkStealingPool *value) {
+  pool = value;
+}
+
+// SplitsCurves - there must be at least two ranges and two threads.
+bool ParallelFlattener::SplitsCurves(int curvesNumber) const {
+  return curvesNumber / minCurvesPerRange >= 2 && pool &&
+         pool->ThreadsNumber() >= 2;
+}
+
+// InterpolateBezierBatch - counts points of ranges of curves in parallel, then
+// writes them in parallel at offsets given by prefix sum of the counts.
+void ParallelFlattener::InterpolateBezierBatch(
+    const BezierInterpolator &bezierInterpolator, const double *x,
+    const double *y, int curvesNumber, QPolygonF &interpolatedPoints,
+    int *curveEnds) {
+  if (!SplitsCurves(curvesNumber)) {
+    bezierInterpolator.InterpolateBezierBatch(x, y, curvesNumber,
+                                              interpolatedPoints, curveEnds);
+    return;
+  }
+
+  UpdateInterpolators(bezierInterpolator, pool->ThreadsNumber());
+  const int rangesNumber = qMin(curvesNumber / minCurvesPerRange,
+                                rangesPerThread * pool->ThreadsNumber());
+  // Pool runs all given tasks, so there is exactly one task per range.
+  while (tasks.size() < rangesNumber)
+    tasks.push_back(new RangeTask(interpolators));
+  while (tasks.size() > rangesNumber) {
+    delete tasks.last();
+    tasks.pop_back();
+  }
+
+  // Count: subdivide without writing points.
+  for (int counter = 0; counter < rangesNumber; ++counter) {
+    RangeTask *task = static_cast<RangeTask*>(tasks[counter]);
+    const int begin = (int) ((qint64) curvesNumber * counter / rangesNumber);
+    const int end =
+        (int) ((qint64) curvesNumber * (counter + 1) / rangesNumber);
+    task->x = x + 3 * begin;
+    task->y = y + 3 * begin;
+    task->curvesNumber = end - begin;
+    task->output = 0;
+    task->curveEnds = curveEnds ? curveEnds + begin : 0;
+  }
+  pool->Run(tasks);
+
+  // Exclusive prefix sum of counts of ranges gives their offsets.
+  int size = interpolatedPoints.size();
+  for (int counter = 0; counter < rangesNumber; ++counter) {
+    RangeTask *task = static_cast<RangeTask*>(tasks[counter]);
+    task->offset = size;
+    size += task->pointsNumber;
+  }
+
+  // Fill: output grows only once and ranges are flattened into it.
+  interpolatedPoints.resize(size);
+  for (int counter = 0; counter < rangesNumber; ++counter)
+    static_cast<RangeTask*>(tasks[counter])->output =
+        interpolatedPoints.data();
+  pool->Run(tasks);
+
+  for (int counter = 0; counter < interpolators.size(); ++counter)
+    bezierInterpolator.ReachSubdivisionLevel(
+          interpolators[counter]->MaxSubdivisionLevel());
+}
+
+// UpdateInterpolators - copies are taken only when settings of
+// \p bezierInterpolator changed since the last call, statistics are reset.
+void ParallelFlattener::UpdateInterpolators(
+    const BezierInterpolator &bezierInterpolator, int threadsNumber) {
+  if (interpolators.size() != threadsNumber) {
+    for (int counter = 0; counter < interpolators.size(); ++counter)
+      delete interpolators[counter];
+    interpolators.resize(threadsNumber);
+    for (int counter = 0; counter < threadsNumber; ++counter)
+      interpolators[counter] = new BezierInterpolator;
+    interpolatorsRevision = 0;
+  }
+  const bool changed = interpolatorsRevision != bezierInterpolator.Revision();
+  for (int counter = 0; counter < threadsNumber; ++counter) {
+    if (changed)
+      *interpolators[counter] = bezierInterpolator;
+    interpolators[counter]->ResetMaxSubdivisionLevel();
+  }
+  interpolatorsRevision = bezierInterpolator.Revision();
+}
@@ -0,0 +1,61 @@
+#ifndef PARALLELFLATTENER_H
+#define PARALLELFLATTENER_H
+
+#include <QPolygonF>
+#include <QVector>
+#include "bezierinterpolator.h"
+#include "workstealingpool.h"
+
+// ParallelFlattener - interpolates Bezier curves of one long composite curve
+// on threads of WorkStealingPool. Curves are split into contiguous ranges.
+// In the first phase points of every range are only counted: subdivision runs
+// without writing points, other engines predict their number. Exclusive prefix
+// sum of the counts gives offset of every range in the output, which is
+// resized once. In the second phase ranges are flattened straight into the
+// output at their offsets. Points are the same and in the same order as of
+// BezierInterpolator::InterpolateBezierBatch.
+class ParallelFlattener {
+public:
+  ParallelFlattener();
+  ~ParallelFlattener();
+
+  // SetPool - long curves are interpolated on threads of \p value, which is
+  // not owned. If it is 0 (the default), all curves are interpolated on the
+  // calling thread.
+  void SetPool(WorkStealingPool *value);
+
+  // InterpolateBezierBatch - the same as the function of
+  // \p bezierInterpolator with the same arguments. Short composite curves are
+  // interpolated on the calling thread. Subdivision level reached by threads
+  // is recorded into \p bezierInterpolator.
+  void InterpolateBezierBatch(const BezierInterpolator &bezierInterpolator,
+                              const double *x, const double *y,
+                              int curvesNumber, QPolygonF &interpolatedPoints,
+                              int *curveEnds = 0);
+
+  // SplitsCurves - whether composite curve of \p curvesNumber curves is
+  // interpolated on several threads.
+  bool SplitsCurves(int curvesNumber) const;
+
+private:
+  class RangeTask;
+
+  // UpdateInterpolators - makes one copy of \p bezierInterpolator for each of
+  // \p threadsNumber threads.
+  void UpdateInterpolators(const BezierInterpolator &bezierInterpolator,
+                           int threadsNumber);
+
+  WorkStealingPool *pool;
+  // RangeTask of every range, kept between calls.
+  QVector<WorkStealingPool::Task*> tasks;
+  // Copy of interpolator for every thread of pool and revision of their
+  // settings.
+  QVector<BezierInterpolator*> interpolators;
+  int interpolatorsRevision;
+
+  // Copying is not supported.
+  ParallelFlattener(const ParallelFlattener &);
+  ParallelFlattener &operator=(const ParallelFlattener &);
+};
+
+#endif // PARALLELFLATTENER_H
@@ -0,0 +1,233 @@
+#include "pointgrid.h"
+
+namespace {
+
+// Buckets are never fewer than this, so small grids don't rehash often.
+const int minBucketsNumber = 64;
+
+// Cells beyond this coordinate are clamped, so that cell coordinates fit into
+// int. Far points share cells, which is slower but still correct.
+const double maxCellCoordinate = 1 << 30;
+
+// NearestVisitor - keeps the nearest point within radius.
+struct NearestVisitor {
+  NearestVisitor(const QVector<QPointF> &points, const QPointF &center,
+                 double radius) :
+    points(points), center(center), bestDistance(radius * radius),
+    best(-1) {}
+
+  void operator()(int index) {
+    const QPointF delta = points[index] - center;
+    const double distance = delta.x() * delta.x() + delta.y() * delta.y();
+    if (distance <= bestDistance) {
+      bestDistance = distance;
+      best = index;
+    }
+  }
+
+  const QVector<QPointF> &points;
+  QPointF center;
+  double bestDistance;
+  int best;
+};
+
+// WithinVisitor - collects points within radius.
+struct WithinVisitor {
+  WithinVisitor(const QVector<QPointF> &points, const QPointF &center,
+                double radius, QVector<int> &indices) :
+    points(points), center(center), squaredRadius(radius * radius),
+    indices(indices) {}
+
+  void operator()(int index) {
+    const QPointF delta = points[index] - center;
+    if (delta.x() * delta.x() + delta.y() * delta.y() <= squaredRadius)
+      indices.push_back(index);
+  }
+
+  const QVector<QPointF> &points;
+  QPointF center;
+  double squaredRadius;
+  QVector<int> &indices;
+};
+
+// RectVisitor - collects points within rect.
+struct RectVisitor {
+  RectVisitor(const QVector<QPointF> &points, const QRectF &rect,
+              QVector<int> &indices) :
+    points(points), rect(rect), indices(indices) {}
+
+  void operator()(int index) {
+    const QPointF &point = points[index];
+    if (point.x() >= rect.left() && point.x() <= rect.right() &&
+        point.y() >= rect.top() && point.y() <= rect.bottom())
+      indices.push_back(index);
+  }
+
+  const QVector<QPointF> &points;
+  QRectF rect;
+  QVector<int> &indices;
+};
+
+// CellCoordinate - number of cell which contains \p value, \p scale is
+// inverse size of cell. It is called for every point on every update, so
+// floor is done by truncation instead of a call.
+inline int CellCoordinate(double value, double scale) {
+  const double cell = value * scale;
+  // Comparisons are false for NaN, it goes to cell 0.
+  if (!(cell > -maxCellCoordinate))
+    return cell < 0 ? (int) -maxCellCoordinate : 0;
+  if (!(cell < maxCellCoordinate))
+    return (int) maxCellCoordinate;
+  const int truncated = (int) cell;
+  return truncated - (cell < truncated);
+}
+
+} // namespace
+
+PointGrid::PointGrid(double cellSize) :
+  cellSize(cellSize), cellScale(1.0 / cellSize) {
+  Rebuild();
+}
+
+// SetCellSize - grid is rebuilt with cells of \p size.
+void PointGrid::SetCellSize(double size) {
+  if (size <= 0.0 || size == cellSize)
+    return;
+  cellSize = size;
+  cellScale = 1.0 / size;
+  Rebuild();
+}
+
+int PointGrid::Size() const {
+  return points.size();
+}
+
+QPointF PointGrid::Point(int index) const {
+  return points[index];
+}
+
+// SetPoints - makes \p points the indexed points. Points of animated spline
+// move a little every frame, so most of them stay in their buckets.
+void PointGrid::SetPoints(const QPolygonF &points) {
+  if (points.size() != this->points.size()) {
+    this->points.resize(points.size());
+    for (int counter = 0; counter < points.size(); ++counter)
+      this->points[counter] = points[counter];
+    Rebuild();
+    return;
+  }
+  for (int counter = 0; counter < points.size(); ++counter)
+    MovePoint(counter, points[counter]);
+}
+
+// MovePoint - point is relinked only if it moves to another bucket.
+void PointGrid::MovePoint(int index, const QPointF &point) {
+  points[index] = point;
+  const int bucket = BucketOf(CellOf(point));
+  if (bucket == bucketOf[index])
+    return;
+  Unlink(index);
+  Link(index, bucket);
+}
+
+// FindNearest - index of the nearest point not farther than \p radius or -1.
+int PointGrid::FindNearest(const QPointF &point, double radius) const {
+  NearestVisitor visit(points, point, radius);
+  ForEachInRect(QRectF(point.x() - radius, point.y() - radius,
+                       2 * radius, 2 * radius), visit);
+  return visit.best;
+}
+
+// FindWithin - indices of all points not farther than \p radius from
+// \p center.
+void PointGrid::FindWithin(const QPointF &center, double radius,
+                           QVector<int> &indices) const {
+  indices.resize(0);
+  WithinVisitor visit(points, center, radius, indices);
+  ForEachInRect(QRectF(center.x() - radius, center.y() - radius,
+                       2 * radius, 2 * radius), visit);
+}
+
+// FindInRect - indices of all points within \p rect.
+void PointGrid::FindInRect(const QRectF &rect, QVector<int> &indices) const {
+  indices.resize(0);
+  RectVisitor visit(points, rect.normalized(), indices);
+  ForEachInRect(rect.normalized(), visit);
+}
+
+PointGrid::Cell PointGrid::CellOf(const QPointF &point) const {
+  Cell cell;
+  cell.x = CellCoordinate(point.x(), cellScale);
+  cell.y = CellCoordinate(point.y(), cellScale);
+  return cell;
+}
+
+// BucketOf - hash of \p cell, number of buckets is a power of two.
+int PointGrid::BucketOf(const Cell &cell) const {
+  const quint32 hash = ((quint32) cell.x * 73856093u) ^
+                       ((quint32) cell.y * 19349663u);
+  return (int) (hash & (quint32) (buckets.size() - 1));
+}
+
+// Rebuild - there are at least as many buckets as points, so lists are short.
+void PointGrid::Rebuild() {
+  int bucketsNumber = minBucketsNumber;
+  while (bucketsNumber < points.size())
+    bucketsNumber *= 2;
+  buckets.resize(bucketsNumber);
+  buckets.fill(-1);
+  bucketOf.resize(points.size());
+  next.resize(points.size());
+  previous.resize(points.size());
+  for (int counter = 0; counter < points.size(); ++counter)
+    Link(counter, BucketOf(CellOf(points[counter])));
+}
+
+// Link - puts point \p index at the head of list of \p bucket.
+void PointGrid::Link(int index, int bucket) {
+  const int head = buckets[bucket];
+  next[index] = head;
+  previous[index] = -1;
+  if (head >= 0)
+    previous[head] = index;
+  buckets[bucket] = index;
+  bucketOf[index] = bucket;
+}
+
+// Unlink - removes point \p index from list of its bucket.
+void PointGrid::Unlink(int index) {
+  const int before = previous[index];
+  const int after = next[index];
+  if (before >= 0)
+    next[before] = after;
+  else
+    buckets[bucketOf[index]] = after;
+  if (after >= 0)
+    previous[after] = before;
+}
+
+// ForEachInRect - bucket may hold points of other cells with the same hash,
+// they are skipped, so that every point is visited once.
+template <typename Visitor>
+void PointGrid::ForEachInRect(const QRectF &rect, Visitor &visit) const {
+  const Cell first = CellOf(rect.topLeft());
+  const Cell last = CellOf(rect.bottomRight());
+  const qint64 cellsNumber = (qint64) (last.x - first.x + 1) *
+                             (last.y - first.y + 1);
+  if (cellsNumber > points.size()) {
+    for (int counter = 0; counter < points.size(); ++counter)
+      visit(counter);
+    return;
+  }
+  Cell cell;
+  for (cell.y = first.y; cell.y <= last.y; ++cell.y) {
+    for (cell.x = first.x; cell.x <= last.x; ++cell.x) {
+      for (int index = buckets[BucketOf(cell)]; index >= 0;
+           index = next[index]) {
+        const Cell pointCell = CellOf(points[index]);
+        if (pointCell.x == cell.x && pointCell.y == cell.y)
+          visit(index);
+      }
+    }
+  }
+}
@@ -0,0 +1,79 @@
+#ifndef POINTGRID_H
+#define POINTGRID_H
+
+#include <QPointF>
+#include <QPolygonF>
+#include <QRectF>
+#include <QVector>
+
+// PointGrid - uniform grid over points for picking. Plane is split into square
+// cells, cells are hashed into buckets and every bucket is a doubly linked list
+// of points, so the grid is not limited by bounds and a point is moved to
+// another cell in constant time. Queries visit only cells around the query,
+// storage is reused between updates.
+class PointGrid {
+public:
+  explicit PointGrid(double cellSize = 10.0);
+
+  // SetCellSize - queries are fastest when cell is about as large as their
+  // radius. Grid is rebuilt.
+  void SetCellSize(double size);
+
+  int Size() const;
+  QPointF Point(int index) const;
+
+  // SetPoints - makes \p points the indexed points. If number of points is
+  // the same, only points which moved to another cell are relinked.
+  void SetPoints(const QPolygonF &points);
+
+  // MovePoint - moves point \p index to \p point.
+  void MovePoint(int index, const QPointF &point);
+
+  // FindNearest - index of the point nearest to \p point not farther than
+  // \p radius, -1 if there is no such point.
+  int FindNearest(const QPointF &point, double radius) const;
+
+  // FindWithin - indices of all points not farther than \p radius from
+  // \p center. \p indices is cleared first.
+  void FindWithin(const QPointF &center, double radius,
+                  QVector<int> &indices) const;
+
+  // FindInRect - indices of all points within \p rect. \p indices is cleared
+  // first.
+  void FindInRect(const QRectF &rect, QVector<int> &indices) const;
+
+private:
+  // Cell - coordinates of cell which contains a point.
+  struct Cell {
+    int x;
+    int y;
+  };
+
+  Cell CellOf(const QPointF &point) const;
+  int BucketOf(const Cell &cell) const;
+
+  // Rebuild - links all points anew, number of buckets follows number of
+  // points.
+  void Rebuild();
+  void Link(int index, int bucket);
+  void Unlink(int index);
+
+  // ForEachInRect - calls \p visit for every point within cells which cover
+  // \p rect. If the rect covers more cells than there are points, all points
+  // are visited instead.
+  template <typename Visitor>
+  void ForEachInRect(const QRectF &rect, Visitor &visit) const;
+
+  double cellSize;
+  // Inverse of cellSize.
+  double cellScale;
+  QVector<QPointF> points;
+  // First point of every bucket, -1 if bucket is empty.
+  QVector<int> buckets;
+  // Bucket, next and previous point of every point.
+  QVector<int> bucketOf;
+  QVector<int> next;
+  QVector<int> previous;
+};
+
+#endif // POINTGRID_H
@@ -0,0 +1,137 @@
+#include "polylineitem.h"
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
+
+// Points are shown as circles of this size.
+static const qreal pointSize = 4;
+// Painting skips runs of this many segments outside of exposed rect.
+static const int chunkSegmentsNumber = 64;
+
+PolylineItem::PolylineItem(const QColor &lineColor, const QColor &pointColor,
+                           QGraphicsItem *parent) :
+  QGraphicsItem(parent), linePen(lineColor), pointPen(pointColor),
+  pointBrush(pointColor), showLines(true), showPoints(false) {
+  // Only exposed segments are painted.
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
+}
+
+/// setPolyline - replaces points of polyline. Geometry of the item is changed
+/// only if polyline grows out of it or most of it changed, e.g. in animation,
+/// otherwise boxes of changed segments are updated.
+void PolylineItem::setPolyline(const QPolygonF &points) {
+  const qreal margin = pointSize / 2 + 1;
+  dirtyRegion.Clear();
+  dirtyRegion.AddChangedPolyline(polyline, points, margin);
+  if (dirtyRegion.IsEmpty())
+    return;
+
+  // Reserved storage is never shrunk by resize().
+  if (polyline.capacity() < points.size())
+    polyline.reserve(points.size());
+  polyline.resize(points.size());
+  std::copy(points.constBegin(), points.constEnd(), polyline.begin());
+  polylineRect = polyline.boundingRect();
+  updateChunkRects();
+
+  const QRectF rect = polylineRect.adjusted(-margin, -margin, margin, margin);
+  if (!itemRect.contains(rect) ||
+      2 * dirtyRegion.Area() > itemRect.width() * itemRect.height()) {
+    prepareGeometryChange();
+    itemRect = rect;
+    return;
+  }
+  const QVector<QRectF> &dirtyRects = dirtyRegion.Rects();
+  for (int counter = 0; counter < dirtyRects.size(); ++counter)
+    update(dirtyRects[counter]);
+}
+
+/// updateChunkRects - chunk i holds segments from point
+/// i * chunkSegmentsNumber, the last point of a chunk is the first one of the
+/// next chunk.
+void PolylineItem::updateChunkRects() {
+  const qreal margin = pointSize / 2 + 1;
+  const int pointsNumber = polyline.size();
+  const int chunksNumber = pointsNumber > 1 ?
+        (pointsNumber - 2) / chunkSegmentsNumber + 1 : pointsNumber;
+  const QPointF *points = polyline.constData();
+  chunkRects.resize(chunksNumber);
+  for (int chunk = 0; chunk < chunksNumber; ++chunk) {
+    const int first = chunk * chunkSegmentsNumber;
+    const int last = qMin(first + chunkSegmentsNumber, pointsNumber - 1);
+    qreal left = points[first].x();
+    qreal right = left;
+    qreal top = points[first].y();
+    qreal bottom = top;
+    for (int counter = first + 1; counter <= last; ++counter) {
+      left = qMin(left, points[counter].x());
+      right = qMax(right, points[counter].x());
+      top = qMin(top, points[counter].y());
+      bottom = qMax(bottom, points[counter].y());
+    }
+    chunkRects[chunk] = QRectF(left - margin, top - margin,
+                               right - left + 2 * margin,
+                               bottom - top + 2 * margin);
+  }
+}
+
+/// setShowLines - switches visibility of polyline segments.
+void PolylineItem::setShowLines(bool show) {
+  showLines = show;
+  update();
+}
+
+/// setShowPoints - switches visibility of polyline points.
+void PolylineItem::setShowPoints(bool show) {
+  showPoints = show;
+  update();
+}
+
+QRectF PolylineItem::boundingRect() const {
+  return itemRect;
+}
+
+/// paint - consecutive exposed chunks are drawn as one polyline.
+void PolylineItem::paint(QPainter *painter,
+                         const QStyleOptionGraphicsItem *option,
+                         QWidget *widget) {
+  Q_UNUSED(widget);
+  const QRectF &exposedRect = option->exposedRect;
+  const QPointF *points = polyline.constData();
+  const int chunksNumber = chunkRects.size();
+  if (showLines && polyline.size() > 1) {
+    painter->setPen(linePen);
+    painter->setBrush(Qt::NoBrush);
+    int chunk = 0;
+    while (chunk < chunksNumber) {
+      if (!chunkRects[chunk].intersects(exposedRect)) {
+        ++chunk;
+        continue;
+      }
+      const int first = chunk * chunkSegmentsNumber;
+      while (chunk < chunksNumber &&
+             chunkRects[chunk].intersects(exposedRect))
+        ++chunk;
+      const int last = qMin(chunk * chunkSegmentsNumber, polyline.size() - 1);
+      painter->drawPolyline(points + first, last - first + 1);
+    }
+  }
+  if (showPoints) {
+    painter->setPen(pointPen);
+    painter->setBrush(pointBrush);
+    for (int chunk = 0; chunk < chunksNumber; ++chunk) {
+      if (!chunkRects[chunk].intersects(exposedRect))
+        continue;
+      // The last point of a chunk is drawn with the next chunk.
+      const int first = chunk * chunkSegmentsNumber;
+      const int end = chunk + 1 < chunksNumber ?
+            first + chunkSegmentsNumber : polyline.size();
+      for (int counter = first; counter < end; ++counter) {
+        const QPointF &point = points[counter];
+        painter->drawEllipse(QRectF(point.x() - pointSize / 2,
+                                    point.y() - pointSize / 2,
+                                    pointSize, pointSize));
+      }
+    }
+  }
+}
@@ -0,0 +1,58 @@
+#ifndef POLYLINEITEM_H
+#define POLYLINEITEM_H
+
+#include <QGraphicsItem>
+#include <QPolygonF>
+#include <QPen>
+#include <QBrush>
+#include <QVector>
+#include "dirtyregion.h"
+
+/// PolylineItem - this class draws polyline and its points as one item on
+/// QGraphicsScene. Item lives as long as the scene and only its points are
+/// replaced every frame, so scene doesn't have to allocate and index item for
+/// every segment and point. Only changed parts of polyline are repainted and
+/// only runs of segments within exposed part of the view are drawn.
+class PolylineItem : public QGraphicsItem {
+public:
+  PolylineItem(const QColor &lineColor, const QColor &pointColor,
+               QGraphicsItem *parent = 0);
+
+  /// setPolyline - replaces points of polyline. Points are copied into storage
+  /// of the item which is reused between calls. Boxes of changed segments are
+  /// updated, the whole item is updated only if most of it changed.
+  void setPolyline(const QPolygonF &points);
+
+  /// setShowLines - switches visibility of polyline segments.
+  void setShowLines(bool show);
+
+  /// setShowPoints - switches visibility of polyline points.
+  void setShowPoints(bool show);
+
+  QRectF boundingRect() const;
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+             QWidget *widget = 0);
+
+private:
+  /// updateChunkRects - finds boxes of runs of segments for painting.
+  void updateChunkRects();
+
+  QPolygonF polyline;
+  QRectF polylineRect;
+  // Bounding rect of the item, it may be larger than polyline, so that small
+  // changes don't change geometry of the item and repaint all of it.
+  QRectF itemRect;
+  // Boxes of runs of segments grown by size of points.
+  QVector<QRectF> chunkRects;
+  // Changed parts of the last polyline, kept between calls.
+  DirtyRegion dirtyRegion;
+
+  QPen linePen;
+  QPen pointPen;
+  QBrush pointBrush;
+
+  bool showLines;
+  bool showPoints;
+};
+
+#endif // POLYLINEITEM_H
@@ -0,0 +1,117 @@
+#include "qualitygovernor.h"
+#include <qmath.h>
+
+namespace {
+
+// Weight of a new frame in average frame time.
+const double averageWeight = 0.125;
+
+// Frames which are recorded after change of level before the next decision,
+// they show the cost of the new level.
+const int settleFrames = 4;
+
+// Quality is raised when average frame time is below this part of the target,
+// so that the better level most likely fits into the target too.
+const double fastFraction = 0.6;
+
+// Successive fast frames needed to raise quality. If raised level turns out to
+// be too slow, the number is doubled up to the maximum, so failed attempts
+// become rare.
+const int minImproveFrames = 30;
+const int maxImproveFrames = 480;
+
+} // namespace
+
+QualityGovernor::QualityGovernor() :
+  targetFrameTime(16000000), minTolerance(0.5), maxTolerance(100.5), level(0),
+  averageFrameTime(0.0), framesAtLevel(0), fastFrames(0), probing(false),
+  improveFrames(minImproveFrames) {}
+
+void QualityGovernor::SetTargetFrameTime(qint64 nanoseconds) {
+  targetFrameTime = nanoseconds;
+}
+
+// SetToleranceRange - tolerance of the best level and the largest tolerance.
+// Current level is kept if it still exists.
+void QualityGovernor::SetToleranceRange(double minTolerance,
+                                        double maxTolerance) {
+  this->minTolerance = minTolerance;
+  this->maxTolerance = qMax(minTolerance, maxTolerance);
+  level = qMin(level, LevelsNumber() - 1);
+}
+
+// AddFrame - records time of a frame, returns true if level was changed.
+bool QualityGovernor::AddFrame(qint64 nanoseconds) {
+  // Frames of the previous level don't tell anything about the current one.
+  if (framesAtLevel == 0)
+    averageFrameTime = nanoseconds;
+  else
+    averageFrameTime += (nanoseconds - averageFrameTime) * averageWeight;
+  ++framesAtLevel;
+  if (probing && framesAtLevel >= minImproveFrames) {
+    // Raised level holds.
+    probing = false;
+    improveFrames = minImproveFrames;
+  }
+  if (framesAtLevel < settleFrames)
+    return false;
+
+  if (averageFrameTime > targetFrameTime) {
+    fastFrames = 0;
+    if (level + 1 >= LevelsNumber())
+      return false;
+    if (probing)
+      improveFrames = qMin(2 * improveFrames, maxImproveFrames);
+    probing = false;
+    ++level;
+    framesAtLevel = 0;
+    return true;
+  }
+
+  if (averageFrameTime < fastFraction * targetFrameTime)
+    ++fastFrames;
+  else
+    fastFrames = 0;
+  if (fastFrames < improveFrames || level == 0)
+    return false;
+  probing = true;
+  --level;
+  framesAtLevel = 0;
+  fastFrames = 0;
+  return true;
+}
+
+// Reset - forgets recorded frames and returns to the best level.
+void QualityGovernor::Reset() {
+  level = 0;
+  averageFrameTime = 0.0;
+  framesAtLevel = 0;
+  fastFrames = 0;
+  probing = false;
+  improveFrames = minImproveFrames;
+}
+
+// DistanceTolerance - tolerance is doubled on every level up to the maximum.
+double QualityGovernor::DistanceTolerance() const {
+  const int toleranceLevel = qMin(level, ToleranceLevelsNumber() - 1);
+  return qMin(minTolerance * (1 << toleranceLevel), maxTolerance);
+}
+
+// PointsCulled - markers are culled on the last level.
+bool QualityGovernor::PointsCulled() const {
+  return level == LevelsNumber() - 1;
+}
+
+int QualityGovernor::LevelsNumber() const {
+  return ToleranceLevelsNumber() + 1;
+}
+
+// ToleranceLevelsNumber - levels from minTolerance to maxTolerance, the last
+// one may be less than twice as large as the previous one.
+int QualityGovernor::ToleranceLevelsNumber() const {
+  if (minTolerance <= 0.0)
+    return 1;
+  const double doublings = qLn(maxTolerance / minTolerance) / qLn(2.0);
+  // Tolerances which differ by rounding only are the same level.
+  return 1 + qMax(0, (int) qCeil(doublings - 1e-9));
+}
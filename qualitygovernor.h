@@ -0,0 +1,62 @@
+#ifndef QUALITYGOVERNOR_H
+#define QUALITYGOVERNOR_H
+
+#include <QtGlobal>
+
+// QualityGovernor - chooses distance tolerance of interpolation so that frames
+// fit into target time. Quality is a ladder of levels, tolerance is doubled on
+// every level above the best one and the last level also culls markers of
+// points. Governor steps down as soon as average frame time exceeds the target
+// and steps up only after a long run of frames well below it, so quality
+// doesn't oscillate around the target.
+class QualityGovernor {
+public:
+  QualityGovernor();
+
+  // SetTargetFrameTime - time of a frame in nanoseconds to keep.
+  void SetTargetFrameTime(qint64 nanoseconds);
+
+  // SetToleranceRange - tolerance of the best quality level and the largest
+  // tolerance which may be reached. Governor returns to the best level.
+  void SetToleranceRange(double minTolerance, double maxTolerance);
+
+  // AddFrame - records time of a frame in nanoseconds. Returns true if quality
+  // level was changed.
+  bool AddFrame(qint64 nanoseconds);
+
+  // Reset - forgets recorded frames and returns to the best level.
+  void Reset();
+
+  double DistanceTolerance() const;
+
+  // PointsCulled - true if markers of points should not be drawn.
+  bool PointsCulled() const;
+
+  // Level - 0 is the best quality, LevelsNumber() - 1 is the worst one.
+  int Level() const { return level; }
+  int LevelsNumber() const;
+
+private:
+  // ToleranceLevelsNumber - levels which differ in tolerance, the last level
+  // has the same tolerance and culls markers.
+  int ToleranceLevelsNumber() const;
+
+  qint64 targetFrameTime;
+  double minTolerance;
+  double maxTolerance;
+
+  int level;
+  // Exponential moving average of frame time in nanoseconds.
+  double averageFrameTime;
+  // Frames recorded since the last change of level.
+  int framesAtLevel;
+  // Successive frames with average well below the target.
+  int fastFrames;
+  // True while the level which was just raised is not proven to be fast
+  // enough.
+  bool probing;
+  // Successive fast frames needed to raise quality.
+  int improveFrames;
+};
+
+#endif // QUALITYGOVERNOR_H
@@ -0,0 +1,115 @@
+// Offline renderer of animated B-spline. Writes frames as numbered PNG images
+// without showing window, frames are rendered in parallel on all cores.
+//
+// Usage: BezierRender [--seed N] [--frames N] [--size WIDTHxHEIGHT]
+//                     [--antialiasing 0|1|2] [--points N] [--tolerance PIXELS]
+//                     [--speed X] [--threads N] [--output DIR] [--compact]
+//
+// Frame N shows the spline after N moves of control points, the same frames
+// are written for the same seed however many threads render them. --tolerance
+// is the largest distance in pixels between the curve and its chords, sqrt(0.5)
+// by default. With --compact the curve is kept in CompactPolyline and drawn
+// from it.
+
+#include "offlinerenderer.h"
+#include "workstealingpool.h"
+#include <QApplication>
+#include <QElapsedTimer>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+struct Options {
+  Options() : threadsNumber(0) {}
+
+  OfflineRenderer::Settings settings;
+  // Threads of pool, 0 means one per core.
+  int threadsNumber;
+};
+
+// ParseSize - parses size given as WIDTHxHEIGHT.
+bool ParseSize(const char *argument, QSize &size) {
+  int width = 0;
+  int height = 0;
+  if (std::sscanf(argument, "%dx%d", &width, &height) != 2 || width <= 0 ||
+      height <= 0)
+    return false;
+  size = QSize(width, height);
+  return true;
+}
+
+bool ParseOptions(int argc, char *argv[], Options &options) {
+  OfflineRenderer::Settings &settings = options.settings;
+  bool valid = true;
+  for (int counter = 1; counter < argc && valid; ++counter) {
+    const char *argument = argv[counter];
+    const bool hasValue = counter + 1 < argc;
+    if (std::strcmp(argument, "--seed") == 0 && hasValue) {
+      settings.seed = std::strtoul(argv[++counter], 0, 10);
+    } else if (std::strcmp(argument, "--frames") == 0 && hasValue) {
+      settings.framesNumber = std::strtol(argv[++counter], 0, 10);
+      valid = settings.framesNumber > 0;
+    } else if (std::strcmp(argument, "--size") == 0 && hasValue) {
+      valid = ParseSize(argv[++counter], settings.size);
+    } else if (std::strcmp(argument, "--antialiasing") == 0 && hasValue) {
+      settings.antialiasing = std::strtol(argv[++counter], 0, 10);
+      valid = settings.antialiasing >= 0 && settings.antialiasing <= 2;
+    } else if (std::strcmp(argument, "--points") == 0 && hasValue) {
+      settings.controlPointsNumber = std::strtol(argv[++counter], 0, 10);
+      valid = settings.controlPointsNumber >= 3;
+    } else if (std::strcmp(argument, "--tolerance") == 0 && hasValue) {
+      // Interpolator compares squared distances.
+      const double pixels = std::strtod(argv[++counter], 0);
+      settings.distanceTolerance = pixels * pixels;
+      valid = pixels > 0;
+    } else if (std::strcmp(argument, "--speed") == 0 && hasValue) {
+      settings.speedMultiplicator = std::strtod(argv[++counter], 0);
+      valid = settings.speedMultiplicator > 0;
+    } else if (std::strcmp(argument, "--threads") == 0 && hasValue) {
+      options.threadsNumber = std::strtol(argv[++counter], 0, 10);
+    } else if (std::strcmp(argument, "--output") == 0 && hasValue) {
+      settings.directory = QString::fromLocal8Bit(argv[++counter]);
+    } else if (std::strcmp(argument, "--compact") == 0) {
+      settings.compactPoints = true;
+    } else {
+      valid = false;
+    }
+  }
+  if (!valid)
+    std::fprintf(stderr, "Usage: %s [--seed N] [--frames N] "
+                 "[--size WIDTHxHEIGHT] [--antialiasing 0|1|2] [--points N] "
+                 "[--tolerance PIXELS] [--speed X] [--threads N] "
+                 "[--output DIR] [--compact]\n", argv[0]);
+  return valid;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  // Painting into images doesn't need window system.
+  QApplication application(argc, argv, false);
+  Options options;
+  if (!ParseOptions(argc, argv, options))
+    return 1;
+
+  OfflineRenderer renderer(options.settings);
+  WorkStealingPool pool(options.threadsNumber);
+  QElapsedTimer timer;
+  timer.start();
+  const int failures = renderer.Render(pool);
+  const qint64 elapsed = qMax(timer.elapsed(), (qint64) 1);
+
+  const int framesNumber = options.settings.framesNumber;
+  std::printf("%d frames in %lld ms (%.1f frames/s) on %d threads, "
+              "%d frames stolen\n", framesNumber, (long long) elapsed,
+              1000.0 * framesNumber / elapsed, pool.ThreadsNumber(),
+              pool.StolenTasksNumber());
+  if (failures > 0) {
+    std::fprintf(stderr, "%d frames could not be written to %s\n", failures,
+                 qPrintable(options.settings.directory));
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,298 @@
+#include "splinecache.h"
+#include <algorithm>
+
+namespace {
+
+// Replace - replaces items [begin, end) of \p items with \p replacement, the
+// tail is moved only if number of items is changed. Returns the change.
+template <typename T>
+int Replace(QVector<T> &items, int begin, int end,
+            const QVector<T> &replacement) {
+  const int delta = replacement.size() - (end - begin);
+  const int oldSize = items.size();
+  if (delta > 0) {
+    items.resize(oldSize + delta);
+    T *data = items.data();
+    std::copy_backward(data + end, data + oldSize, data + oldSize + delta);
+  } else if (delta < 0) {
+    T *data = items.data();
+    std::copy(data + end, data + oldSize, data + end + delta);
+    items.resize(oldSize + delta);
+  }
+  std::copy(replacement.constBegin(), replacement.constEnd(),
+            items.data() + begin);
+  return delta;
+}
+
+} // namespace
+
+SplineCache::SplineCache() : firstDirty(0), lastDirty(-1), invalid(true),
+  depthsKept(false), profiler(0) {}
+
+// Invalidate - marks all curves as dirty.
+void SplineCache::Invalidate() {
+  invalid = true;
+  depthsKept = false;
+}
+
+// ControlPointsMoved - marks all curves as dirty, but keeps their subdivision.
+void SplineCache::ControlPointsMoved() {
+  invalid = true;
+}
+
+// SetProfiler - time of boor net calculation and interpolation is recorded into
+// \p profiler if it is not 0.
+void SplineCache::SetProfiler(FrameProfiler *profiler) {
+  this->profiler = profiler;
+}
+
+void SplineCache::SetPool(WorkStealingPool *pool) {
+  parallelFlattener.SetPool(pool);
+}
+
+// ControlPointMoved - marks curves which depend on control point \p index as
+// dirty.
+void SplineCache::ControlPointMoved(int index) {
+  MarkDirty(index - 3, index);
+}
+
+// SetClipRect - curves which stay on the same side of the edge of the rectangle
+// are interpolated the same way, so only the rest is recalculated.
+bool SplineCache::SetClipRect(BezierInterpolator &bezierInterpolator,
+                              const QRectF &rect,
+                              const QPolygonF &boorNetPoints) {
+  const int curvesNumber = (boorNetPoints.size() - 1) / 3;
+  // Update() recalculates all curves anyway.
+  if (invalid || curvesNumber <= 0 || curveEnds.size() != curvesNumber ||
+      dirtyCurves.size() != curvesNumber) {
+    bezierInterpolator.SetClipRect(rect);
+    return true;
+  }
+  const QPointF *points = boorNetPoints.constData();
+  clippedCurves.resize(curvesNumber);
+  for (int counter = 0; counter < curvesNumber; ++counter)
+    clippedCurves[counter] =
+        bezierInterpolator.CurveOutside(points[3 * counter],
+                                        points[3 * counter + 1],
+                                        points[3 * counter + 2],
+                                        points[3 * counter + 3]);
+  bezierInterpolator.SetClipRect(rect);
+  bool marked = false;
+  for (int counter = 0; counter < curvesNumber; ++counter)
+    if (clippedCurves[counter] !=
+        bezierInterpolator.CurveOutside(points[3 * counter],
+                                        points[3 * counter + 1],
+                                        points[3 * counter + 2],
+                                        points[3 * counter + 3])) {
+      MarkDirty(counter, counter);
+      marked = true;
+    }
+  return marked;
+}
+
+// Update - recalculates dirty curves.
+void SplineCache::Update(const BezierInterpolator &bezierInterpolator,
+                         const ControlPointStore &controlPoints,
+                         const QVector<qreal> &knotVector,
+                         QPolygonF &boorNetPoints,
+                         QPolygonF &interpolatedPoints) {
+  const int curvesNumber =
+      BezierInterpolator::BezierCurvesNumber(controlPoints.Size());
+  // Small splines have no middle knots and are simply recalculated.
+  if (invalid || controlPoints.Size() <= 4 ||
+      curveEnds.size() != curvesNumber ||
+      boorNetPoints.size() !=
+      BezierInterpolator::BoorNetSize(controlPoints.Size())) {
+    Rebuild(bezierInterpolator, controlPoints, knotVector, boorNetPoints,
+            interpolatedPoints);
+    return;
+  }
+
+  const int firstCurve = qMax(firstDirty, 0);
+  const int lastCurve = qMin(lastDirty, curvesNumber - 1);
+  firstDirty = 0;
+  lastDirty = -1;
+  if (firstCurve <= lastCurve) {
+    {
+      StageTimer timer(profiler, FrameProfiler::BoorNetStage);
+      bezierInterpolator.CalculateBoorNet(controlPoints, knotVector,
+                                          boorNetPoints.data(), firstCurve,
+                                          lastCurve);
+    }
+
+    StageTimer timer(profiler, FrameProfiler::InterpolationStage);
+    // Interpolate dirty curves aside, points of clean ones between them are
+    // copied. If subdivision is kept, dirty curves start from their previous
+    // subdivision and replace it, so the next frame starts from it too.
+    const bool coherent = depthsKept && depthEnds.size() == curvesNumber;
+    curvePoints.resize(0);
+    curvePointsEnds.resize(0);
+    curveDepths.resize(0);
+    curveDepthsEnds.resize(0);
+    for (int counter = firstCurve; counter <= lastCurve; ++counter) {
+      const int depthsBegin = coherent && counter > 0 ?
+                              depthEnds[counter - 1] : 0;
+      const int depthsEnd = coherent ? depthEnds[counter] : 0;
+      if (dirtyCurves[counter]) {
+        const int first = 3 * counter;
+        if (coherent)
+          bezierInterpolator.InterpolateCurve(boorNetPoints[first],
+                                              boorNetPoints[first + 1],
+                                              boorNetPoints[first + 2],
+                                              boorNetPoints[first + 3],
+                                              depths.constData() + depthsBegin,
+                                              depthsEnd - depthsBegin,
+                                              curvePoints, curveDepths);
+        else
+          bezierInterpolator.InterpolateCurve(boorNetPoints[first],
+                                              boorNetPoints[first + 1],
+                                              boorNetPoints[first + 2],
+                                              boorNetPoints[first + 3],
+                                              curvePoints);
+        dirtyCurves[counter] = false;
+      } else {
+        const int curveBegin = counter == 0 ? 1 : curveEnds[counter - 1];
+        for (int index = curveBegin; index < curveEnds[counter]; ++index)
+          curvePoints.push_back(interpolatedPoints[index]);
+        for (int index = depthsBegin; index < depthsEnd; ++index)
+          curveDepths.push_back(depths[index]);
+      }
+      curvePointsEnds.push_back(curvePoints.size());
+      curveDepthsEnds.push_back(curveDepths.size());
+    }
+
+    // Replace old points of the curves.
+    const int begin = firstCurve == 0 ? 1 : curveEnds[firstCurve - 1];
+    const int delta = Replace<QPointF>(interpolatedPoints, begin,
+                                       curveEnds[lastCurve], curvePoints);
+    for (int counter = firstCurve; counter <= lastCurve; ++counter)
+      curveEnds[counter] = begin + curvePointsEnds[counter - firstCurve];
+    if (delta != 0)
+      for (int counter = lastCurve + 1; counter < curvesNumber; ++counter)
+        curveEnds[counter] += delta;
+
+    // Subdivision of the curves is replaced the same way.
+    if (coherent) {
+      const int depthsBegin = firstCurve == 0 ? 0 : depthEnds[firstCurve - 1];
+      const int depthsDelta = Replace<unsigned char>(depths, depthsBegin,
+                                                     depthEnds[lastCurve],
+                                                     curveDepths);
+      for (int counter = firstCurve; counter <= lastCurve; ++counter)
+        depthEnds[counter] = depthsBegin +
+                             curveDepthsEnds[counter - firstCurve];
+      if (depthsDelta != 0)
+        for (int counter = lastCurve + 1; counter < curvesNumber; ++counter)
+          depthEnds[counter] += depthsDelta;
+    }
+  }
+
+  // End points are taken from control points directly.
+  interpolatedPoints.first() = controlPoints.Point(0);
+  interpolatedPoints.last() = controlPoints.Point(controlPoints.Size() - 1);
+}
+
+// Rebuild - recalculates all curves.
+void SplineCache::Rebuild(const BezierInterpolator &bezierInterpolator,
+                          const ControlPointStore &controlPoints,
+                          const QVector<qreal> &knotVector,
+                          QPolygonF &boorNetPoints,
+                          QPolygonF &interpolatedPoints) {
+  invalid = false;
+  firstDirty = 0;
+  lastDirty = -1;
+  dirtyCurves.fill(false, BezierInterpolator::BezierCurvesNumber(
+                     controlPoints.Size()));
+
+  {
+    StageTimer timer(profiler, FrameProfiler::BoorNetStage);
+    boorNetPoints.resize(BezierInterpolator::BoorNetSize(controlPoints.Size()));
+    bezierInterpolator.CalculateBoorNet(controlPoints, knotVector,
+                                        boorNetPoints.data());
+  }
+
+  StageTimer timer(profiler, FrameProfiler::InterpolationStage);
+  // Unlike clear(), resize() keeps reserved storage.
+  interpolatedPoints.resize(0);
+
+  // Curves split between threads are interpolated faster by batches.
+  const int boorNetSize = boorNetPoints.size();
+  const int curvesNumber = (boorNetSize - 1) / 3;
+  if (bezierInterpolator.Engine() == BezierInterpolator::SubdivisionEngine &&
+      !parallelFlattener.SplitsCurves(curvesNumber)) {
+    RebuildCoherent(bezierInterpolator, controlPoints, boorNetPoints,
+                    interpolatedPoints);
+    return;
+  }
+  depthsKept = false;
+
+  // Batch interpolation takes coordinates in separate arrays.
+  boorNetX.resize(boorNetSize);
+  boorNetY.resize(boorNetSize);
+  for (int counter = 0; counter < boorNetSize; ++counter) {
+    boorNetX[counter] = boorNetPoints[counter].x();
+    boorNetY[counter] = boorNetPoints[counter].y();
+  }
+
+  curveEnds.resize(curvesNumber);
+  interpolatedPoints.push_back(controlPoints.Point(0));
+  parallelFlattener.InterpolateBezierBatch(bezierInterpolator,
+                                           boorNetX.constData(),
+                                           boorNetY.constData(), curvesNumber,
+                                           interpolatedPoints,
+                                           curveEnds.data());
+  interpolatedPoints.push_back(controlPoints.Point(controlPoints.Size() - 1));
+}
+
+// RebuildCoherent - interpolates all curves one by one from their previous
+// subdivision.
+void SplineCache::RebuildCoherent(const BezierInterpolator &bezierInterpolator,
+                                  const ControlPointStore &controlPoints,
+                                  const QPolygonF &boorNetPoints,
+                                  QPolygonF &interpolatedPoints) {
+  const int curvesNumber = (boorNetPoints.size() - 1) / 3;
+  // Subdivision of the last frame becomes the previous one.
+  const bool warm = depthsKept && depthEnds.size() == curvesNumber;
+  depths.swap(previousDepths);
+  depthEnds.swap(previousDepthEnds);
+  depths.resize(0);
+  depthEnds.resize(curvesNumber);
+  curveEnds.resize(curvesNumber);
+
+  interpolatedPoints.push_back(controlPoints.Point(0));
+  int previousBegin = 0;
+  for (int counter = 0; counter < curvesNumber; ++counter) {
+    const int first = 3 * counter;
+    const int previousEnd = warm ? previousDepthEnds[counter] : 0;
+    bezierInterpolator.InterpolateCurve(boorNetPoints[first],
+                                        boorNetPoints[first + 1],
+                                        boorNetPoints[first + 2],
+                                        boorNetPoints[first + 3],
+                                        previousDepths.constData() +
+                                        previousBegin,
+                                        previousEnd - previousBegin,
+                                        interpolatedPoints, depths);
+    previousBegin = previousEnd;
+    curveEnds[counter] = interpolatedPoints.size();
+    depthEnds[counter] = depths.size();
+  }
+  interpolatedPoints.push_back(controlPoints.Point(controlPoints.Size() - 1));
+  depthsKept = true;
+}
+
+// MarkDirty - curves out of range of the last update are ignored, the spline
+// is rebuilt if number of curves is changed.
+void SplineCache::MarkDirty(int firstCurve, int lastCurve) {
+  firstCurve = qMax(firstCurve, 0);
+  lastCurve = qMin(lastCurve, dirtyCurves.size() - 1);
+  if (firstCurve > lastCurve)
+    return;
+  for (int counter = firstCurve; counter <= lastCurve; ++counter)
+    dirtyCurves[counter] = true;
+  if (firstDirty > lastDirty) {
+    firstDirty = firstCurve;
+    lastDirty = lastCurve;
+  } else {
+    firstDirty = qMin(firstDirty, firstCurve);
+    lastDirty = qMax(lastDirty, lastCurve);
+  }
+}
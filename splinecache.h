@@ -0,0 +1,111 @@
+#ifndef SPLINECACHE_H
+#define SPLINECACHE_H
+
+#include <QPolygonF>
+#include <QVector>
+#include "bezierinterpolator.h"
+#include "frameprofiler.h"
+#include "parallelflattener.h"
+
+// SplineCache - keeps boor net and interpolated points of every Bezier curve of
+// B-spline between frames. Cubic B-spline control point i affects only Bezier
+// curves i-3..i, so after moving one control point only these curves are
+// recalculated and spliced into interpolated points. Likewise moving the clip
+// rectangle recalculates only curves which become clipped or visible.
+// When all control points move a little, e.g. in animation, adaptive
+// subdivision of every curve starts from its subdivision in the previous frame
+// instead of from the whole curve. Curves recalculated after moving one control
+// point start from their previous subdivision too and update it. Subdivision
+// is kept only for splines which the parallel flattener doesn't split between
+// threads, split splines are always subdivided from whole curves.
+class SplineCache {
+public:
+  SplineCache();
+
+  // Invalidate - marks all curves as dirty. Must be called when control points
+  // are added or removed, knots or interpolation parameters are changed.
+  void Invalidate();
+
+  // ControlPointsMoved - marks all curves as dirty after all control points
+  // are moved. Subdivision of curves is kept as start of the next one.
+  void ControlPointsMoved();
+
+  // SetProfiler - time of boor net calculation and interpolation is recorded
+  // into \p profiler if it is not 0.
+  void SetProfiler(FrameProfiler *profiler);
+
+  // SetPool - long splines are rebuilt on threads of \p pool, which is not
+  // owned. If it is 0 (the default), they are rebuilt on the calling thread.
+  void SetPool(WorkStealingPool *pool);
+
+  // ControlPointMoved - marks curves which depend on control point \p index as
+  // dirty.
+  void ControlPointMoved(int index);
+
+  // SetClipRect - sets clip rectangle of \p bezierInterpolator to \p rect and
+  // marks as dirty only curves of \p boorNetPoints which become clipped or stop
+  // being clipped. Returns true if any curve is marked.
+  bool SetClipRect(BezierInterpolator &bezierInterpolator, const QRectF &rect,
+                   const QPolygonF &boorNetPoints);
+
+  // Update - recalculates dirty curves. \p boorNetPoints and
+  // \p interpolatedPoints must be the same between calls. Interpolated points
+  // are the first control point, then points of every Bezier curve in order,
+  // then the last control point.
+  void Update(const BezierInterpolator &bezierInterpolator,
+              const ControlPointStore &controlPoints,
+              const QVector<qreal> &knotVector, QPolygonF &boorNetPoints,
+              QPolygonF &interpolatedPoints);
+
+private:
+  // MarkDirty - marks curves from \p firstCurve to \p lastCurve as dirty.
+  void MarkDirty(int firstCurve, int lastCurve);
+
+  // Rebuild - recalculates all curves.
+  void Rebuild(const BezierInterpolator &bezierInterpolator,
+               const ControlPointStore &controlPoints,
+               const QVector<qreal> &knotVector, QPolygonF &boorNetPoints,
+               QPolygonF &interpolatedPoints);
+
+  // RebuildCoherent - interpolates all curves one by one from their previous
+  // subdivision.
+  void RebuildCoherent(const BezierInterpolator &bezierInterpolator,
+                       const ControlPointStore &controlPoints,
+                       const QPolygonF &boorNetPoints,
+                       QPolygonF &interpolatedPoints);
+
+  // Index after the last interpolated point of every Bezier curve.
+  QVector<int> curveEnds;
+
+  // Levels of flat pieces of subdivision of all curves and index after the
+  // last piece of every curve, for the current and the previous frame.
+  QVector<unsigned char> depths;
+  QVector<int> depthEnds;
+  QVector<unsigned char> previousDepths;
+  QVector<int> previousDepthEnds;
+
+  // Whether each curve is dirty and range which holds all dirty curves, empty
+  // if firstDirty > lastDirty. Points of clean curves in the range are copied.
+  QVector<bool> dirtyCurves;
+  int firstDirty;
+  int lastDirty;
+  bool invalid;
+  // Whether depths can be the start of the next subdivision.
+  bool depthsKept;
+
+  FrameProfiler *profiler;
+
+  // Interpolates all curves on threads when the spline is rebuilt.
+  ParallelFlattener parallelFlattener;
+
+  // Buffers reused between updates.
+  QVector<double> boorNetX;
+  QVector<double> boorNetY;
+  QPolygonF curvePoints;
+  QVector<int> curvePointsEnds;
+  QVector<unsigned char> curveDepths;
+  QVector<int> curveDepthsEnds;
+  QVector<bool> clippedCurves;
+};
+
+#endif // SPLINECACHE_H
@@ -0,0 +1,1356 @@
+#ifndef SPLINECORE_H
+#define SPLINECORE_H
+
+// Core of B-spline interpolation without dependencies: de Boor algorithm which
+// transforms clamped cubic B-spline into composite Bezier curve and flattening
+// of Bezier curves by adaptive subdivision, forward differencing or with steps
+// that follow curvature. NURBS curves of other degrees and with weights are
+// decomposed into rational Bezier curves and flattened too. B-splines may be
+// also evaluated directly at given parameters. Calculations are
+// done in Scalar type (float or double), points of any type are read and
+// written through PointTraits, output goes into contiguous containers like
+// std::vector or QPolygonF.
+
+#include <cmath>
+#include <cassert>
+#include <vector>
+
+namespace bspline {
+
+// Point2 - default point type.
+template <typename T>
+struct Point2 {
+  typedef T Scalar;
+
+  T x;
+  T y;
+};
+
+// PointTraits - access to coordinates of point. Works for types with members
+// x and y and typedef Scalar, other types need specialization.
+template <typename Point>
+struct PointTraits {
+  typedef typename Point::Scalar Scalar;
+
+  static Scalar X(const Point &point) { return point.x; }
+  static Scalar Y(const Point &point) { return point.y; }
+  static Point Make(Scalar x, Scalar y) {
+    Point point;
+    point.x = x;
+    point.y = y;
+    return point;
+  }
+};
+
+// BoorNetSize - number of points in boor net of B-spline with
+// \p controlPointsNumber control points.
+inline int BoorNetSize(int controlPointsNumber) {
+  // Every middle knot adds two points.
+  if (controlPointsNumber <= 4)
+    return controlPointsNumber;
+  return 3 * controlPointsNumber - 8;
+}
+
+// BezierCurvesNumber - number of Bezier curves in composite curve of B-spline
+// with \p controlPointsNumber control points.
+inline int BezierCurvesNumber(int controlPointsNumber) {
+  return (BoorNetSize(controlPointsNumber) - 1) / 3;
+}
+
+// FillUniformKnotVector - fills \p knotVector with clamped knots of B-spline of
+// \p degree with \p controlPointsNumber control points: the first and the last
+// knots are repeated degree + 1 times, interior knots are evenly spaced.
+// Knots is a container with clear() and push_back(), e.g. QVector<qreal>.
+template <typename Knots>
+void FillUniformKnotVector(int degree, int controlPointsNumber,
+                           Knots &knotVector) {
+  const int middleKnotNumber = controlPointsNumber - degree - 1;
+  knotVector.clear();
+  for (int counter = 0; counter <= degree; ++counter)
+    knotVector.push_back(0.0);
+  for (int counter = 1; counter <= middleKnotNumber; ++counter)
+    knotVector.push_back(1.0 / (middleKnotNumber + 1) * counter);
+  for (int counter = 0; counter <= degree; ++counter)
+    knotVector.push_back(1.0);
+}
+
+namespace detail {
+
+// Combine - (1 - coeff) * first + coeff * second.
+template <typename Scalar, typename Point>
+inline Point Combine(const Point &first, const Point &second, Scalar coeff) {
+  typedef PointTraits<Point> Traits;
+  return Traits::Make((1 - coeff) * Traits::X(first) +
+                      coeff * Traits::X(second),
+                      (1 - coeff) * Traits::Y(first) +
+                      coeff * Traits::Y(second));
+}
+
+// RightHandle - point of boor net which follows the end point of Bezier curve
+// at middle knot \p knotCounter.
+template <typename Scalar, typename Point, typename ControlPoints>
+inline Point RightHandle(const ControlPoints &controlPoints,
+                         const Scalar *knotVector, int knotCounter) {
+  const Scalar knot = knotVector[knotCounter];
+  const Scalar prevKnot = knotVector[knotCounter - 1];
+  Scalar rightCoeff = (knot - prevKnot) /
+      (knotVector[knotCounter + 2] - prevKnot);
+  return Combine<Scalar, Point>(controlPoints[knotCounter - 2],
+                                controlPoints[knotCounter - 1], rightCoeff);
+}
+
+// CubicPolynomial - Bezier curve in power basis:
+// B(t) = a * t^3 + b * t^2 + c * t + d.
+template <typename Scalar>
+struct CubicPolynomial {
+  template <typename Point>
+  CubicPolynomial(const Point &p1, const Point &p2, const Point &p3,
+                  const Point &p4) {
+    typedef PointTraits<Point> Traits;
+    ax = Traits::X(p4) - Traits::X(p1) + 3 * (Traits::X(p2) - Traits::X(p3));
+    ay = Traits::Y(p4) - Traits::Y(p1) + 3 * (Traits::Y(p2) - Traits::Y(p3));
+    bx = 3 * (Traits::X(p1) - 2 * Traits::X(p2) + Traits::X(p3));
+    by = 3 * (Traits::Y(p1) - 2 * Traits::Y(p2) + Traits::Y(p3));
+    cx = 3 * (Traits::X(p2) - Traits::X(p1));
+    cy = 3 * (Traits::Y(p2) - Traits::Y(p1));
+    dx = Traits::X(p1);
+    dy = Traits::Y(p1);
+  }
+
+  Scalar X(Scalar t) const { return ((ax * t + bx) * t + cx) * t + dx; }
+  Scalar Y(Scalar t) const { return ((ay * t + by) * t + cy) * t + dy; }
+
+  Scalar ax, ay, bx, by, cx, cy, dx, dy;
+};
+
+// SegmentsNumber - rounds estimated number of segments \p n up, there is at
+// least one segment. Infinite or NaN estimate gives the maximum.
+template <typename Scalar>
+inline int SegmentsNumber(Scalar n) {
+  const int maxSegments = 1 << 16;
+  if (!(n < maxSegments))
+    return maxSegments;
+  return n > 1 ? (int) std::ceil(n) : 1;
+}
+
+// WangSegments - number of equal parameter steps after which polyline deviates
+// from the curve by at most \p tolerance. Wang's formula:
+// n = sqrt(3 * 2 / 8 * M / tolerance), where M is maximum length of second
+// differences of control points.
+template <typename Scalar, typename Point>
+int WangSegments(const Point &p1, const Point &p2, const Point &p3,
+                 const Point &p4, Scalar tolerance) {
+  typedef PointTraits<Point> Traits;
+  Scalar dd1x = Traits::X(p1) - 2 * Traits::X(p2) + Traits::X(p3);
+  Scalar dd1y = Traits::Y(p1) - 2 * Traits::Y(p2) + Traits::Y(p3);
+  Scalar dd2x = Traits::X(p2) - 2 * Traits::X(p3) + Traits::X(p4);
+  Scalar dd2y = Traits::Y(p2) - 2 * Traits::Y(p3) + Traits::Y(p4);
+  Scalar dd1 = dd1x * dd1x + dd1y * dd1y;
+  Scalar dd2 = dd2x * dd2x + dd2y * dd2y;
+  Scalar m = std::sqrt(dd1 > dd2 ? dd1 : dd2);
+  return SegmentsNumber<Scalar>(std::sqrt(Scalar(0.75) * m / tolerance));
+}
+
+} // namespace detail
+
+// CalculateBoorNet - inserts new control points with de Boor algorithm for
+// transformation of clamped cubic B-spline with simple middle knots into
+// composite Bezier curve. Calculates only points of Bezier curves from
+// \p firstCurve to \p lastCurve inclusive, i.e. boorNetPoints[3 * firstCurve]
+// ... boorNetPoints[3 * lastCurve + 3], other points are not touched. Curve i
+// depends on control points i..i+3 only. \p controlPoints[i] must give
+// control point i.
+template <typename Scalar, typename Point, typename ControlPoints>
+void CalculateBoorNet(const ControlPoints &controlPoints, int pointsNumber,
+                      const Scalar *knotVector, Point *boorNetPoints,
+                      int firstCurve, int lastCurve) {
+  assert(pointsNumber > 2);
+  if (pointsNumber <= 4) {
+    // There are no middle knots.
+    for (int counter = 0; counter < pointsNumber; ++counter)
+      boorNetPoints[counter] = controlPoints[counter];
+    return;
+  }
+  const int curvesNumber = BezierCurvesNumber(pointsNumber);
+  assert(firstCurve >= 0 && lastCurve < curvesNumber);
+  const int firstPoint = 3 * firstCurve;
+  const int lastPoint = 3 * lastCurve + 3;
+
+  if (firstCurve == 0) {
+    boorNetPoints[0] = controlPoints[0];
+    boorNetPoints[1] = controlPoints[1];
+  }
+
+  // Inserting knot t[k] twice touches only control points k-3..k-1. Point k-3
+  // is the right handle of previous Bezier curve (or P[1] for the first one),
+  // the other two are still original, so the net is built from left to right
+  // with one point of state. Knot k adds points 3k-10..3k-8 of the net, the
+  // first knot of the range also gives the first point of the first curve.
+  const int firstKnot = firstCurve + 3 > 4 ? firstCurve + 3 : 4;
+  const int lastKnot = lastCurve + 4 < pointsNumber - 1 ?
+        lastCurve + 4 : pointsNumber - 1;
+  Point leftPoint = firstKnot == 4 ?
+        Point(controlPoints[1]) :
+        detail::RightHandle<Scalar, Point>(controlPoints, knotVector,
+                                           firstKnot - 1);
+  for (int knotCounter = firstKnot; knotCounter <= lastKnot; ++knotCounter) {
+    const Scalar knot = knotVector[knotCounter];
+    const Scalar prevKnot = knotVector[knotCounter - 1];
+
+    Scalar coeff = (knot - prevKnot) / (knotVector[knotCounter + 1] - prevKnot);
+    Point leftHandle = detail::Combine<Scalar, Point>(
+          leftPoint, controlPoints[knotCounter - 2], coeff);
+    Point rightHandle = detail::RightHandle<Scalar, Point>(
+          controlPoints, knotVector, knotCounter);
+
+    int boorCounter = 3 * knotCounter - 10;
+    if (boorCounter >= firstPoint)
+      boorNetPoints[boorCounter] = leftHandle;
+    ++boorCounter;
+    if (boorCounter >= firstPoint && boorCounter <= lastPoint)
+      boorNetPoints[boorCounter] = detail::Combine<Scalar, Point>(
+            leftHandle, rightHandle, coeff);
+    ++boorCounter;
+    if (boorCounter <= lastPoint)
+      boorNetPoints[boorCounter] = rightHandle;
+    leftPoint = rightHandle;
+  }
+
+  // Last two control points are not changed by insertion.
+  if (lastCurve == curvesNumber - 1) {
+    boorNetPoints[lastPoint - 1] = controlPoints[pointsNumber - 2];
+    boorNetPoints[lastPoint] = controlPoints[pointsNumber - 1];
+  }
+}
+
+// CurveOutside - whether Bezier curve lies outside of rectangle from
+// (\p left, \p top) to (\p right, \p bottom). Curve is inside of convex hull
+// of its control points, so it is outside if all of them are beyond the same
+// side of the rectangle.
+template <typename Scalar, typename Point>
+bool CurveOutside(const Point &p1, const Point &p2, const Point &p3,
+                  const Point &p4, Scalar left, Scalar top, Scalar right,
+                  Scalar bottom) {
+  typedef PointTraits<Point> Traits;
+  const Scalar x1 = Traits::X(p1), x2 = Traits::X(p2);
+  const Scalar x3 = Traits::X(p3), x4 = Traits::X(p4);
+  const Scalar y1 = Traits::Y(p1), y2 = Traits::Y(p2);
+  const Scalar y3 = Traits::Y(p3), y4 = Traits::Y(p4);
+  return (x1 < left && x2 < left && x3 < left && x4 < left) ||
+      (x1 > right && x2 > right && x3 > right && x4 > right) ||
+      (y1 < top && y2 < top && y3 < top && y4 < top) ||
+      (y1 > bottom && y2 > bottom && y3 > bottom && y4 > bottom);
+}
+
+// CalculateBoorNet - calculates all BoorNetSize() points of boor net.
+template <typename Scalar, typename Point, typename ControlPoints>
+void CalculateBoorNet(const ControlPoints &controlPoints, int pointsNumber,
+                      const Scalar *knotVector, Point *boorNetPoints) {
+  CalculateBoorNet(controlPoints, pointsNumber, knotVector, boorNetPoints, 0,
+                   BezierCurvesNumber(pointsNumber) - 1);
+}
+
+// FlatteningPolicy - conditions which stop subdivision of Bezier curve.
+// Conditions that are not in policy are not compiled into flattener, so
+// DistanceFlattening has neither trigonometry nor their branches.
+enum FlatteningPolicy {
+  // Curve is flat if its control points are close to the chord.
+  DistanceFlattening,
+  // Besides, angles between segments of control polygon are small.
+  AngleFlattening,
+  // Besides, sharp corners are cut at control points.
+  CuspFlattening
+};
+
+// BezierFlattener - interpolates Bezier curves with polylines.
+// Algorithm is based on article "Adaptive Subdivision of Bezier Curves" by
+// Maxim Shemanarev.
+// http://www.antigrain.com/research/adaptive_bezier/index.html
+// Output is a container of points with push_back(), size(), capacity() and
+// reserve().
+template <typename Scalar, typename Point = Point2<Scalar>,
+          FlatteningPolicy policy = DistanceFlattening>
+class BezierFlattener {
+public:
+  BezierFlattener() : distanceTolerance(Scalar(0.5)),
+                      angleTolerance(Scalar(0.0)), cuspLimit(Scalar(0.0)),
+                      maxSubdivisionLevel(0) {}
+
+  // Flatten - appends points of the curve except the first one to \p output.
+  template <typename Output>
+  void Flatten(Scalar x1, Scalar y1, Scalar x2, Scalar y2, Scalar x3,
+               Scalar y3, Scalar x4, Scalar y4, Output &output,
+               unsigned level = 0) const;
+
+  // FlattenIterative - the same as Flatten but uses explicit stack instead of
+  // recursion and reserves storage for the points of the curve before
+  // appending them. Produces exactly the same points.
+  template <typename Output>
+  void FlattenIterative(const Point &p1, const Point &p2, const Point &p3,
+                        const Point &p4, Output &output) const;
+
+  // FlattenCoherent - the same as FlattenIterative, but starts from the
+  // subdivision of the curve in the previous frame, which is given by levels
+  // of its flat pieces in order, \p previousDepths. Inner nodes of the
+  // previous subdivision are not tested. Its pieces which are not flat any more
+  // are subdivided further, and two sibling pieces are merged if their parent
+  // became flat. Levels of flat pieces of this subdivision are appended to
+  // \p depths, which is a container of unsigned char with push_back(). Every
+  // point passes the same flatness test as in Flatten, but subdivision may stay
+  // deeper than of Flatten for some frames, as it is coarsened by one level per
+  // frame. Empty \p previousDepths give the same points as FlattenIterative.
+  template <typename Output, typename Depths>
+  void FlattenCoherent(const Point &p1, const Point &p2, const Point &p3,
+                       const Point &p4, const unsigned char *previousDepths,
+                       int previousDepthsNumber, Output &output,
+                       Depths &depths) const;
+
+  // AppendIfFlat - checks whether curve can be approximated with a straight
+  // line. If so, appends approximating points to \p output and returns true.
+  // (x1234, y1234) is the middle point of the curve.
+  template <typename Output>
+  bool AppendIfFlat(Scalar x1, Scalar y1, Scalar x2, Scalar y2, Scalar x3,
+                    Scalar y3, Scalar x4, Scalar y4, Scalar x1234,
+                    Scalar y1234, Output &output) const;
+
+  // EstimatePoints - approximate number of points appended by Flatten for
+  // given curve. Based on Wang's formula for number of uniform subdivisions.
+  int EstimatePoints(const Point &p1, const Point &p2, const Point &p3,
+                     const Point &p4) const;
+
+  void SetDistanceTolerance(Scalar value) { distanceTolerance = value; }
+  Scalar DistanceTolerance() const { return distanceTolerance; }
+
+  // SetAngleTolerance - angle in radians, values below AngleToleranceEpsilon()
+  // turn angle condition off. Ignored by DistanceFlattening.
+  void SetAngleTolerance(Scalar value) { angleTolerance = value; }
+  Scalar AngleTolerance() const { return angleTolerance; }
+
+  // SetCuspLimit - angle in radians, 0 turns cusp condition off. Used only by
+  // CuspFlattening.
+  void SetCuspLimit(Scalar value) { cuspLimit = value; }
+  Scalar CuspLimit() const { return cuspLimit; }
+
+  // ChecksAngles - whether subdivision is stopped by angle condition too.
+  bool ChecksAngles() const {
+    return policy != DistanceFlattening &&
+        angleTolerance >= AngleToleranceEpsilon();
+  }
+
+  // MaxSubdivisionLevel - the deepest level of subdivision reached since the
+  // last ResetMaxSubdivisionLevel().
+  unsigned MaxSubdivisionLevel() const { return maxSubdivisionLevel; }
+  void ResetMaxSubdivisionLevel() { maxSubdivisionLevel = 0; }
+  // ReachSubdivisionLevel - records level reached by other engines.
+  void ReachSubdivisionLevel(unsigned level) const {
+    if (level > maxSubdivisionLevel)
+      maxSubdivisionLevel = level;
+  }
+
+  // Casteljau algorithm (interpolating Bezier curve) parameters.
+  static const unsigned curveRecursionLimit = 32;
+  static Scalar CollinearityEpsilon() { return Scalar(1e-30); }
+  static Scalar AngleToleranceEpsilon() { return Scalar(0.01); }
+
+private:
+  typedef PointTraits<Point> Traits;
+
+  // Piece - piece of curve at \p level of subdivision.
+  struct Piece {
+    Scalar x1, y1, x2, y2, x3, y3, x4, y4;
+    unsigned level;
+  };
+
+  // NoDepths - levels of flat pieces which are not kept.
+  struct NoDepths {
+    void push_back(unsigned char) {}
+  };
+
+  // FlattenPiece - subdivides \p piece like FlattenIterative, levels of flat
+  // pieces are appended to \p depths.
+  template <typename Output, typename Depths>
+  void FlattenPiece(const Piece &piece, Output &output, Depths &depths) const;
+
+  Scalar distanceTolerance;
+  Scalar angleTolerance;
+  Scalar cuspLimit;
+
+  // Statistics which are collected by const flattening functions.
+  mutable unsigned maxSubdivisionLevel;
+};
+
+template <typename Scalar, typename Point, FlatteningPolicy policy>
+const unsigned BezierFlattener<Scalar, Point, policy>::curveRecursionLimit;
+
+template <typename Scalar, typename Point, FlatteningPolicy policy>
+template <typename Output>
+void BezierFlattener<Scalar, Point, policy>::Flatten(Scalar x1, Scalar y1,
+                                                     Scalar x2, Scalar y2,
+                                                     Scalar x3, Scalar y3,
+                                                     Scalar x4, Scalar y4,
+                                                     Output &output,
+                                                     unsigned level) const {
+  if(level > maxSubdivisionLevel)
+    maxSubdivisionLevel = level;
+  if(level > curveRecursionLimit) {
+    return;
+  }
+
+  // Calculate all the mid-points of the line segments
+  Scalar x12   = (x1 + x2) / 2;
+  Scalar y12   = (y1 + y2) / 2;
+  Scalar x23   = (x2 + x3) / 2;
+  Scalar y23   = (y2 + y3) / 2;
+  Scalar x34   = (x3 + x4) / 2;
+  Scalar y34   = (y3 + y4) / 2;
+  Scalar x123  = (x12 + x23) / 2;
+  Scalar y123  = (y12 + y23) / 2;
+  Scalar x234  = (x23 + x34) / 2;
+  Scalar y234  = (y23 + y34) / 2;
+  Scalar x1234 = (x123 + x234) / 2;
+  Scalar y1234 = (y123 + y234) / 2;
+
+  // Enforce subdivision first time
+  if(level > 0 && AppendIfFlat(x1, y1, x2, y2, x3, y3, x4, y4, x1234, y1234,
+                               output)) {
+    return;
+  }
+
+  // Continue subdivision
+  Flatten(x1, y1, x12, y12, x123, y123, x1234, y1234, output, level + 1);
+  Flatten(x1234, y1234, x234, y234, x34, y34, x4, y4, output, level + 1);
+}
+
+template <typename Scalar, typename Point, FlatteningPolicy policy>
+template <typename Output>
+bool BezierFlattener<Scalar, Point, policy>::AppendIfFlat(
+    Scalar x1, Scalar y1, Scalar x2, Scalar y2, Scalar x3, Scalar y3,
+    Scalar x4, Scalar y4, Scalar x1234, Scalar y1234, Output &output) const {
+  const Scalar pi = Scalar(3.14159265358979323846);
+  const Scalar collinearityEpsilon = CollinearityEpsilon();
+  // Both are constant false for policies without these conditions, so the
+  // compiler drops code below them.
+  const bool checkAngles = ChecksAngles();
+  const bool checkCusps = policy == CuspFlattening && cuspLimit != 0.0;
+
+  // Try to approximate the full cubic curve by a single straight line
+  Scalar dx = x4-x1;
+  Scalar dy = y4-y1;
+
+  Scalar d2 = std::fabs(((x2 - x4) * dy - (y2 - y4) * dx));
+  Scalar d3 = std::fabs(((x3 - x4) * dy - (y3 - y4) * dx));
+
+  Scalar da1, da2;
+
+  if(d2 > collinearityEpsilon && d3 > collinearityEpsilon) {
+    // Regular care
+    if((d2 + d3)*(d2 + d3) <= distanceTolerance * (dx*dx + dy*dy)) {
+      // If the curvature doesn't exceed the distance_tolerance value
+      // we tend to finish subdivisions.
+      if(!checkAngles) {
+        output.push_back(Traits::Make(x1234, y1234));
+        return true;
+      }
+
+      // Angle & Cusp Condition
+      Scalar a23 = std::atan2(y3 - y2, x3 - x2);
+      da1 = std::fabs(a23 - std::atan2(y2 - y1, x2 - x1));
+      da2 = std::fabs(std::atan2(y4 - y3, x4 - x3) - a23);
+      if(da1 >= pi) da1 = 2*pi - da1;
+      if(da2 >= pi) da2 = 2*pi - da2;
+
+      if(da1 + da2 < angleTolerance) {
+        // Finally we can stop the recursion
+        output.push_back(Traits::Make(x1234, y1234));
+        return true;
+      }
+
+      if(checkCusps) {
+        if(da1 > cuspLimit) {
+          output.push_back(Traits::Make(x2, y2));
+          return true;
+        }
+
+        if(da2 > cuspLimit) {
+          output.push_back(Traits::Make(x3, y3));
+          return true;
+        }
+      }
+    }
+  } else {
+    if(d2 > collinearityEpsilon) {
+      // p1,p3,p4 are collinear, p2 is considerable
+      if(d2 * d2 <= distanceTolerance * (dx*dx + dy*dy)) {
+        if(!checkAngles) {
+          output.push_back(Traits::Make(x1234, y1234));
+          return true;
+        }
+
+        // Angle Condition
+        da1 = std::fabs(std::atan2(y3 - y2, x3 - x2) -
+                        std::atan2(y2 - y1, x2 - x1));
+        if(da1 >= pi)
+          da1 = 2*pi - da1;
+
+        if(da1 < angleTolerance) {
+          output.push_back(Traits::Make(x2, y2));
+          output.push_back(Traits::Make(x3, y3));
+          return true;
+        }
+
+        if(checkCusps) {
+          if(da1 > cuspLimit) {
+            output.push_back(Traits::Make(x2, y2));
+            return true;
+          }
+        }
+      }
+    } else if(d3 > collinearityEpsilon) {
+      // p1,p2,p4 are collinear, p3 is considerable
+      if(d3 * d3 <= distanceTolerance * (dx*dx + dy*dy)) {
+        if(!checkAngles) {
+          output.push_back(Traits::Make(x1234, y1234));
+          return true;
+        }
+
+        // Angle Condition
+        da1 = std::fabs(std::atan2(y4 - y3, x4 - x3) -
+                        std::atan2(y3 - y2, x3 - x2));
+        if(da1 >= pi) da1 = 2*pi - da1;
+
+        if(da1 < angleTolerance) {
+          output.push_back(Traits::Make(x2, y2));
+          output.push_back(Traits::Make(x3, y3));
+          return true;
+        }
+
+        if(checkCusps) {
+          if(da1 > cuspLimit) {
+            output.push_back(Traits::Make(x3, y3));
+            return true;
+          }
+        }
+      }
+    } else {
+      // Collinear case
+      dx = x1234 - (x1 + x4) / 2;
+      dy = y1234 - (y1 + y4) / 2;
+      if(dx*dx + dy*dy <= distanceTolerance) {
+        output.push_back(Traits::Make(x1234, y1234));
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+template <typename Scalar, typename Point, FlatteningPolicy policy>
+template <typename Output>
+void BezierFlattener<Scalar, Point, policy>::FlattenIterative(
+    const Point &p1, const Point &p2, const Point &p3, const Point &p4,
+    Output &output) const {
+  // Grow storage geometrically, so reserving for every curve stays amortized.
+  const int size = (int) output.size();
+  const int capacity = (int) output.capacity();
+  const int expectedSize = size + EstimatePoints(p1, p2, p3, p4);
+  if (expectedSize > capacity)
+    output.reserve(expectedSize > 2 * capacity ? expectedSize : 2 * capacity);
+
+  const Piece curve = { Traits::X(p1), Traits::Y(p1), Traits::X(p2),
+                        Traits::Y(p2), Traits::X(p3), Traits::Y(p3),
+                        Traits::X(p4), Traits::Y(p4), 0 };
+  NoDepths depths;
+  FlattenPiece(curve, output, depths);
+}
+
+template <typename Scalar, typename Point, FlatteningPolicy policy>
+template <typename Output, typename Depths>
+void BezierFlattener<Scalar, Point, policy>::FlattenPiece(
+    const Piece &piece, Output &output, Depths &depths) const {
+  // Left half is processed right away and only right half waits on the stack,
+  // so there is at most one pending curve for every level of subdivision.
+  Piece stack[curveRecursionLimit + 1];
+  int stackSize = 0;
+  Piece curve = piece;
+  unsigned maxLevel = maxSubdivisionLevel;
+  for (;;) {
+    if (curve.level > maxLevel)
+      maxLevel = curve.level;
+    if (curve.level <= curveRecursionLimit) {
+      // Calculate all the mid-points of the line segments
+      Scalar x12   = (curve.x1 + curve.x2) / 2;
+      Scalar y12   = (curve.y1 + curve.y2) / 2;
+      Scalar x23   = (curve.x2 + curve.x3) / 2;
+      Scalar y23   = (curve.y2 + curve.y3) / 2;
+      Scalar x34   = (curve.x3 + curve.x4) / 2;
+      Scalar y34   = (curve.y3 + curve.y4) / 2;
+      Scalar x123  = (x12 + x23) / 2;
+      Scalar y123  = (y12 + y23) / 2;
+      Scalar x234  = (x23 + x34) / 2;
+      Scalar y234  = (y23 + y34) / 2;
+      Scalar x1234 = (x123 + x234) / 2;
+      Scalar y1234 = (y123 + y234) / 2;
+
+      // Enforce subdivision first time
+      if (curve.level == 0 ||
+          !AppendIfFlat(curve.x1, curve.y1, curve.x2, curve.y2, curve.x3,
+                        curve.y3, curve.x4, curve.y4, x1234, y1234, output)) {
+        // Continue subdivision
+        assert(stackSize <= (int) curveRecursionLimit);
+        Piece right = { x1234, y1234, x234, y234, x34, y34, curve.x4,
+                        curve.y4, curve.level + 1 };
+        stack[stackSize++] = right;
+        Piece left = { curve.x1, curve.y1, x12, y12, x123, y123, x1234, y1234,
+                       curve.level + 1 };
+        curve = left;
+        continue;
+      }
+    }
+    // Flat piece, or piece below recursion limit which gives no points.
+    depths.push_back((unsigned char) curve.level);
+
+    if (stackSize == 0)
+      break;
+    curve = stack[--stackSize];
+  }
+  maxSubdivisionLevel = maxLevel;
+}
+
+template <typename Scalar, typename Point, FlatteningPolicy policy>
+template <typename Output, typename Depths>
+void BezierFlattener<Scalar, Point, policy>::FlattenCoherent(
+    const Point &p1, const Point &p2, const Point &p3, const Point &p4,
+    const unsigned char *previousDepths, int previousDepthsNumber,
+    Output &output, Depths &depths) const {
+  // Every piece gives a point or two, so the previous subdivision is a good
+  // estimate.
+  const int size = (int) output.size();
+  const int capacity = (int) output.capacity();
+  const int expectedSize = size + (previousDepthsNumber > 0 ?
+      previousDepthsNumber : EstimatePoints(p1, p2, p3, p4));
+  if (expectedSize > capacity)
+    output.reserve(expectedSize > 2 * capacity ? expectedSize : 2 * capacity);
+
+  Piece stack[curveRecursionLimit + 1];
+  int stackSize = 0;
+  Piece curve = { Traits::X(p1), Traits::Y(p1), Traits::X(p2), Traits::Y(p2),
+                  Traits::X(p3), Traits::Y(p3), Traits::X(p4), Traits::Y(p4),
+                  0 };
+  // Index of the previous piece which lies at start of the curve.
+  int next = 0;
+  unsigned maxLevel = 0;
+  for (;;) {
+    if (next == previousDepthsNumber || previousDepths[next] < curve.level ||
+        curve.level > curveRecursionLimit) {
+      // Depths which don't describe a subdivision are not followed.
+      FlattenPiece(curve, output, depths);
+    } else {
+      // Calculate all the mid-points of the line segments
+      Scalar x12   = (curve.x1 + curve.x2) / 2;
+      Scalar y12   = (curve.y1 + curve.y2) / 2;
+      Scalar x23   = (curve.x2 + curve.x3) / 2;
+      Scalar y23   = (curve.y2 + curve.y3) / 2;
+      Scalar x34   = (curve.x3 + curve.x4) / 2;
+      Scalar y34   = (curve.y3 + curve.y4) / 2;
+      Scalar x123  = (x12 + x23) / 2;
+      Scalar y123  = (y12 + y23) / 2;
+      Scalar x234  = (x23 + x34) / 2;
+      Scalar y234  = (y23 + y34) / 2;
+      Scalar x1234 = (x123 + x234) / 2;
+      Scalar y1234 = (y123 + y234) / 2;
+
+      // Previous pieces and parents of two previous pieces are tested, other
+      // inner nodes of the previous subdivision are not.
+      const bool previousPiece = previousDepths[next] == curve.level;
+      const bool parent = !previousPiece && curve.level > 0 &&
+          previousDepths[next] == curve.level + 1 &&
+          next + 1 < previousDepthsNumber &&
+          previousDepths[next + 1] == curve.level + 1;
+      // Enforce subdivision first time
+      const bool flat = (previousPiece || parent) && curve.level > 0 &&
+          AppendIfFlat(curve.x1, curve.y1, curve.x2, curve.y2, curve.x3,
+                       curve.y3, curve.x4, curve.y4, x1234, y1234, output);
+      if (flat) {
+        // Parent replaces its pieces.
+        next += previousPiece ? 1 : 2;
+        depths.push_back((unsigned char) curve.level);
+        if (curve.level > maxLevel)
+          maxLevel = curve.level;
+      } else if (previousPiece) {
+        // Previous piece which isn't flat any more is refined.
+        ++next;
+        const Piece left = { curve.x1, curve.y1, x12, y12, x123, y123, x1234,
+                             y1234, curve.level + 1 };
+        const Piece right = { x1234, y1234, x234, y234, x34, y34, curve.x4,
+                              curve.y4, curve.level + 1 };
+        FlattenPiece(left, output, depths);
+        FlattenPiece(right, output, depths);
+      } else {
+        // Continue subdivision
+        assert(stackSize <= (int) curveRecursionLimit);
+        Piece right = { x1234, y1234, x234, y234, x34, y34, curve.x4,
+                        curve.y4, curve.level + 1 };
+        stack[stackSize++] = right;
+        Piece left = { curve.x1, curve.y1, x12, y12, x123, y123, x1234, y1234,
+                       curve.level + 1 };
+        curve = left;
+        continue;
+      }
+    }
+
+    if (stackSize == 0)
+      break;
+    curve = stack[--stackSize];
+  }
+  ReachSubdivisionLevel(maxLevel);
+}
+
+template <typename Scalar, typename Point, FlatteningPolicy policy>
+int BezierFlattener<Scalar, Point, policy>::EstimatePoints(
+    const Point &p1, const Point &p2, const Point &p3, const Point &p4) const {
+  // Curve is always subdivided at least once.
+  const int minPoints = 2;
+  if (distanceTolerance <= 0)
+    return minPoints;
+
+  // DistanceTolerance is compared with squared distances, so its root is the
+  // tolerance.
+  int points = detail::WangSegments(p1, p2, p3, p4,
+                                    std::sqrt(distanceTolerance));
+  return points > minPoints ? points : minPoints;
+}
+
+// ForwardDifferencingFlattener - interpolates Bezier curves with polylines of
+// equal parameter steps. Number of steps is known before interpolation, it is
+// taken from Wang's formula, i.e. from bound on second differences of control
+// polygon. Points are evaluated with forward differences: three additions per
+// coordinate and no branches.
+template <typename Scalar, typename Point = Point2<Scalar> >
+class ForwardDifferencingFlattener {
+public:
+  ForwardDifferencingFlattener() : distanceTolerance(Scalar(0.5)) {}
+
+  // PointsNumber - number of points appended by Flatten for given curve.
+  int PointsNumber(const Point &p1, const Point &p2, const Point &p3,
+                   const Point &p4) const {
+    return detail::WangSegments(p1, p2, p3, p4, std::sqrt(distanceTolerance));
+  }
+
+  // Evaluate - writes \p pointsNumber points of the curve except the first one
+  // into \p points, the last one is \p p4.
+  void Evaluate(const Point &p1, const Point &p2, const Point &p3,
+                const Point &p4, int pointsNumber, Point *points) const;
+
+  // Flatten - appends PointsNumber() points of the curve except the first one
+  // to \p output. Output is a container with size(), resize() and operator[].
+  template <typename Output>
+  void Flatten(const Point &p1, const Point &p2, const Point &p3,
+               const Point &p4, Output &output) const {
+    const int size = (int) output.size();
+    const int pointsNumber = PointsNumber(p1, p2, p3, p4);
+    output.resize(size + pointsNumber);
+    Evaluate(p1, p2, p3, p4, pointsNumber, &output[size]);
+  }
+
+  // SetDistanceTolerance - the same value as for BezierFlattener, i.e. square
+  // of allowed distance between polyline and the curve.
+  void SetDistanceTolerance(Scalar value) { distanceTolerance = value; }
+  Scalar DistanceTolerance() const { return distanceTolerance; }
+
+private:
+  typedef PointTraits<Point> Traits;
+
+  Scalar distanceTolerance;
+};
+
+template <typename Scalar, typename Point>
+void ForwardDifferencingFlattener<Scalar, Point>::Evaluate(
+    const Point &p1, const Point &p2, const Point &p3, const Point &p4,
+    int pointsNumber, Point *points) const {
+  const detail::CubicPolynomial<Scalar> curve(p1, p2, p3, p4);
+  const Scalar h = Scalar(1) / pointsNumber;
+  const Scalar h2 = h * h;
+  const Scalar h3 = h2 * h;
+
+  // Differences of the first three orders at t = 0, the third one is constant.
+  Scalar x = curve.dx;
+  Scalar y = curve.dy;
+  Scalar dx = curve.ax * h3 + curve.bx * h2 + curve.cx * h;
+  Scalar dy = curve.ay * h3 + curve.by * h2 + curve.cy * h;
+  Scalar ddx = 6 * curve.ax * h3 + 2 * curve.bx * h2;
+  Scalar ddy = 6 * curve.ay * h3 + 2 * curve.by * h2;
+  const Scalar dddx = 6 * curve.ax * h3;
+  const Scalar dddy = 6 * curve.ay * h3;
+  for (int counter = 0; counter < pointsNumber - 1; ++counter) {
+    x += dx;
+    y += dy;
+    dx += ddx;
+    dy += ddy;
+    ddx += dddx;
+    ddy += dddy;
+    points[counter] = Traits::Make(x, y);
+  }
+  // Rounding errors are accumulated by differences, so the end is exact.
+  points[pointsNumber - 1] = p4;
+}
+
+// CurvatureFlattener - interpolates Bezier curves with polylines whose
+// segments are shorter where the curve bends more. Segment of length L on arc
+// of curvature k deviates from it by about k * L^2 / 8 (parabola
+// approximation), so number of segments is the integral of
+// sqrt(k / (8 * tolerance)) along the curve. Curvature changes inside of
+// segments, so deviation is taken twice as large: sqrt(k / (4 * tolerance)).
+// The integral is calculated in advance on samplesNumber intervals of
+// parameter, then points are evaluated directly at parameters which split the
+// integral evenly. Usually gives fewer points than the other methods, but, like
+// subdivision, may cut narrow loops and cusps.
+template <typename Scalar, typename Point = Point2<Scalar> >
+class CurvatureFlattener {
+public:
+  enum { samplesNumber = 16 };
+
+  CurvatureFlattener() : distanceTolerance(Scalar(0.5)) {}
+
+  // PointsNumber - number of points appended by Flatten for given curve.
+  int PointsNumber(const Point &p1, const Point &p2, const Point &p3,
+                   const Point &p4) const {
+    Scalar integral[samplesNumber + 1];
+    return Integrate(detail::CubicPolynomial<Scalar>(p1, p2, p3, p4),
+                     integral);
+  }
+
+  // Evaluate - writes \p pointsNumber points of the curve except the first one
+  // into \p points, the last one is \p p4.
+  void Evaluate(const Point &p1, const Point &p2, const Point &p3,
+                const Point &p4, int pointsNumber, Point *points) const {
+    const detail::CubicPolynomial<Scalar> curve(p1, p2, p3, p4);
+    Scalar integral[samplesNumber + 1];
+    Integrate(curve, integral);
+    Evaluate(curve, integral, p4, pointsNumber, points);
+  }
+
+  // Flatten - appends PointsNumber() points of the curve except the first one
+  // to \p output. Output is a container with size(), resize() and operator[].
+  template <typename Output>
+  void Flatten(const Point &p1, const Point &p2, const Point &p3,
+               const Point &p4, Output &output) const {
+    const detail::CubicPolynomial<Scalar> curve(p1, p2, p3, p4);
+    Scalar integral[samplesNumber + 1];
+    const int size = (int) output.size();
+    const int pointsNumber = Integrate(curve, integral);
+    output.resize(size + pointsNumber);
+    Evaluate(curve, integral, p4, pointsNumber, &output[size]);
+  }
+
+  // SetDistanceTolerance - the same value as for BezierFlattener, i.e. square
+  // of allowed distance between polyline and the curve.
+  void SetDistanceTolerance(Scalar value) { distanceTolerance = value; }
+  Scalar DistanceTolerance() const { return distanceTolerance; }
+
+private:
+  typedef PointTraits<Point> Traits;
+
+  // Integrate - fills \p integral with integral of sqrt(k) along the curve
+  // from 0 to i / samplesNumber and returns number of segments.
+  int Integrate(const detail::CubicPolynomial<Scalar> &curve,
+                Scalar *integral) const;
+
+  void Evaluate(const detail::CubicPolynomial<Scalar> &curve,
+                const Scalar *integral, const Point &p4, int pointsNumber,
+                Point *points) const;
+
+  Scalar distanceTolerance;
+};
+
+template <typename Scalar, typename Point>
+int CurvatureFlattener<Scalar, Point>::Integrate(
+    const detail::CubicPolynomial<Scalar> &curve, Scalar *integral) const {
+  // sqrt(k) ds = sqrt(|B' x B''| / |B'|^3) |B'| dt = sqrt(|B' x B''| / |B'|) dt
+  const Scalar step = Scalar(1) / samplesNumber;
+  integral[0] = 0;
+  for (int counter = 0; counter < samplesNumber; ++counter) {
+    // Midpoint rule.
+    const Scalar t = (counter + Scalar(0.5)) * step;
+    const Scalar d1x = (3 * curve.ax * t + 2 * curve.bx) * t + curve.cx;
+    const Scalar d1y = (3 * curve.ay * t + 2 * curve.by) * t + curve.cy;
+    const Scalar d2x = 6 * curve.ax * t + 2 * curve.bx;
+    const Scalar d2y = 6 * curve.ay * t + 2 * curve.by;
+    const Scalar speed = std::sqrt(d1x * d1x + d1y * d1y);
+    const Scalar cross = std::fabs(d1x * d2y - d1y * d2x);
+    const Scalar value = speed > 0 ? std::sqrt(cross / speed) : Scalar(0);
+    integral[counter + 1] = integral[counter] + value * step;
+  }
+  // DistanceTolerance is compared with squared distances.
+  const Scalar tolerance = std::sqrt(distanceTolerance);
+  return detail::SegmentsNumber<Scalar>(integral[samplesNumber] /
+                                        std::sqrt(4 * tolerance));
+}
+
+template <typename Scalar, typename Point>
+void CurvatureFlattener<Scalar, Point>::Evaluate(
+    const detail::CubicPolynomial<Scalar> &curve, const Scalar *integral,
+    const Point &p4, int pointsNumber, Point *points) const {
+  const Scalar step = integral[samplesNumber] / pointsNumber;
+  int sample = 0;
+  for (int counter = 1; counter < pointsNumber; ++counter) {
+    // Integral is linear inside of sample interval.
+    const Scalar target = step * counter;
+    while (sample < samplesNumber - 1 && integral[sample + 1] < target)
+      ++sample;
+    const Scalar width = integral[sample + 1] - integral[sample];
+    const Scalar fraction = width > 0 ? (target - integral[sample]) / width :
+                                        Scalar(0);
+    const Scalar t = (sample + fraction) / samplesNumber;
+    points[counter - 1] = Traits::Make(curve.X(t), curve.Y(t));
+  }
+  points[pointsNumber - 1] = p4;
+}
+
+// Maximum degree of NURBS curves and rational Bezier curves.
+enum { maxNurbsDegree = 7 };
+
+// HomogeneousPoint - point of rational curve with weight w. Coordinates are
+// multiplied by weight, so rational curve is a polynomial one in (x, y, w).
+template <typename Scalar>
+struct HomogeneousPoint {
+  Scalar x;
+  Scalar y;
+  Scalar w;
+};
+
+// MakeHomogeneous - point (\p x, \p y) with weight \p w.
+template <typename Scalar>
+inline HomogeneousPoint<Scalar> MakeHomogeneous(Scalar x, Scalar y, Scalar w) {
+  HomogeneousPoint<Scalar> point = { x * w, y * w, w };
+  return point;
+}
+
+// NurbsBezierPointsNumber - maximum number of points of rational Bezier curves
+// given by DecomposeNurbs() for NURBS curve of \p degree with
+// \p controlPointsNumber control points.
+inline int NurbsBezierPointsNumber(int degree, int controlPointsNumber) {
+  // Every non-empty knot span gives a curve.
+  return degree * (controlPointsNumber - degree) + 1;
+}
+
+namespace detail {
+
+// Lerp - \p coeff * first + (1 - \p coeff) * second.
+template <typename Scalar>
+inline HomogeneousPoint<Scalar> Lerp(const HomogeneousPoint<Scalar> &first,
+                                     const HomogeneousPoint<Scalar> &second,
+                                     Scalar coeff) {
+  HomogeneousPoint<Scalar> point = {
+    coeff * first.x + (1 - coeff) * second.x,
+    coeff * first.y + (1 - coeff) * second.y,
+    coeff * first.w + (1 - coeff) * second.w
+  };
+  return point;
+}
+
+} // namespace detail
+
+// DecomposeNurbs - converts NURBS curve of \p degree into rational Bezier
+// curves of the same degree. Every interior knot is raised to multiplicity
+// \p degree and all insertions of one knot are done in one pass, so the whole
+// refinement takes O(n * degree^2) (Piegl, Tiller "The NURBS Book",
+// algorithm A5.6). \p knotVector has controlPointsNumber + degree + 1 knots,
+// it must be clamped, i.e. the first and the last knots have multiplicity
+// degree + 1, interior knots have multiplicity at most \p degree. Bezier curve
+// i is written into bezierPoints[degree * i] ... bezierPoints[degree * i +
+// degree], neighbour curves share end points, so there must be room for
+// NurbsBezierPointsNumber() points. Returns number of Bezier curves.
+template <typename Scalar>
+int DecomposeNurbs(int degree, const Scalar *knotVector,
+                   int controlPointsNumber,
+                   const HomogeneousPoint<Scalar> *controlPoints,
+                   HomogeneousPoint<Scalar> *bezierPoints) {
+  assert(degree >= 1 && degree <= maxNurbsDegree);
+  assert(controlPointsNumber > degree);
+  // Index of the last knot.
+  const int lastKnot = controlPointsNumber + degree;
+  Scalar alphas[maxNurbsDegree];
+
+  HomogeneousPoint<Scalar> *curve = bezierPoints;
+  for (int counter = 0; counter <= degree; ++counter)
+    curve[counter] = controlPoints[counter];
+  int curvesNumber = 0;
+  // The current curve spans knots from knotVector[left] to knotVector[right].
+  int left = degree;
+  int right = degree + 1;
+  while (right < lastKnot) {
+    const int firstEqual = right;
+    while (right < lastKnot && knotVector[right + 1] == knotVector[right])
+      ++right;
+    const int multiplicity = right - firstEqual + 1;
+    assert(multiplicity <= degree || right == lastKnot);
+    HomogeneousPoint<Scalar> *next = curve + degree;
+
+    if (multiplicity < degree) {
+      // Insert knotVector[right] degree - multiplicity times at once.
+      const Scalar knot = knotVector[right] - knotVector[left];
+      for (int counter = degree; counter > multiplicity; --counter)
+        alphas[counter - multiplicity - 1] =
+            knot / (knotVector[left + counter] - knotVector[left]);
+      const int insertionsNumber = degree - multiplicity;
+      for (int insertion = 1; insertion <= insertionsNumber; ++insertion) {
+        const int first = multiplicity + insertion;
+        for (int counter = degree; counter >= first; --counter)
+          curve[counter] = detail::Lerp(curve[counter], curve[counter - 1],
+                                        alphas[counter - first]);
+        // Points of the next curve are known as soon as they are computed.
+        if (right < lastKnot)
+          next[insertionsNumber - insertion] = curve[degree];
+      }
+    }
+
+    ++curvesNumber;
+    if (right < lastKnot) {
+      // The rest of the next curve is not touched by insertion yet.
+      for (int counter = degree - multiplicity; counter <= degree; ++counter)
+        next[counter] = controlPoints[right - degree + counter];
+      curve = next;
+      left = right;
+      ++right;
+    }
+  }
+  return curvesNumber;
+}
+
+// RationalBezierFlattener - interpolates rational Bezier curves of any degree
+// up to maxNurbsDegree with polylines. Curve is subdivided in halves with de
+// Casteljau algorithm in homogeneous coordinates until its control points are
+// within tolerance from its chord. Weights must be positive, then curve is
+// inside of convex hull of its control points and the polyline is within
+// tolerance from the curve.
+template <typename Scalar, typename Point = Point2<Scalar> >
+class RationalBezierFlattener {
+public:
+  RationalBezierFlattener() : distanceTolerance(Scalar(0.5)) {}
+
+  // Flatten - appends points of the curve with control points \p points[0]
+  // ... \p points[degree] except the first one to \p output. The last
+  // appended point is the end of the curve.
+  template <typename Output>
+  void Flatten(const HomogeneousPoint<Scalar> *points, int degree,
+               Output &output) const;
+
+  // SetDistanceTolerance - the same value as for BezierFlattener, i.e. square
+  // of allowed distance between polyline and the curve.
+  void SetDistanceTolerance(Scalar value) { distanceTolerance = value; }
+  Scalar DistanceTolerance() const { return distanceTolerance; }
+
+  static const unsigned curveRecursionLimit = 32;
+
+private:
+  typedef PointTraits<Point> Traits;
+
+  // IsFlat - whether all control points are within tolerance from the chord.
+  bool IsFlat(const HomogeneousPoint<Scalar> *points, int degree) const;
+
+  Scalar distanceTolerance;
+};
+
+template <typename Scalar, typename Point>
+const unsigned RationalBezierFlattener<Scalar, Point>::curveRecursionLimit;
+
+template <typename Scalar, typename Point>
+template <typename Output>
+void RationalBezierFlattener<Scalar, Point>::Flatten(
+    const HomogeneousPoint<Scalar> *points, int degree, Output &output) const {
+  assert(degree >= 1 && degree <= maxNurbsDegree);
+  struct Curve {
+    HomogeneousPoint<Scalar> points[maxNurbsDegree + 1];
+    unsigned level;
+  };
+
+  // Left half is processed right away and only right half waits on the stack,
+  // so there is at most one pending curve for every level of subdivision.
+  Curve stack[curveRecursionLimit];
+  int stackSize = 0;
+  Curve curve;
+  for (int counter = 0; counter <= degree; ++counter)
+    curve.points[counter] = points[counter];
+  curve.level = 0;
+  for (;;) {
+    if (curve.level < curveRecursionLimit && !IsFlat(curve.points, degree)) {
+      // De Casteljau algorithm at t = 0.5 in place: the left half is left in
+      // curve, the right half is the last point of every step.
+      Curve &right = stack[stackSize++];
+      HomogeneousPoint<Scalar> *left = curve.points;
+      for (int step = 1; step <= degree; ++step) {
+        right.points[degree - step + 1] = left[degree];
+        for (int counter = degree; counter >= step; --counter)
+          left[counter] = detail::Lerp(left[counter - 1], left[counter],
+                                       Scalar(0.5));
+      }
+      right.points[0] = left[degree];
+      right.level = ++curve.level;
+      continue;
+    }
+
+    const HomogeneousPoint<Scalar> &end = curve.points[degree];
+    output.push_back(Traits::Make(end.x / end.w, end.y / end.w));
+    if (stackSize == 0)
+      break;
+    curve = stack[--stackSize];
+  }
+}
+
+template <typename Scalar, typename Point>
+bool RationalBezierFlattener<Scalar, Point>::IsFlat(
+    const HomogeneousPoint<Scalar> *points, int degree) const {
+  const Scalar x1 = points[0].x / points[0].w;
+  const Scalar y1 = points[0].y / points[0].w;
+  const Scalar dx = points[degree].x / points[degree].w - x1;
+  const Scalar dy = points[degree].y / points[degree].w - y1;
+  const Scalar length = dx * dx + dy * dy;
+  for (int counter = 1; counter < degree; ++counter) {
+    const Scalar px = points[counter].x / points[counter].w - x1;
+    const Scalar py = points[counter].y / points[counter].w - y1;
+    // Distance to the chord, not to its line: curve may run beyond the ends
+    // of the chord.
+    Scalar t = length > 0 ? (px * dx + py * dy) / length : Scalar(0);
+    t = t < 0 ? Scalar(0) : (t > 1 ? Scalar(1) : t);
+    const Scalar ex = px - t * dx;
+    const Scalar ey = py - t * dy;
+    if (ex * ex + ey * ey > distanceTolerance)
+      return false;
+  }
+  return true;
+}
+
+namespace detail {
+
+// ToHomogeneous - point with weight 1, type of point is deduced.
+template <typename Scalar, typename Point>
+inline HomogeneousPoint<Scalar> ToHomogeneous(const Point &point) {
+  typedef PointTraits<Point> Traits;
+  HomogeneousPoint<Scalar> result = { Traits::X(point), Traits::Y(point), 1 };
+  return result;
+}
+
+} // namespace detail
+
+// SplineEvaluator - evaluates non-rational B-spline of degree from 1 to
+// maxNurbsDegree with clamped knot vector at given parameters. Prepare()
+// converts every knot span into polynomial in power basis, then Evaluate()
+// needs only Horner scheme per sample. Samples of one span are evaluated in
+// a loop without branches, which compiler vectorizes.
+template <typename Scalar>
+class SplineEvaluator {
+public:
+  SplineEvaluator() : degree(0), spansNumber(0) {}
+
+  // Prepare - builds tables for spline of \p degree with \p pointsNumber
+  // control points and pointsNumber + degree + 1 knots. \p controlPoints[i]
+  // must give control point i. Storage is kept between calls.
+  template <typename ControlPoints>
+  void Prepare(int degree, const Scalar *knotVector,
+               const ControlPoints &controlPoints, int pointsNumber);
+
+  int SpansNumber() const { return spansNumber; }
+
+  // Evaluate - writes points of the spline at \p parameters into \p x and
+  // \p y. Parameters must be sorted in nondecreasing order, parameters outside
+  // of the domain of the spline extrapolate its first or last span.
+  void Evaluate(const Scalar *parameters, int samplesNumber, Scalar *x,
+                Scalar *y) const {
+    Dispatch<0>(parameters, samplesNumber, x, y, 0, 0, 0, 0);
+  }
+
+  // Evaluate - the same and first derivatives with respect to parameter.
+  void Evaluate(const Scalar *parameters, int samplesNumber, Scalar *x,
+                Scalar *y, Scalar *dx, Scalar *dy) const {
+    Dispatch<1>(parameters, samplesNumber, x, y, dx, dy, 0, 0);
+  }
+
+  // Evaluate - the same and first and second derivatives.
+  void Evaluate(const Scalar *parameters, int samplesNumber, Scalar *x,
+                Scalar *y, Scalar *dx, Scalar *dy, Scalar *ddx,
+                Scalar *ddy) const {
+    Dispatch<2>(parameters, samplesNumber, x, y, dx, dy, ddx, ddy);
+  }
+
+private:
+  // Dispatch - calls EvaluateRuns() for degree of the spline, so loops over
+  // coefficients are unrolled.
+  template <int order>
+  void Dispatch(const Scalar *parameters, int samplesNumber, Scalar *x,
+                Scalar *y, Scalar *dx, Scalar *dy, Scalar *ddx,
+                Scalar *ddy) const;
+
+  // EvaluateRuns - evaluates runs of samples in the same span and derivatives
+  // up to \p order.
+  template <int degree, int order>
+  void EvaluateRuns(const Scalar *parameters, int samplesNumber, Scalar *x,
+                    Scalar *y, Scalar *dx, Scalar *dy, Scalar *ddx,
+                    Scalar *ddy) const;
+
+  int degree;
+  int spansNumber;
+  // Buffers of Prepare().
+  std::vector<HomogeneousPoint<Scalar> > homogeneousPoints;
+  std::vector<HomogeneousPoint<Scalar> > bezierPoints;
+  // Span i is from spanKnots[i] to spanKnots[i + 1], spanScales[i] is inverse
+  // of its length. Polynomial of span i in local parameter from 0 to 1 has
+  // coefficients of x in coefficients[2 * (degree + 1) * i] ... and of y
+  // after them, from the lowest power.
+  std::vector<Scalar> spanKnots;
+  std::vector<Scalar> spanScales;
+  std::vector<Scalar> coefficients;
+};
+
+template <typename Scalar>
+template <typename ControlPoints>
+void SplineEvaluator<Scalar>::Prepare(int degree, const Scalar *knotVector,
+                                      const ControlPoints &controlPoints,
+                                      int pointsNumber) {
+  assert(degree >= 1 && degree <= maxNurbsDegree);
+  assert(pointsNumber > degree);
+  this->degree = degree;
+  homogeneousPoints.resize(pointsNumber);
+  for (int counter = 0; counter < pointsNumber; ++counter)
+    homogeneousPoints[counter] =
+        detail::ToHomogeneous<Scalar>(controlPoints[counter]);
+  bezierPoints.resize(NurbsBezierPointsNumber(degree, pointsNumber));
+  spansNumber = DecomposeNurbs(degree, knotVector, pointsNumber,
+                               &homogeneousPoints[0], &bezierPoints[0]);
+
+  // Spans of Bezier curves are the non-empty knot spans.
+  spanKnots.resize(spansNumber + 1);
+  spanScales.resize(spansNumber);
+  spanKnots[0] = knotVector[degree];
+  int span = 0;
+  for (int counter = degree + 1; counter <= pointsNumber; ++counter)
+    if (knotVector[counter] != spanKnots[span]) {
+      spanKnots[++span] = knotVector[counter];
+      spanScales[span - 1] = 1 / (spanKnots[span] - spanKnots[span - 1]);
+    }
+  assert(span == spansNumber);
+
+  // Bezier curve b0 ... bp in power basis: coefficient of s^j is
+  // C(p, j) * sum of (-1)^(j - k) * C(j, k) * bk over k from 0 to j.
+  const int stride = 2 * (degree + 1);
+  coefficients.resize(stride * spansNumber);
+  Scalar binomials[maxNurbsDegree + 1][maxNurbsDegree + 1];
+  for (int n = 0; n <= degree; ++n) {
+    binomials[n][0] = binomials[n][n] = 1;
+    for (int k = 1; k < n; ++k)
+      binomials[n][k] = binomials[n - 1][k - 1] + binomials[n - 1][k];
+  }
+  for (int span = 0; span < spansNumber; ++span) {
+    const HomogeneousPoint<Scalar> *points = &bezierPoints[degree * span];
+    Scalar *xCoefficients = &coefficients[stride * span];
+    Scalar *yCoefficients = xCoefficients + degree + 1;
+    for (int j = 0; j <= degree; ++j) {
+      Scalar xSum = 0;
+      Scalar ySum = 0;
+      for (int k = 0; k <= j; ++k) {
+        const Scalar coeff = (j - k) % 2 ? -binomials[j][k] : binomials[j][k];
+        xSum += coeff * points[k].x;
+        ySum += coeff * points[k].y;
+      }
+      xCoefficients[j] = binomials[degree][j] * xSum;
+      yCoefficients[j] = binomials[degree][j] * ySum;
+    }
+  }
+}
+
+template <typename Scalar>
+template <int order>
+void SplineEvaluator<Scalar>::Dispatch(const Scalar *parameters,
+                                       int samplesNumber, Scalar *x, Scalar *y,
+                                       Scalar *dx, Scalar *dy, Scalar *ddx,
+                                       Scalar *ddy) const {
+  switch (degree) {
+    case 1:
+      EvaluateRuns<1, order>(parameters, samplesNumber, x, y, dx, dy, ddx, ddy);
+      break;
+    case 2:
+      EvaluateRuns<2, order>(parameters, samplesNumber, x, y, dx, dy, ddx, ddy);
+      break;
+    case 3:
+      EvaluateRuns<3, order>(parameters, samplesNumber, x, y, dx, dy, ddx, ddy);
+      break;
+    case 4:
+      EvaluateRuns<4, order>(parameters, samplesNumber, x, y, dx, dy, ddx, ddy);
+      break;
+    case 5:
+      EvaluateRuns<5, order>(parameters, samplesNumber, x, y, dx, dy, ddx, ddy);
+      break;
+    case 6:
+      EvaluateRuns<6, order>(parameters, samplesNumber, x, y, dx, dy, ddx, ddy);
+      break;
+    case 7:
+      EvaluateRuns<7, order>(parameters, samplesNumber, x, y, dx, dy, ddx, ddy);
+      break;
+    default:
+      // Prepare() was not called.
+      assert(false);
+  }
+}
+
+template <typename Scalar>
+template <int degree, int order>
+void SplineEvaluator<Scalar>::EvaluateRuns(const Scalar *parameters,
+                                           int samplesNumber, Scalar *x,
+                                           Scalar *y, Scalar *dx, Scalar *dy,
+                                           Scalar *ddx, Scalar *ddy) const {
+  const int stride = 2 * (degree + 1);
+  int span = 0;
+  int sample = 0;
+  while (sample < samplesNumber) {
+    // Parameters are sorted, so spans are found by one pass.
+    while (span + 1 < spansNumber && parameters[sample] >= spanKnots[span + 1])
+      ++span;
+    int runEnd = samplesNumber;
+    if (span + 1 < spansNumber) {
+      runEnd = sample + 1;
+      while (runEnd < samplesNumber && parameters[runEnd] < spanKnots[span + 1])
+        ++runEnd;
+    }
+
+    const Scalar *cx = &coefficients[stride * span];
+    const Scalar *cy = cx + degree + 1;
+    const Scalar start = spanKnots[span];
+    const Scalar scale = spanScales[span];
+    for (int counter = sample; counter < runEnd; ++counter) {
+      const Scalar s = (parameters[counter] - start) * scale;
+      Scalar px = cx[degree];
+      Scalar py = cy[degree];
+      for (int power = degree - 1; power >= 0; --power) {
+        px = px * s + cx[power];
+        py = py * s + cy[power];
+      }
+      x[counter] = px;
+      y[counter] = py;
+      if (order >= 1) {
+        Scalar dpx = degree * cx[degree];
+        Scalar dpy = degree * cy[degree];
+        for (int power = degree - 1; power >= 1; --power) {
+          dpx = dpx * s + power * cx[power];
+          dpy = dpy * s + power * cy[power];
+        }
+        dx[counter] = dpx * scale;
+        dy[counter] = dpy * scale;
+      }
+      if (order >= 2) {
+        Scalar ddpx = 0;
+        Scalar ddpy = 0;
+        for (int power = degree; power >= 2; --power) {
+          ddpx = ddpx * s + power * (power - 1) * cx[power];
+          ddpy = ddpy * s + power * (power - 1) * cy[power];
+        }
+        ddx[counter] = ddpx * scale * scale;
+        ddy[counter] = ddpy * scale * scale;
+      }
+    }
+    sample = runEnd;
+  }
+}
+
+} // namespace bspline
+
+#endif // SPLINECORE_H
@@ -0,0 +1,282 @@
+#include "splineengine.h"
+#include <algorithm>
+
+namespace {
+
+// Every thread gets several tasks, so that threads which are done earlier
+// steal the rest.
+const int tasksPerThread = 4;
+
+// Tasks are not smaller than this number of Bezier curves, short splines are
+// grouped until they reach it.
+const int minTaskCost = 256;
+
+// SplineCost - work of updating spline with \p controlPointsNumber control
+// points: its Bezier curves and fixed cost of the spline itself.
+inline int SplineCost(int controlPointsNumber) {
+  return qMax(BezierInterpolator::BezierCurvesNumber(controlPointsNumber), 0) +
+         1;
+}
+
+// CostGreater - orders indices of splines from the longest one.
+struct CostGreater {
+  explicit CostGreater(const QVector<int> &costs) : costs(costs) {}
+
+  bool operator()(int first, int second) const {
+    return costs[first] > costs[second];
+  }
+
+  const QVector<int> &costs;
+};
+
+} // namespace
+
+// Spline - control points and results of one spline.
+struct SplineEngine::Spline {
+  ControlPointStore controlPoints;
+  QVector<qreal> knotVector;
+  QPolygonF boorNetPoints;
+  QPolygonF interpolatedPoints;
+  CompactPolyline compactPoints;
+};
+
+// Scratch - buffers and interpolator of one thread.
+struct SplineEngine::Scratch {
+  BezierInterpolator interpolator;
+  QVector<double> boorNetX;
+  QVector<double> boorNetY;
+};
+
+// BatchTask - updates range [begin, end) of splines ordered by cost.
+class SplineEngine::BatchTask : public WorkStealingPool::Task {
+public:
+  BatchTask(SplineEngine *engine, int begin, int end) :
+    engine(engine), begin(begin), end(end) {}
+
+  void Run() {
+    // Direct calls run on the calling thread with the first buffers.
+    Scratch &scratch = *engine->scratches[qMax(ThreadIndex(), 0)];
+    for (int counter = begin; counter < end; ++counter)
+      engine->UpdateSpline(*engine->splines[engine->order[counter]], scratch);
+  }
+
+private:
+  SplineEngine *engine;
+  int begin;
+  int end;
+};
+
+SplineEngine::SplineEngine() :
+  compactOutput(false),
+  compactFormat(CompactPolyline::DeltaFormat), pool(0), scheduled(false) {}
+
+SplineEngine::~SplineEngine() {
+  Clear();
+  for (int counter = 0; counter < scratches.size(); ++counter)
+    delete scratches[counter];
+}
+
+// SetPool - splines are rescheduled for threads of the pool on the next
+// Update().
+void SplineEngine::SetPool(WorkStealingPool *value) {
+  pool = value;
+  scheduled = false;
+}
+
+BezierInterpolator &SplineEngine::Interpolator() {
+  return interpolator;
+}
+
+// SetCompactOutput - storage of both kinds of points is released, it is grown
+// again by the next Update().
+void SplineEngine::SetCompactOutput(bool compact,
+                                    CompactPolyline::Format format) {
+  compactOutput = compact;
+  compactFormat = format;
+  for (int counter = 0; counter < splines.size(); ++counter) {
+    splines[counter]->interpolatedPoints = QPolygonF();
+    splines[counter]->compactPoints = CompactPolyline(format);
+  }
+}
+
+bool SplineEngine::CompactOutput() const {
+  return compactOutput;
+}
+
+// AddSpline - adds spline and fills knot vector of uniform cubic B-spline that
+// passes through endpoints.
+int SplineEngine::AddSpline(const QPolygonF &controlPoints,
+                            const QPolygonF &speeds) {
+  Spline *spline = new Spline;
+  spline->compactPoints.SetFormat(compactFormat);
+  for (int counter = 0; counter < controlPoints.size(); ++counter)
+    spline->controlPoints.Add(controlPoints[counter],
+                              counter < speeds.size() ? speeds[counter] :
+                                                        QPointF());
+  bspline::FillUniformKnotVector(3, controlPoints.size(), spline->knotVector);
+  splines.push_back(spline);
+  scheduled = false;
+  return splines.size() - 1;
+}
+
+// Clear - removes all splines and tasks.
+void SplineEngine::Clear() {
+  for (int counter = 0; counter < splines.size(); ++counter)
+    delete splines[counter];
+  splines.clear();
+  for (int counter = 0; counter < tasks.size(); ++counter)
+    delete tasks[counter];
+  tasks.clear();
+  order.clear();
+  scheduled = false;
+}
+
+int SplineEngine::SplinesNumber() const {
+  return splines.size();
+}
+
+ControlPointStore &SplineEngine::ControlPoints(int index) {
+  return splines[index]->controlPoints;
+}
+
+const ControlPointStore &SplineEngine::ControlPoints(int index) const {
+  return splines[index]->controlPoints;
+}
+
+const QPolygonF &SplineEngine::BoorNetPoints(int index) const {
+  return splines[index]->boorNetPoints;
+}
+
+const QPolygonF &SplineEngine::InterpolatedPoints(int index) const {
+  return splines[index]->interpolatedPoints;
+}
+
+const CompactPolyline &SplineEngine::CompactPoints(int index) const {
+  return splines[index]->compactPoints;
+}
+
+// Update - runs all tasks on pool, or on the calling thread if there is no
+// pool or one task.
+void SplineEngine::Update() {
+  if (splines.isEmpty())
+    return;
+  const int threads = pool ? pool->ThreadsNumber() : 1;
+  if (!scheduled)
+    Schedule(threads);
+
+  while (scratches.size() < threads)
+    scratches.push_back(new Scratch);
+  // Interpolator is copied, because interpolation records statistics in it.
+  for (int counter = 0; counter < scratches.size(); ++counter) {
+    scratches[counter]->interpolator = interpolator;
+    scratches[counter]->interpolator.ResetMaxSubdivisionLevel();
+  }
+
+  if (!pool || tasks.size() < 2) {
+    for (int counter = 0; counter < tasks.size(); ++counter)
+      tasks[counter]->Run();
+  } else {
+    pool->Run(tasks);
+  }
+
+  for (int counter = 0; counter < scratches.size(); ++counter)
+    interpolator.ReachSubdivisionLevel(
+          scratches[counter]->interpolator.MaxSubdivisionLevel());
+}
+
+qint64 SplineEngine::InterpolatedPointsNumber() const {
+  qint64 number = 0;
+  for (int counter = 0; counter < splines.size(); ++counter)
+    number += compactOutput ? splines[counter]->compactPoints.size() :
+                              splines[counter]->interpolatedPoints.size();
+  return number;
+}
+
+qint64 SplineEngine::InterpolatedPointsBytes() const {
+  qint64 bytes = 0;
+  for (int counter = 0; counter < splines.size(); ++counter)
+    bytes += splines[counter]->compactPoints.MemoryBytes() +
+             (qint64) splines[counter]->interpolatedPoints.capacity() *
+             sizeof(QPointF);
+  return bytes;
+}
+
+// Schedule - long splines go first, so thieves take large tasks from the
+// fronts of queues and short tasks at the backs fill the gaps in the end.
+void SplineEngine::Schedule(int threadsNumber) {
+  QVector<int> costs(splines.size());
+  qint64 totalCost = 0;
+  order.resize(splines.size());
+  for (int counter = 0; counter < splines.size(); ++counter) {
+    costs[counter] = SplineCost(splines[counter]->controlPoints.Size());
+    totalCost += costs[counter];
+    order[counter] = counter;
+  }
+  std::sort(order.begin(), order.end(), CostGreater(costs));
+
+  for (int counter = 0; counter < tasks.size(); ++counter)
+    delete tasks[counter];
+  tasks.resize(0);
+  const qint64 taskCost = qMax((qint64) minTaskCost,
+                               totalCost / (tasksPerThread * threadsNumber));
+  int begin = 0;
+  qint64 cost = 0;
+  for (int counter = 0; counter < order.size(); ++counter) {
+    cost += costs[order[counter]];
+    if (cost >= taskCost || counter + 1 == order.size()) {
+      tasks.push_back(new BatchTask(this, begin, counter + 1));
+      begin = counter + 1;
+      cost = 0;
+    }
+  }
+  scheduled = true;
+}
+
+// UpdateSpline - the same calculation as SplineCache does when it rebuilds
+// spline.
+void SplineEngine::UpdateSpline(Spline &spline, Scratch &scratch) const {
+  const ControlPointStore &controlPoints = spline.controlPoints;
+  if (controlPoints.Size() < 4) {
+    spline.boorNetPoints.resize(0);
+    spline.interpolatedPoints.resize(0);
+    spline.compactPoints.Clear();
+    return;
+  }
+  const int boorNetSize =
+      BezierInterpolator::BoorNetSize(controlPoints.Size());
+  spline.boorNetPoints.resize(boorNetSize);
+  scratch.interpolator.CalculateBoorNet(controlPoints, spline.knotVector,
+                                        spline.boorNetPoints.data());
+
+  if (compactOutput) {
+    // Flatteners write compact points directly, curve by curve.
+    const QPointF *boorNet = spline.boorNetPoints.constData();
+    spline.compactPoints.Clear();
+    spline.compactPoints.push_back(controlPoints.Point(0));
+    for (int first = 0; first + 3 < boorNetSize; first += 3)
+      scratch.interpolator.InterpolateCurve(boorNet[first], boorNet[first + 1],
+                                            boorNet[first + 2],
+                                            boorNet[first + 3],
+                                            spline.compactPoints);
+    spline.compactPoints.push_back(
+          controlPoints.Point(controlPoints.Size() - 1));
+    return;
+  }
+
+  // Batch interpolation takes coordinates in separate arrays.
+  scratch.boorNetX.resize(boorNetSize);
+  scratch.boorNetY.resize(boorNetSize);
+  for (int counter = 0; counter < boorNetSize; ++counter) {
+    scratch.boorNetX[counter] = spline.boorNetPoints[counter].x();
+    scratch.boorNetY[counter] = spline.boorNetPoints[counter].y();
+  }
+
+  spline.interpolatedPoints.resize(0);
+  spline.interpolatedPoints.push_back(controlPoints.Point(0));
+  scratch.interpolator.InterpolateBezierBatch(scratch.boorNetX.constData(),
+                                              scratch.boorNetY.constData(),
+                                              (boorNetSize - 1) / 3,
+                                              spline.interpolatedPoints);
+  spline.interpolatedPoints.push_back(
+        controlPoints.Point(controlPoints.Size() - 1));
+}
@@ -0,0 +1,105 @@
+#ifndef SPLINEENGINE_H
+#define SPLINEENGINE_H
+
+#include <QPolygonF>
+#include <QVector>
+#include "bezierinterpolator.h"
+#include "compactpolyline.h"
+#include "controlpointstore.h"
+#include "workstealingpool.h"
+
+// SplineEngine - owns many independent clamped uniform cubic B-splines and
+// recalculates their boor nets and interpolated points on threads of
+// WorkStealingPool. Splines are packed into tasks of similar cost: splines are
+// ordered from the longest to the shortest, every long spline is a task of its
+// own and short ones are grouped. Every thread keeps its own scratch buffers
+// and copy of interpolator between updates, so updates allocate nothing once
+// buffers have grown. Interpolated points may be kept in CompactPolyline
+// instead of QPolygonF to take less memory.
+class SplineEngine {
+public:
+  SplineEngine();
+  ~SplineEngine();
+
+  // SetPool - splines are updated on threads of \p value, which is not owned.
+  // If it is 0 (the default), all splines are updated on the calling thread.
+  void SetPool(WorkStealingPool *value);
+
+  // Interpolator - settings of interpolation of all splines. Threads take
+  // copies of it on every Update().
+  BezierInterpolator &Interpolator();
+
+  // SetCompactOutput - if \p compact is true, interpolated points of splines
+  // are written into CompactPolyline of \p format instead of QPolygonF.
+  // Points of the other kind are released.
+  void SetCompactOutput(bool compact,
+                        CompactPolyline::Format format =
+                            CompactPolyline::DeltaFormat);
+  bool CompactOutput() const;
+
+  // AddSpline - adds spline with \p controlPoints and speeds \p speeds, which
+  // may be empty. Returns index of the spline. Spline needs 4 or more control
+  // points to be interpolated.
+  int AddSpline(const QPolygonF &controlPoints,
+                const QPolygonF &speeds = QPolygonF());
+
+  // Clear - removes all splines.
+  void Clear();
+
+  int SplinesNumber() const;
+
+  // ControlPoints - control points of spline \p index. They may be moved
+  // between updates, but their number must not be changed.
+  ControlPointStore &ControlPoints(int index);
+  const ControlPointStore &ControlPoints(int index) const;
+
+  // BoorNetPoints, InterpolatedPoints - results of the last Update().
+  // InterpolatedPoints() is empty with compact output, and CompactPoints() is
+  // empty without it.
+  const QPolygonF &BoorNetPoints(int index) const;
+  const QPolygonF &InterpolatedPoints(int index) const;
+  const CompactPolyline &CompactPoints(int index) const;
+
+  // Update - recalculates boor nets and interpolated points of all splines.
+  void Update();
+
+  // InterpolatedPointsNumber - number of points of all splines after the last
+  // Update().
+  qint64 InterpolatedPointsNumber() const;
+
+  // InterpolatedPointsBytes - storage of interpolated points of all splines,
+  // including reserved one.
+  qint64 InterpolatedPointsBytes() const;
+
+private:
+  struct Spline;
+  struct Scratch;
+  class BatchTask;
+
+  // Schedule - orders splines by cost and packs them into tasks.
+  void Schedule(int threadsNumber);
+
+  // UpdateSpline - recalculates one spline with buffers of \p scratch.
+  void UpdateSpline(Spline &spline, Scratch &scratch) const;
+
+  BezierInterpolator interpolator;
+  bool compactOutput;
+  CompactPolyline::Format compactFormat;
+  QVector<Spline*> splines;
+
+  WorkStealingPool *pool;
+  // Tasks of the last schedule, kept until splines are added or removed.
+  QVector<WorkStealingPool::Task*> tasks;
+  // Splines ordered by cost, tasks take ranges of it.
+  QVector<int> order;
+  bool scheduled;
+  // Buffers of every thread of pool, the first one is used on the calling
+  // thread too.
+  QVector<Scratch*> scratches;
+
+  // Copying is not supported.
+  SplineEngine(const SplineEngine &);
+  SplineEngine &operator=(const SplineEngine &);
+};
+
+#endif // SPLINEENGINE_H
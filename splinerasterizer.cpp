@@ -0,0 +1,129 @@
+#include "splinerasterizer.h"
+
+// Points are drawn as circles of this size in pixels, as by PolylineItem in
+// unscaled view.
+static const qreal pointSize = 4;
+
+/// drawPoints - draws all \p points in one call as round dots of \p color.
+static void drawPoints(QPainter &painter, const QPolygonF &points,
+                       const QColor &color, qreal scale) {
+  QPen pen(color);
+  pen.setCosmetic(true);
+  pen.setWidthF(pointSize * scale);
+  pen.setCapStyle(Qt::RoundCap);
+  painter.setPen(pen);
+  painter.drawPoints(points);
+}
+
+/// drawPolyline - draws polyline in one call with line of \p color.
+static void drawPolyline(QPainter &painter, const QPolygonF &points,
+                         const QColor &color, qreal scale) {
+  if (points.size() < 2)
+    return;
+  QPen pen(color);
+  pen.setCosmetic(true);
+  pen.setWidthF(scale);
+  painter.setPen(pen);
+  painter.drawPolyline(points);
+}
+
+SplineRasterizer::SplineRasterizer() :
+  quality(SupersampledQuality), showInterpolatedPoints(false),
+  showControlLines(true), showBoorPoints(false), showBoorLines(false) {}
+
+void SplineRasterizer::setQuality(Quality quality) {
+  this->quality = quality;
+}
+
+void SplineRasterizer::setShowInterpolatedPoints(bool show) {
+  showInterpolatedPoints = show;
+}
+
+void SplineRasterizer::setShowControlLines(bool show) {
+  showControlLines = show;
+}
+
+void SplineRasterizer::setShowBoorPoints(bool show) {
+  showBoorPoints = show;
+}
+
+void SplineRasterizer::setShowBoorLines(bool show) {
+  showBoorLines = show;
+}
+
+/// render - draws \p frame into image of \p size pixels which shows
+/// \p sceneRect of the scene. Images are allocated again only when size or
+/// quality is changed.
+void SplineRasterizer::render(const SplineFrame &frame, const QRectF &sceneRect,
+                              const QSize &size) {
+  if (size.isEmpty() || sceneRect.isEmpty())
+    return;
+  const int factor = quality == SupersampledQuality ? 2 : 1;
+  const QSize canvasSize = size * factor;
+  if (canvas.size() != canvasSize)
+    canvas = QImage(canvasSize, QImage::Format_ARGB32_Premultiplied);
+  canvas.fill(0);
+
+  {
+    QPainter painter(&canvas);
+    painter.setRenderHint(QPainter::Antialiasing, quality != AliasedQuality);
+    painter.scale(canvasSize.width() / sceneRect.width(),
+                  canvasSize.height() / sceneRect.height());
+    painter.translate(-sceneRect.topLeft());
+    drawFrame(painter, frame, factor);
+  }
+
+  if (quality == SupersampledQuality) {
+    if (output.size() != size)
+      output = QImage(size, QImage::Format_ARGB32_Premultiplied);
+    downsample();
+  }
+  outputRect = sceneRect;
+}
+
+/// image - result of the last render(), transparent where nothing is drawn.
+const QImage &SplineRasterizer::image() const {
+  return quality == SupersampledQuality ? output : canvas;
+}
+
+QRectF SplineRasterizer::sceneRect() const {
+  return outputRect;
+}
+
+/// drawFrame - draws all visible parts of \p frame in order of items of
+/// MainWindow: curve, control polygon, boor net.
+void SplineRasterizer::drawFrame(QPainter &painter, const SplineFrame &frame,
+                                 qreal scale) {
+  drawPolyline(painter, frame.interpolatedPoints, Qt::black, scale);
+  if (showInterpolatedPoints)
+    drawPoints(painter, frame.interpolatedPoints, Qt::black, scale);
+  if (showControlLines)
+    drawPolyline(painter, frame.controlPoints, Qt::blue, scale);
+  if (showBoorLines)
+    drawPolyline(painter, frame.boorNetPoints, Qt::red, scale);
+  if (showBoorPoints)
+    drawPoints(painter, frame.boorNetPoints, Qt::green, scale);
+}
+
+/// downsample - averages every 2x2 pixels of \var canvas into one pixel of
+/// \var output. Pixels are premultiplied, so channels are averaged
+/// independently, two channels at once in 16-bit halves of a word.
+void SplineRasterizer::downsample() {
+  const quint32 mask = 0x00ff00ff;
+  for (int y = 0; y < output.height(); ++y) {
+    const quint32 *top =
+        reinterpret_cast<const quint32*>(canvas.constScanLine(2 * y));
+    const quint32 *bottom =
+        reinterpret_cast<const quint32*>(canvas.constScanLine(2 * y + 1));
+    quint32 *line = reinterpret_cast<quint32*>(output.scanLine(y));
+    for (int x = 0; x < output.width(); ++x) {
+      const quint32 p1 = top[2 * x], p2 = top[2 * x + 1];
+      const quint32 p3 = bottom[2 * x], p4 = bottom[2 * x + 1];
+      const quint32 redBlue = (p1 & mask) + (p2 & mask) + (p3 & mask) +
+          (p4 & mask);
+      const quint32 alphaGreen = ((p1 >> 8) & mask) + ((p2 >> 8) & mask) +
+          ((p3 >> 8) & mask) + ((p4 >> 8) & mask);
+      line[x] = ((redBlue >> 2) & mask) | (((alphaGreen >> 2) & mask) << 8);
+    }
+  }
+}
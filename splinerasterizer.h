@@ -0,0 +1,70 @@
+#ifndef SPLINERASTERIZER_H
+#define SPLINERASTERIZER_H
+
+#include <QImage>
+#include <QPainter>
+#include <QRectF>
+#include <QSize>
+#include "splineworker.h"
+
+/// SplineRasterizer - draws interpolated curve, control polygon and boor net of
+/// a frame straight into an image, without items of QGraphicsScene. Every
+/// polyline and every set of points is one draw call, and images are reused
+/// between frames, so cost of a frame depends on number of pixels rather than
+/// on number of items. Control points are not drawn, they stay on the scene as
+/// an item which can be dragged.
+class SplineRasterizer {
+public:
+  /// Quality - own quality modes of the rasterizer for levels of
+  /// AntialiasingSlider.
+  enum Quality {
+    AliasedQuality,     // Lines without antialiasing.
+    AntialiasedQuality, // Antialiased lines.
+    SupersampledQuality // Antialiased lines drawn at double resolution and
+                        // averaged down.
+  };
+
+  SplineRasterizer();
+
+  void setQuality(Quality quality);
+
+  /// setShow* - switch parts of the frame like display settings of MainWindow.
+  void setShowInterpolatedPoints(bool show);
+  void setShowControlLines(bool show);
+  void setShowBoorPoints(bool show);
+  void setShowBoorLines(bool show);
+
+  /// render - draws \p frame into image of \p size pixels which shows
+  /// \p sceneRect of the scene.
+  void render(const SplineFrame &frame, const QRectF &sceneRect,
+              const QSize &size);
+
+  /// image - result of the last render(), transparent where nothing is drawn.
+  const QImage &image() const;
+
+  /// sceneRect - part of the scene shown by image().
+  QRectF sceneRect() const;
+
+private:
+  /// drawFrame - draws all visible parts of \p frame, lines are \p scale pixels
+  /// wide.
+  void drawFrame(QPainter &painter, const SplineFrame &frame, qreal scale);
+
+  /// downsample - averages every 2x2 pixels of \var canvas into one pixel of
+  /// \var output.
+  void downsample();
+
+  Quality quality;
+  bool showInterpolatedPoints;
+  bool showControlLines;
+  bool showBoorPoints;
+  bool showBoorLines;
+
+  // Image which is painted on, twice as large as output for
+  // SupersampledQuality.
+  QImage canvas;
+  QImage output;
+  QRectF outputRect;
+};
+
+#endif // SPLINERASTERIZER_H
@@ -0,0 +1,38 @@
+#include "splinescene.h"
+#include <QPainter>
+
+SplineScene::SplineScene(FrameProfiler *profiler, QObject *parent) :
+  QGraphicsScene(parent), profiler(profiler), paintTime(0), raster(0) {}
+
+/// setRaster - shows \p image stretched over \p rect of the scene in the
+/// background.
+void SplineScene::setRaster(const QImage *image, const QRectF &rect) {
+  // Both old and new area must be repainted.
+  if (raster)
+    update(rasterRect);
+  raster = image;
+  rasterRect = rect;
+  if (raster)
+    update(rasterRect);
+}
+
+qint64 SplineScene::lastPaintTime() const {
+  return paintTime;
+}
+
+void SplineScene::drawBackground(QPainter *painter, const QRectF &rect) {
+  QGraphicsScene::drawBackground(painter, rect);
+  // Raster is a part of painting of the frame.
+  paintTimer.start();
+  if (raster)
+    painter->drawImage(rasterRect, *raster);
+}
+
+void SplineScene::drawForeground(QPainter *painter, const QRectF &rect) {
+  if (paintTimer.isValid()) {
+    paintTime = paintTimer.nsecsElapsed();
+    profiler->AddStageTime(FrameProfiler::PaintStage, paintTime);
+  }
+  paintTimer.invalidate();
+  QGraphicsScene::drawForeground(painter, rect);
+}
@@ -0,0 +1,39 @@
+#ifndef SPLINESCENE_H
+#define SPLINESCENE_H
+
+#include <QGraphicsScene>
+#include <QElapsedTimer>
+#include <QImage>
+#include "frameprofiler.h"
+
+/// SplineScene - scene which records time of painting of its items into
+/// \var profiler. View draws background of the scene before items and
+/// foreground after them, so time between them is the time of items painting.
+/// Image drawn by SplineRasterizer may be shown as background, then items are
+/// an overlay above it.
+class SplineScene : public QGraphicsScene {
+public:
+  explicit SplineScene(FrameProfiler *profiler, QObject *parent = 0);
+
+  /// setRaster - shows \p image stretched over \p rect of the scene in the
+  /// background, nothing is shown if \p image is 0. Image is not copied and
+  /// must live while it is shown.
+  void setRaster(const QImage *image, const QRectF &rect);
+
+  /// lastPaintTime - time of the last painting of items in nanoseconds.
+  qint64 lastPaintTime() const;
+
+protected:
+  void drawBackground(QPainter *painter, const QRectF &rect);
+  void drawForeground(QPainter *painter, const QRectF &rect);
+
+private:
+  FrameProfiler *profiler;
+  QElapsedTimer paintTimer;
+  qint64 paintTime;
+
+  const QImage *raster;
+  QRectF rasterRect;
+};
+
+#endif // SPLINESCENE_H
@@ -0,0 +1,321 @@
+#include "splineworker.h"
+#include <QMutexLocker>
+#include <algorithm>
+
+namespace {
+
+// Control points are moved once per this number of milliseconds.
+const int animationPeriod = 30;
+
+// Recorded timings are handed over once per this number of milliseconds.
+const int profilePeriod = 1000;
+
+// RandomSpeed - speed of new control point.
+QPointF RandomSpeed() {
+  const int speedLimit = 5;
+  return QPointF(qrand() % speedLimit, qrand() % speedLimit);
+}
+
+// CopyPolygon - copies \p from into storage of \p to, so \p to doesn't share
+// data with \p from and keeps its capacity.
+void CopyPolygon(const QPolygonF &from, QPolygonF &to) {
+  if (to.capacity() < from.size())
+    to.reserve(from.size());
+  to.resize(from.size());
+  std::copy(from.constBegin(), from.constEnd(), to.begin());
+}
+
+} // namespace
+
+SplineWorker::SplineWorker(QObject *parent) :
+  QThread(parent), stopRequested(false), frameNotified(0), animated(false),
+  distanceTolerance(0.5), viewScale(1.0) {
+  // Reserved vectors keep storage when they are emptied.
+  commands.reserve(64);
+  appliedCommands.reserve(64);
+  splineCache.SetProfiler(&profile);
+  integrator.SetPool(&pool);
+  splineCache.SetPool(&pool);
+}
+
+SplineWorker::~SplineWorker() {
+  Stop();
+}
+
+void SplineWorker::SetControlPoints(const QPolygonF &points) {
+  Command command;
+  command.type = Command::SetControlPointsCommand;
+  command.points = points;
+  PostCommand(command);
+}
+
+void SplineWorker::AddControlPoint(const QPointF &point) {
+  Command command;
+  command.type = Command::AddControlPointCommand;
+  command.point = point;
+  PostCommand(command);
+}
+
+// RemoveControlPoint - removes the last control point.
+void SplineWorker::RemoveControlPoint() {
+  Command command;
+  command.type = Command::RemoveControlPointCommand;
+  PostCommand(command);
+}
+
+void SplineWorker::MoveControlPoint(ControlPointStore::Handle handle,
+                                    const QPointF &point) {
+  Command command;
+  command.type = Command::MoveControlPointCommand;
+  command.index = handle;
+  command.point = point;
+  PostCommand(command);
+}
+
+void SplineWorker::SetDistanceTolerance(double value) {
+  Command command;
+  command.type = Command::SetDistanceToleranceCommand;
+  command.value = value;
+  PostCommand(command);
+}
+
+void SplineWorker::SetSpeedMultiplicator(double value) {
+  Command command;
+  command.type = Command::SetSpeedMultiplicatorCommand;
+  command.value = value;
+  PostCommand(command);
+}
+
+void SplineWorker::SetAnimated(bool animated) {
+  Command command;
+  command.type = Command::SetAnimatedCommand;
+  command.index = animated;
+  PostCommand(command);
+}
+
+// SetBounds - control points are moved by animation within rectangle from
+// (0, 0) to \p bounds.
+void SplineWorker::SetBounds(const QSizeF &bounds) {
+  Command command;
+  command.type = Command::SetBoundsCommand;
+  command.bounds = bounds;
+  PostCommand(command);
+}
+
+// SetViewport - only curves which may be visible in \p visibleRect of scene
+// are interpolated.
+void SplineWorker::SetViewport(const QRectF &visibleRect, double scale) {
+  Command command;
+  command.type = Command::SetViewportCommand;
+  command.rect = visibleRect;
+  command.value = scale;
+  PostCommand(command);
+}
+
+// Stop - finishes the thread and waits for it.
+void SplineWorker::Stop() {
+  {
+    QMutexLocker locker(&commandsMutex);
+    stopRequested = true;
+    commandsPosted.wakeOne();
+  }
+  wait();
+}
+
+// TakeFrame - makes the latest finished frame current.
+bool SplineWorker::TakeFrame() {
+  // Frame finished after this point will be notified again.
+  frameNotified.fetchAndStoreOrdered(0);
+  return frames.Acquire();
+}
+
+// Frame - current frame, it isn't changed until next TakeFrame().
+const SplineFrame &SplineWorker::Frame() const {
+  return frames.ReadBuffer();
+}
+
+// TakeProfile - moves timings of stages done by worker into \p profiler.
+void SplineWorker::TakeProfile(FrameProfiler &profiler) {
+  QMutexLocker locker(&profileMutex);
+  profiler.Merge(publishedProfile);
+  publishedProfile.Reset();
+}
+
+// PostCommand - queues \p command and wakes worker.
+void SplineWorker::PostCommand(const Command &command) {
+  QMutexLocker locker(&commandsMutex);
+  commands.push_back(command);
+  commandsPosted.wakeOne();
+}
+
+void SplineWorker::run() {
+  QElapsedTimer animationTimer;
+  animationTimer.start();
+  profileTimer.start();
+  for (;;) {
+    {
+      QMutexLocker locker(&commandsMutex);
+      // Sleep until commands are posted or it is time to move control points.
+      while (!stopRequested && commands.isEmpty()) {
+        if (!animated) {
+          commandsPosted.wait(&commandsMutex);
+          continue;
+        }
+        qint64 timeLeft = animationPeriod - animationTimer.elapsed();
+        if (timeLeft <= 0)
+          break;
+        commandsPosted.wait(&commandsMutex, (unsigned long) timeLeft);
+      }
+      if (stopRequested)
+        break;
+      // Commands are applied without the lock, so other threads are never
+      // blocked by calculations.
+      appliedCommands.swap(commands);
+    }
+
+    // Time of a frame includes applying of edits which caused it.
+    QElapsedTimer frameTimer;
+    frameTimer.start();
+    bool changed = false;
+    for (int counter = 0; counter < appliedCommands.size(); ++counter)
+      changed |= ApplyCommand(appliedCommands[counter]);
+    appliedCommands.resize(0);
+
+    if (animated && animationTimer.elapsed() >= animationPeriod) {
+      animationTimer.restart();
+      MoveControlPoints();
+      changed = true;
+    }
+
+    if (changed && controlPoints.Size() > 2) {
+      Interpolate();
+      PublishFrame(frameTimer.nsecsElapsed());
+    }
+
+    if (profileTimer.elapsed() >= profilePeriod)
+      PublishProfile();
+  }
+  PublishProfile();
+}
+
+// ApplyCommand - returns true if spline must be recalculated.
+bool SplineWorker::ApplyCommand(const Command &command) {
+  switch (command.type) {
+    case Command::SetControlPointsCommand:
+      controlPoints.Clear();
+      for (int counter = 0; counter < command.points.size(); ++counter)
+        controlPoints.Add(command.points[counter], RandomSpeed());
+      FillKnotVector();
+      splineCache.Invalidate();
+      return true;
+    case Command::AddControlPointCommand:
+      controlPoints.Add(command.point, RandomSpeed());
+      FillKnotVector();
+      splineCache.Invalidate();
+      return true;
+    case Command::RemoveControlPointCommand:
+      if (controlPoints.IsEmpty())
+        return false;
+      controlPoints.RemoveLast();
+      FillKnotVector();
+      splineCache.Invalidate();
+      return true;
+    case Command::MoveControlPointCommand: {
+      // Point may be removed by earlier command.
+      const int index = controlPoints.Index(command.index);
+      if (index < 0)
+        return false;
+      controlPoints.SetPoint(index, command.point);
+      // While control point is dragged only curves around it are changed.
+      splineCache.ControlPointMoved(index);
+      return true;
+    }
+    case Command::SetDistanceToleranceCommand:
+      distanceTolerance = command.value;
+      UpdateDistanceTolerance();
+      splineCache.Invalidate();
+      return true;
+    case Command::SetSpeedMultiplicatorCommand:
+      integrator.SetSpeedMultiplicator(command.value);
+      return false;
+    case Command::SetAnimatedCommand:
+      animated = command.index;
+      return false;
+    case Command::SetBoundsCommand:
+      integrator.SetBounds((int) command.bounds.width(),
+                           (int) command.bounds.height());
+      return false;
+    case Command::SetViewportCommand: {
+      const double scale = command.value > 0.0 ? command.value : viewScale;
+      // Tolerance depends on scale, so all curves are recalculated.
+      if (scale != viewScale) {
+        bezierInterpolator.SetClipRect(command.rect);
+        viewScale = scale;
+        UpdateDistanceTolerance();
+        splineCache.Invalidate();
+        return true;
+      }
+      if (command.rect == bezierInterpolator.ClipRect())
+        return false;
+      return splineCache.SetClipRect(bezierInterpolator, command.rect,
+                                     boorNetPoints);
+    }
+  }
+  return false;
+}
+
+// MoveControlPoints - moves control points according to its speed.
+void SplineWorker::MoveControlPoints() {
+  StageTimer timer(&profile, FrameProfiler::MoveStage);
+  integrator.Advance(controlPoints);
+  splineCache.ControlPointsMoved();
+}
+
+// Interpolate - recalculates boor net and interpolated points of dirty curves.
+void SplineWorker::Interpolate() {
+  bezierInterpolator.ResetMaxSubdivisionLevel();
+  splineCache.Update(bezierInterpolator, controlPoints, knotVector,
+                     boorNetPoints, interpolatedPoints);
+  profile.AddCounter(FrameProfiler::InterpolatedPointsCounter,
+                     interpolatedPoints.size());
+  profile.AddCounter(FrameProfiler::SubdivisionLevelCounter,
+                     bezierInterpolator.MaxSubdivisionLevel());
+}
+
+// PublishFrame - copies spline into next frame and notifies about it.
+void SplineWorker::PublishFrame(qint64 calculationTime) {
+  SplineFrame &frame = frames.WriteBuffer();
+  frame.calculationTime = calculationTime;
+  controlPoints.CopyPoints(frame.controlPoints);
+  controlPoints.CopyHandles(frame.controlPointHandles);
+  CopyPolygon(boorNetPoints, frame.boorNetPoints);
+  CopyPolygon(interpolatedPoints, frame.interpolatedPoints);
+  frames.Publish();
+
+  if (frameNotified.testAndSetOrdered(0, 1))
+    emit FrameReady();
+}
+
+// PublishProfile - hands recorded timings over to TakeProfile().
+void SplineWorker::PublishProfile() {
+  {
+    QMutexLocker locker(&profileMutex);
+    publishedProfile.Merge(profile);
+  }
+  profile.Reset();
+  profileTimer.restart();
+}
+
+// UpdateDistanceTolerance - passes tolerance in units of scene to interpolator.
+void SplineWorker::UpdateDistanceTolerance() {
+  // Tolerance is compared with squared distances. Zoomed out view doesn't need
+  // details smaller than a pixel.
+  bezierInterpolator.SetDistanceTolerance(distanceTolerance /
+                                          (viewScale * viewScale));
+}
+
+// FillKnotVector - fill \var knotVector with knots for uniform cubic B-spline
+// that passes through endpoints.
+void SplineWorker::FillKnotVector() {
+  bspline::FillUniformKnotVector(3, controlPoints.Size(), knotVector);
+}
@@ -0,0 +1,176 @@
+#ifndef SPLINEWORKER_H
+#define SPLINEWORKER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QPolygonF>
+#include <QRectF>
+#include <QSizeF>
+#include <QVector>
+#include "bezierinterpolator.h"
+#include "controlpointintegrator.h"
+#include "controlpointstore.h"
+#include "frameprofiler.h"
+#include "splinecache.h"
+#include "triplebuffer.h"
+#include "workstealingpool.h"
+
+// SplineFrame - everything that is needed to draw one frame of the spline.
+struct SplineFrame {
+  QPolygonF controlPoints;
+  // Handle of every control point, see ControlPointStore.
+  QVector<ControlPointStore::Handle> controlPointHandles;
+  QPolygonF boorNetPoints;
+  QPolygonF interpolatedPoints;
+  // Time in nanoseconds which worker spent on the frame.
+  qint64 calculationTime;
+
+  SplineFrame() : calculationTime(0) {}
+};
+
+// SplineWorker - thread which moves control points of B-spline and
+// interpolates it. Other threads send edits as commands and take finished
+// frames from triple buffer, so GUI thread never waits for calculations and
+// worker never waits for drawing.
+class SplineWorker : public QThread {
+  Q_OBJECT
+
+public:
+  explicit SplineWorker(QObject *parent = 0);
+  ~SplineWorker();
+
+  // Commands. They may be called from any thread and are applied by worker
+  // before its next frame.
+  void SetControlPoints(const QPolygonF &points);
+  void AddControlPoint(const QPointF &point);
+  // RemoveControlPoint - removes the last control point.
+  void RemoveControlPoint();
+  // MoveControlPoint - moves control point with \p handle, nothing happens if
+  // the point was removed meanwhile.
+  void MoveControlPoint(ControlPointStore::Handle handle, const QPointF &point);
+  void SetDistanceTolerance(double value);
+  void SetSpeedMultiplicator(double value);
+  void SetAnimated(bool animated);
+  // SetBounds - control points are moved by animation within rectangle from
+  // (0, 0) to \p bounds.
+  void SetBounds(const QSizeF &bounds);
+  // SetViewport - only curves which may be visible in \p visibleRect of scene
+  // are interpolated, others are replaced with chords. Distance tolerance is
+  // given in pixels of view, \p scale is number of pixels per unit of scene.
+  // Viewport equal to the current one is ignored.
+  void SetViewport(const QRectF &visibleRect, double scale);
+
+  // Stop - finishes the thread and waits for it.
+  void Stop();
+
+  // TakeFrame - makes the latest finished frame current. Returns false if no
+  // frame was finished since the last call. Must be called from one thread.
+  bool TakeFrame();
+
+  // Frame - current frame, it isn't changed until next TakeFrame().
+  const SplineFrame &Frame() const;
+
+  // TakeProfile - moves timings of stages done by worker into \p profiler.
+  // Worker hands them over about once a second.
+  void TakeProfile(FrameProfiler &profiler);
+
+signals:
+  // FrameReady - emitted when a frame is finished. It isn't emitted again until
+  // TakeFrame() is called.
+  void FrameReady();
+
+protected:
+  void run();
+
+private:
+  struct Command {
+    enum Type {
+      SetControlPointsCommand,
+      AddControlPointCommand,
+      RemoveControlPointCommand,
+      MoveControlPointCommand,
+      SetDistanceToleranceCommand,
+      SetSpeedMultiplicatorCommand,
+      SetAnimatedCommand,
+      SetBoundsCommand,
+      SetViewportCommand
+    };
+
+    Command() : type(SetControlPointsCommand), index(0), value(0.0) {}
+
+    Type type;
+    int index;
+    QPointF point;
+    double value;
+    QPolygonF points;
+    QSizeF bounds;
+    QRectF rect;
+  };
+
+  // PostCommand - queues \p command and wakes worker.
+  void PostCommand(const Command &command);
+
+  // ApplyCommand - returns true if spline must be recalculated.
+  bool ApplyCommand(const Command &command);
+
+  // MoveControlPoints - moves control points according to its speed.
+  void MoveControlPoints();
+
+  // Interpolate - recalculates boor net and interpolated points of dirty
+  // curves.
+  void Interpolate();
+
+  // PublishFrame - copies spline into next frame and notifies about it.
+  // \p calculationTime is time spent on the frame in nanoseconds.
+  void PublishFrame(qint64 calculationTime);
+
+  // PublishProfile - hands recorded timings over to TakeProfile().
+  void PublishProfile();
+
+  // UpdateDistanceTolerance - passes tolerance in units of scene to
+  // interpolator.
+  void UpdateDistanceTolerance();
+
+  // FillKnotVector - fill \var knotVector with knots for uniform cubic
+  // B-spline that passes through endpoints.
+  void FillKnotVector();
+
+  // Shared between threads.
+  QMutex commandsMutex;
+  QWaitCondition commandsPosted;
+  QVector<Command> commands;
+  bool stopRequested;
+
+  TripleBuffer<SplineFrame> frames;
+  // 1 if FrameReady() was emitted and frame is not taken yet.
+  QAtomicInt frameNotified;
+
+  QMutex profileMutex;
+  FrameProfiler publishedProfile;
+
+  // Owned by worker thread. Threads of the pool move control points and
+  // interpolate long splines.
+  WorkStealingPool pool;
+  QVector<Command> appliedCommands;
+  ControlPointStore controlPoints;
+  // Keeps bounds and speed multiplicator of animation.
+  ControlPointIntegrator integrator;
+  QVector<qreal> knotVector;
+  QPolygonF boorNetPoints;
+  QPolygonF interpolatedPoints;
+  BezierInterpolator bezierInterpolator;
+  SplineCache splineCache;
+  FrameProfiler profile;
+  QElapsedTimer profileTimer;
+
+  bool animated;
+  // Distance tolerance in pixels of view and number of pixels per unit of
+  // scene.
+  double distanceTolerance;
+  double viewScale;
+};
+
+#endif // SPLINEWORKER_H
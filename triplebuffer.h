@@ -0,0 +1,50 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <QAtomicInt>
+
+// TripleBuffer - passes values from one writer thread to one reader thread
+// without locks. Writer fills its own buffer and publishes it, reader takes the
+// latest published buffer. Neither of them waits for the other, unread values
+// are overwritten. Buffers are reused, so values may keep their storage.
+template <typename T>
+class TripleBuffer {
+public:
+  TripleBuffer() : middle(1), writeIndex(0), readIndex(2) {}
+
+  // WriteBuffer - buffer owned by writer until Publish().
+  T &WriteBuffer() { return buffers[writeIndex]; }
+
+  // Publish - makes write buffer the latest value and takes another buffer for
+  // writing.
+  void Publish() {
+    writeIndex = middle.fetchAndStoreOrdered(writeIndex | FreshBit) &
+                 IndexMask;
+  }
+
+  // Acquire - makes the latest published value readable. Returns false if
+  // nothing was published since the last call.
+  bool Acquire() {
+    if (!(middle.fetchAndAddOrdered(0) & FreshBit))
+      return false;
+    readIndex = middle.fetchAndStoreOrdered(readIndex) & IndexMask;
+    return true;
+  }
+
+  // ReadBuffer - buffer owned by reader until Acquire().
+  const T &ReadBuffer() const { return buffers[readIndex]; }
+
+private:
+  enum {
+    IndexMask = 3,
+    FreshBit = 4 // Middle buffer was published and is not read yet.
+  };
+
+  T buffers[3];
+  // Index of the buffer which is exchanged between threads.
+  QAtomicInt middle;
+  int writeIndex;
+  int readIndex;
+};
+
+#endif // TRIPLEBUFFER_H
@@ -0,0 +1,146 @@
+#include "workstealingpool.h"
+#include <QMutexLocker>
+#include <QThread>
+
+// Worker - thread of pool.
+class WorkStealingPool::Worker : public QThread {
+public:
+  Worker(WorkStealingPool *pool, int index) : pool(pool), index(index) {}
+
+protected:
+  void run() { pool->WorkerLoop(index); }
+
+private:
+  WorkStealingPool *pool;
+  int index;
+};
+
+WorkStealingPool::WorkStealingPool(int threadsNumber) :
+  batchNumber(0), busyWorkers(0), stopping(false) {
+  if (threadsNumber <= 0)
+    threadsNumber = qMax(QThread::idealThreadCount(), 1);
+  for (int counter = 0; counter < threadsNumber; ++counter) {
+    Queue *queue = new Queue;
+    queue->begin = queue->end = queue->stolen = 0;
+    queues.push_back(queue);
+  }
+  for (int counter = 0; counter < threadsNumber; ++counter) {
+    workers.push_back(new Worker(this, counter));
+    workers.last()->start();
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    QMutexLocker locker(&stateMutex);
+    stopping = true;
+    batchStarted.wakeAll();
+  }
+  for (int counter = 0; counter < workers.size(); ++counter) {
+    workers[counter]->wait();
+    delete workers[counter];
+  }
+  for (int counter = 0; counter < queues.size(); ++counter)
+    delete queues[counter];
+}
+
+// Run - runs all \p tasks and waits until they are finished.
+void WorkStealingPool::Run(const QVector<Task*> &tasks) {
+  if (tasks.isEmpty())
+    return;
+  const int queuesNumber = queues.size();
+  for (int counter = 0; counter < queuesNumber; ++counter) {
+    Queue &queue = *queues[counter];
+    QMutexLocker locker(&queue.mutex);
+    // Neighbouring tasks are likely to be similar, so each thread gets its own
+    // range and stealing starts from the other end of it.
+    const int first = (int) ((qint64) tasks.size() * counter / queuesNumber);
+    const int last = (int) ((qint64) tasks.size() * (counter + 1) /
+                            queuesNumber);
+    queue.tasks.resize(last - first);
+    for (int task = first; task < last; ++task)
+      queue.tasks[task - first] = tasks[task];
+    queue.begin = 0;
+    queue.end = last - first;
+    queue.stolen = 0;
+  }
+
+  QMutexLocker locker(&stateMutex);
+  busyWorkers = workers.size();
+  ++batchNumber;
+  batchStarted.wakeAll();
+  while (busyWorkers > 0)
+    batchFinished.wait(&stateMutex);
+}
+
+int WorkStealingPool::ThreadsNumber() const {
+  return workers.size();
+}
+
+// StolenTasksNumber - number of tasks which were run by another thread than the
+// one they were given to during the last Run().
+int WorkStealingPool::StolenTasksNumber() const {
+  int stolen = 0;
+  for (int counter = 0; counter < queues.size(); ++counter) {
+    QMutexLocker locker(&queues[counter]->mutex);
+    stolen += queues[counter]->stolen;
+  }
+  return stolen;
+}
+
+// TakeTask - takes task from the back of own queue of thread \p index.
+WorkStealingPool::Task *WorkStealingPool::TakeTask(int index) {
+  Queue &queue = *queues[index];
+  QMutexLocker locker(&queue.mutex);
+  if (queue.begin == queue.end)
+    return 0;
+  return queue.tasks[--queue.end];
+}
+
+// StealTask - takes task from the front of queue of another thread. Victims are
+// tried in order starting from the next thread, so thieves don't crowd on the
+// same queue.
+WorkStealingPool::Task *WorkStealingPool::StealTask(int index) {
+  const int queuesNumber = queues.size();
+  for (int counter = 1; counter < queuesNumber; ++counter) {
+    Queue &queue = *queues[(index + counter) % queuesNumber];
+    QMutexLocker locker(&queue.mutex);
+    if (queue.begin == queue.end)
+      continue;
+    ++queue.stolen;
+    return queue.tasks[queue.begin++];
+  }
+  return 0;
+}
+
+// WorkerLoop - waits for batch, runs tasks until all queues are empty and waits
+// for the next batch. Tasks are never added while batch runs, so queues stay
+// empty once thread has found them empty.
+void WorkStealingPool::WorkerLoop(int index) {
+  int lastBatch = 0;
+  for (;;) {
+    {
+      QMutexLocker locker(&stateMutex);
+      while (batchNumber == lastBatch && !stopping)
+        batchStarted.wait(&stateMutex);
+      if (stopping)
+        return;
+      lastBatch = batchNumber;
+    }
+
+    for (;;) {
+      Task *task = TakeTask(index);
+      if (!task)
+        task = StealTask(index);
+      if (!task)
+        break;
+      task->threadIndex = index;
+      task->Run();
+      task->threadIndex = -1;
+    }
+
+    QMutexLocker locker(&stateMutex);
+    if (--busyWorkers == 0)
+      batchFinished.wakeAll();
+  }
+}
@@ -0,0 +1,88 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <QMutex>
+#include <QVector>
+#include <QWaitCondition>
+
+// WorkStealingPool - runs batches of independent tasks on all cores. Every
+// thread has its own queue of tasks and takes tasks from its back. Thread which
+// has emptied its queue steals tasks from the front of queues of other threads,
+// so threads stay busy even when tasks take different time.
+class WorkStealingPool {
+public:
+  // Task - unit of work. Run() is called once on one of threads of pool.
+  class Task {
+  public:
+    Task() : threadIndex(-1) {}
+    virtual ~Task() {}
+    virtual void Run() = 0;
+
+  protected:
+    // ThreadIndex - index of thread of pool which runs the task, from 0 to
+    // ThreadsNumber() - 1. It is -1 if Run() was called directly. Tasks use it
+    // to pick per-thread buffers.
+    int ThreadIndex() const { return threadIndex; }
+
+  private:
+    friend class WorkStealingPool;
+    int threadIndex;
+  };
+
+  // Threads are started at once and wait for tasks. If \p threadsNumber is not
+  // positive, one thread per core is started.
+  explicit WorkStealingPool(int threadsNumber = 0);
+  ~WorkStealingPool();
+
+  // Run - runs all \p tasks and waits until they are finished. Tasks are split
+  // evenly between queues of threads in contiguous ranges. Pool doesn't take
+  // ownership of tasks.
+  void Run(const QVector<Task*> &tasks);
+
+  int ThreadsNumber() const;
+
+  // StolenTasksNumber - number of tasks which were run by another thread than
+  // the one they were given to during the last Run().
+  int StolenTasksNumber() const;
+
+private:
+  class Worker;
+  friend class Worker;
+
+  // Queue - tasks of one thread. Tasks in [begin, end) are not taken yet.
+  struct Queue {
+    QMutex mutex;
+    QVector<Task*> tasks;
+    int begin;
+    int end;
+    int stolen;
+  };
+
+  // TakeTask - takes task from the back of own queue of thread \p index.
+  Task *TakeTask(int index);
+
+  // StealTask - takes task from the front of queue of another thread.
+  Task *StealTask(int index);
+
+  // WorkerLoop - body of thread \p index.
+  void WorkerLoop(int index);
+
+  QVector<Queue*> queues;
+  QVector<Worker*> workers;
+
+  // Guards fields below, which start and finish batches.
+  QMutex stateMutex;
+  QWaitCondition batchStarted;
+  QWaitCondition batchFinished;
+  // Incremented for every batch, so that threads see new batch only once.
+  int batchNumber;
+  // Number of threads which have not finished current batch yet.
+  int busyWorkers;
+  bool stopping;
+
+  // Copying is not supported.
+  WorkStealingPool(const WorkStealingPool &);
+  WorkStealingPool &operator=(const WorkStealingPool &);
+};
+
+#endif // WORKSTEALINGPOOL_H